@@ -0,0 +1,188 @@
+#include "binimage.h"
+
+// sum of the bit positions that are set in w, from popcounts instead of a loop over the bits.
+// bit k of a position is 1 for the positions picked out by mask k
+static const uint32_t posMask[5] = {0xAAAAAAAA, 0xCCCCCCCC, 0xF0F0F0F0, 0xFF00FF00, 0xFFFF0000};
+
+static int wordPosSum(uint32_t w){
+    int k;
+    int sum = 0;
+    for(k=0;k<5;k++){
+        sum = sum + (__builtin_popcount(w & posMask[k]) << k);
+    }
+    return sum;
+}
+
+void binClear(binImage_t *img, int sizeX, int sizeY){
+    int row, i;
+    img->sizeX = sizeX;
+    img->sizeY = sizeY;
+    img->words = (sizeX+31)/32;
+    for(row=0;row<sizeY;row++){
+        for(i=0;i<img->words;i++){
+            img->bits[row][i] = 0;
+        }
+    }
+}
+
+// the pixels that are inside the image in the last word of a row
+uint32_t binLastMask(const binImage_t *img){
+    int used = img->sizeX - 32*(img->words-1);
+    return used == 32 ? 0xFFFFFFFF : (1u << used) - 1;
+}
+
+// each pixel's left and right neighbours for a whole row, a pixel on the edge is its own neighbour
+static void rowNeighbours(const binImage_t *img, const uint32_t *w, uint32_t *left, uint32_t *right){
+    int i;
+    int last = img->words-1;
+    for(i=0;i<=last;i++){
+        left[i] = (w[i] << 1) | (i > 0 ? w[i-1] >> 31 : w[0] & 1);
+        right[i] = (w[i] >> 1) | (i < last ? w[i+1] << 31 : 0);
+    }
+    right[last] |= w[last] & (1u << ((img->sizeX-1) & 31));
+}
+
+// 3x3 erosion: a pixel stays white only if all 9 pixels around it are white.
+// removes specks and thin noise. out must not be in
+void binErode(const binImage_t *in, binImage_t *out){
+    uint32_t h[3][BIN_MAX_WORDS]; // rows above, at and below after the horizontal pass
+    uint32_t left[BIN_MAX_WORDS], right[BIN_MAX_WORDS];
+    uint32_t mask = binLastMask(in);
+    int row, i;
+    binClear(out, in->sizeX, in->sizeY);
+
+    for(row=0;row<in->sizeY;row++){
+        // horizontal pass for the three rows, edges repeat the edge row
+        int k;
+        for(k=0;k<3;k++){
+            int r = row + k - 1;
+            r = r < 0 ? 0 : (r >= in->sizeY ? in->sizeY-1 : r);
+            rowNeighbours(in, in->bits[r], left, right);
+            for(i=0;i<in->words;i++){
+                h[k][i] = in->bits[r][i] & left[i] & right[i];
+            }
+        }
+        for(i=0;i<in->words;i++){
+            out->bits[row][i] = h[0][i] & h[1][i] & h[2][i];
+        }
+        out->bits[row][in->words-1] &= mask;
+    }
+}
+
+// 3x3 dilation: a pixel becomes white if any of the 9 pixels around it is white.
+// fills small gaps in the line. out must not be in
+void binDilate(const binImage_t *in, binImage_t *out){
+    uint32_t h[3][BIN_MAX_WORDS];
+    uint32_t left[BIN_MAX_WORDS], right[BIN_MAX_WORDS];
+    uint32_t mask = binLastMask(in);
+    int row, i;
+    binClear(out, in->sizeX, in->sizeY);
+
+    for(row=0;row<in->sizeY;row++){
+        int k;
+        for(k=0;k<3;k++){
+            int r = row + k - 1;
+            r = r < 0 ? 0 : (r >= in->sizeY ? in->sizeY-1 : r);
+            rowNeighbours(in, in->bits[r], left, right);
+            for(i=0;i<in->words;i++){
+                h[k][i] = in->bits[r][i] | left[i] | right[i];
+            }
+        }
+        for(i=0;i<in->words;i++){
+            out->bits[row][i] = h[0][i] | h[1][i] | h[2][i];
+        }
+        out->bits[row][in->words-1] &= mask;
+    }
+}
+
+// white pixels in a row
+int binRowCount(const binImage_t *img, int row){
+    int i;
+    int count = 0;
+    for(i=0;i<img->words;i++){
+        count = count + __builtin_popcount(img->bits[row][i]);
+    }
+    return count;
+}
+
+// white pixel count of a row, *sumCol gets the sum of their columns like rowWhite() in cam.c
+int binRowCentroid(const binImage_t *img, int row, int *sumCol){
+    int i;
+    int count = 0;
+    *sumCol = 0;
+    for(i=0;i<img->words;i++){
+        uint32_t w = img->bits[row][i];
+        int n = __builtin_popcount(w);
+        count = count + n;
+        *sumCol = *sumCol + 32*i*n + wordPosSum(w);
+    }
+    return count;
+}
+
+// center of all the white pixels in the image, returns how many there are (cx, cy not set if 0)
+int binCentroid(const binImage_t *img, float *cx, float *cy){
+    int row;
+    int count = 0;
+    int sumX = 0;
+    int sumY = 0;
+    for(row=0;row<img->sizeY;row++){
+        int sumCol;
+        int n = binRowCentroid(img, row, &sumCol);
+        count = count + n;
+        sumX = sumX + sumCol;
+        sumY = sumY + n*row;
+    }
+    if (count){
+        *cx = (float)sumX / count;
+        *cy = (float)sumY / count;
+    }
+    return count;
+}
+
+// first pixel at or after x in the row that is white (want 1) or black (want 0), sizeX if none
+static int nextPixel(const binImage_t *img, const uint32_t *w, int x, int want){
+    while (x < img->sizeX){
+        int i = x >> 5;
+        uint32_t v = want ? w[i] : ~w[i];
+        v = v >> (x & 31); // drop the pixels before x
+        if (v){
+            x = x + __builtin_ctz(v);
+            return x < img->sizeX ? x : img->sizeX;
+        }
+        x = (i+1) << 5;
+    }
+    return img->sizeX;
+}
+
+// the runs of white pixels in a row, left to right. returns how many, at most maxRuns
+int binRuns(const binImage_t *img, int row, binRun_t *runs, int maxRuns){
+    const uint32_t *w = img->bits[row];
+    int n = 0;
+    int x = 0;
+    while (n < maxRuns){
+        x = nextPixel(img, w, x, 1);
+        if (x >= img->sizeX){
+            break;
+        }
+        runs[n].start = x;
+        x = nextPixel(img, w, x, 0);
+        runs[n].end = x;
+        n++;
+    }
+    return n;
+}
+
+// a row as bytes with the leftmost pixel in the MSB, the FRAME_BINARY layout in framelink.h
+void binRowBytes(const binImage_t *img, int row, uint8_t *out){
+    int n = (img->sizeX+7)/8;
+    int i, b;
+    for(i=0;i<n;i++){
+        uint8_t v = (img->bits[row][i>>2] >> (8*(i&3))) & 0xFF;
+        // reverse the bits, the word has the leftmost pixel in the LSB
+        uint8_t r = 0;
+        for(b=0;b<8;b++){
+            r = (r << 1) | ((v >> b) & 1);
+        }
+        out[i] = r;
+    }
+}
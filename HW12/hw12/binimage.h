@@ -0,0 +1,39 @@
+#ifndef BINIMAGE_h
+#define BINIMAGE_h
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Thresholded image packed 32 pixels to a word, 1 is white (the line).
+// Pixel x of a row is bit x&31 of word x>>5, so shifting a word left moves pixels right.
+// Bits past sizeX in the last word of a row are always 0.
+// Whole words are worked on at a time, so a 160 pixel row is 5 operations instead of 160.
+// No pico calls in here.
+
+#define BIN_MAX_X 160 // same as CAM_MAX_SIZEX
+#define BIN_MAX_Y 120 // same as CAM_MAX_SIZEY
+#define BIN_MAX_WORDS ((BIN_MAX_X+31)/32)
+
+typedef struct binImage{
+    uint16_t sizeX, sizeY;
+    uint16_t words; // used words per row
+    uint32_t bits[BIN_MAX_Y][BIN_MAX_WORDS];
+} binImage_t;
+
+// one run of white pixels in a row, [start, end)
+typedef struct binRun{
+    uint16_t start;
+    uint16_t end;
+} binRun_t;
+
+void binClear(binImage_t *img, int sizeX, int sizeY);
+uint32_t binLastMask(const binImage_t *img);
+void binErode(const binImage_t *in, binImage_t *out);
+void binDilate(const binImage_t *in, binImage_t *out);
+int binRowCount(const binImage_t *img, int row);
+int binRowCentroid(const binImage_t *img, int row, int *sumCol);
+int binCentroid(const binImage_t *img, float *cx, float *cy);
+int binRuns(const binImage_t *img, int row, binRun_t *runs, int maxRuns);
+void binRowBytes(const binImage_t *img, int row, uint8_t *out);
+
+#endif
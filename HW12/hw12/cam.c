@@ -1,242 +1,398 @@
 #include "cam.h"
+#include "cam.pio.h"
+
+// cameras that have claimed a DMA channel, so the shared interrupt can find them
+static camera_t *cameras[CAM_MAX_CAMERAS];
+static int numCameras = 0;
+
+// fill in the default pins and peripherals from the #defines, change them before init_camera_pins() for a second camera
+void camera_init_config(camera_t *cam){
+    cam->i2c = I2C_PORT;
+    cam->sda = I2C_SDA;
+    cam->scl = I2C_SCL;
+    cam->pinBase = D0;
+    cam->rst = RST;
+    cam->pwdn = PWDN;
+    cam->pio = CAM_PIO;
+    cam->size = OV7670_SIZE_DIV8;
+    cam->sizeX = 80;
+    cam->sizeY = 60;
+    camRoiDefault(&cam->roi, 80, 60, CAM_MAX_SIZEX, CAM_MAX_SIZEY);
+    cam->format = CAM_FORMAT_RGB565;
+    cam->bpp = 2;
+    cam->data = cam->buffers[0];
+    cam->sccbDma = -1;
+    atomic_init(&cam->saveImage, 0);
+    atomic_init(&cam->streaming, 0);
+    camRingInit(&cam->ring);
+    cam->rawIndex = 0;
+    cam->hsCount = 0;
+    cam->heldSeq = 0;
+    cam->aeOn = false;
+}
 
-void gpio_callback(uint gpio, uint32_t events) {
-    if (gpio == VS){
-        //printf("v\n");
-        if (saveImage==1){
-            //printf("v\n");
-            rawIndex = 0;
-            hsCount = 0;
-            vsCount = 0;
-            startImage = 1;
-            startCollect = 0;
-        }
+// restart the state machine and DMA so the next falling VS starts a new frame in buf
+static void cam_arm_capture(camera_t *cam, uint8_t *buf){
+    pio_sm_set_enabled(cam->pio, cam->sm, false);
+    pio_sm_clear_fifos(cam->pio, cam->sm);
+    pio_sm_restart(cam->pio, cam->sm);
+    cam->pio->fdebug = 1u << (PIO_FDEBUG_RXSTALL_LSB + cam->sm); // forget the stall from the end of the last frame
+
+    // row geometry for the PIO program, Y is the bytes skipped and the OSR the count kept minus one
+    bool luma = cam->format == CAM_FORMAT_LUMA;
+    pio_sm_put(cam->pio, cam->sm, camRoiSkipBytes(&cam->roi));
+    pio_sm_exec(cam->pio, cam->sm, pio_encode_pull(false, true));
+    pio_sm_exec(cam->pio, cam->sm, pio_encode_mov(pio_y, pio_osr));
+    pio_sm_put(cam->pio, cam->sm, (luma ? cam->sizeX : cam->sizeX*2) - 1);
+    pio_sm_exec(cam->pio, cam->sm, pio_encode_pull(false, true));
+    pio_sm_exec(cam->pio, cam->sm, pio_encode_jmp(luma ? cam->offsetLuma : cam->offset));
+
+    dma_channel_config c = dma_channel_get_default_config(cam->dma);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_dreq(&c, pio_get_dreq(cam->pio, cam->sm, false));
+    dma_channel_configure(cam->dma, &c, buf, &cam->pio->rxf[cam->sm], cam->sizeX*cam->sizeY*cam->bpp/4, true);
+
+    cam->rawIndex = 0;
+    cam->hsCount = 0;
+    pio_sm_set_enabled(cam->pio, cam->sm, true);
+}
+
+// stop the capture. an abort can still raise the channel's completion interrupt, so it is
+// masked and cleared around the abort the way the SDK asks for dma_channel_abort()
+static void cam_abort_capture(camera_t *cam){
+    pio_sm_set_enabled(cam->pio, cam->sm, false);
+    dma_channel_set_irq0_enabled(cam->dma, false);
+    dma_channel_abort(cam->dma);
+    dma_channel_acknowledge_irq0(cam->dma);
+    dma_channel_set_irq0_enabled(cam->dma, true);
+}
+
+// a frame of bytes bytes has landed in the buffer being filled.
+// called from the DMA interrupt, a mock or replayed source can call it the same way
+void camera_frame_done(camera_t *cam, uint32_t bytes){
+    cam->rawIndex = bytes;
+    cam->hsCount = bytes / (cam->sizeX*cam->bpp);
+    if (!atomic_load_explicit(&cam->streaming, memory_order_relaxed)){
+        // release: the frame data is written before getSaveImage() can see 0
+        atomic_store_explicit(&cam->saveImage, 0, memory_order_release);
+        return;
     }
-    if (gpio == HS){
-        //printf("h");
-        if(saveImage){
-            if (startImage){
-                startCollect = 1;
-                hsCount++;
-                if (hsCount == IMAGESIZEY){
-                    //printf("%d",hsCount);
-                    saveImage = 0;
-                    startImage = 0;
-                    startCollect = 0;
-                    hsCount = 0;
-                }
+
+    // publish the finished frame, replacing one the application never took, and carry on
+    // in the buffer it was in. never the one the application holds, see camring.h
+    camRingPublish(&cam->ring);
+    cam_arm_capture(cam, cam->buffers[camRingFill(&cam->ring)]);
+}
+
+// bytes captured so far into the buffer being filled, to the nearest DMA word
+static uint32_t cam_bytes(camera_t *cam){
+    return cam->sizeX*cam->sizeY*cam->bpp - dma_channel_hw_addr(cam->dma)->transfer_count*4;
+}
+
+// the whole frame has landed for one of the cameras
+static void cam_dma_handler(){
+    int i;
+    for(i=0;i<numCameras;i++){
+        camera_t *cam = cameras[i];
+        if (dma_channel_get_irq0_status(cam->dma)){
+            dma_channel_acknowledge_irq0(cam->dma);
+            if (!atomic_load_explicit(&cam->saveImage, memory_order_relaxed) && !atomic_load_explicit(&cam->streaming, memory_order_relaxed)){
+                continue; // nothing was armed, not a frame
             }
+            // the PIO does not count rows, stop it before it starts on the next frame
+            pio_sm_set_enabled(cam->pio, cam->sm, false);
+            uint32_t bytes = cam_bytes(cam);
+#if CAM_TELEMETRY
+            // RXSTALL means the FIFO was full when the PIO wanted to push, bytes were lost
+            uint32_t stall = 1u << (PIO_FDEBUG_RXSTALL_LSB + cam->sm);
+            bool overrun = cam->pio->fdebug & stall;
+            cam->pio->fdebug = stall;
+            camStatsDone(&cam->stats, time_us_32(), bytes, cam->sizeY, cam->sizeX*cam->bpp, overrun);
+#endif
+            camera_frame_done(cam, bytes);
         }
     }
-    if (gpio == PCLK){
-        if(saveImage){
-            if(startImage){
-                if(startCollect){
-                    vsCount++;
-                    // read the raw data
-                    uint32_t d = gpio_get_all();
-                    cameraData[rawIndex] = d & 0xFF;
-                    rawIndex++;
-                    if (rawIndex == IMAGESIZEX*IMAGESIZEY*2){
-                        saveImage = 0;
-                        startImage = 0;
-                        startCollect = 0;
-                    }
-                    if (vsCount == IMAGESIZEX*2){
-                        startCollect = 0;
-                        vsCount = 0;
-                    }
-                }
-            }
+}
+
+#if CAM_TELEMETRY
+// VS and HS edges, only used for the telemetry. one interrupt per row, nothing per pixel
+static void cam_gpio_callback(uint gpio, uint32_t events){
+    int i;
+    for(i=0;i<numCameras;i++){
+        camera_t *cam = cameras[i];
+        if (gpio == cam->pinBase + (VS - D0)){
+            bool armed = atomic_load_explicit(&cam->saveImage, memory_order_relaxed) || atomic_load_explicit(&cam->streaming, memory_order_relaxed);
+            camStatsVS(&cam->stats, time_us_32(), armed ? cam_bytes(cam) : 0, armed);
         }
+        else if (gpio == cam->pinBase + (HS - D0)){
+            camStatsHS(&cam->stats, cam_bytes(cam));
+        }
+    }
+}
+#endif
+
+// load the PIO program that matches cam->format into the state machine
+static void cam_select_program(camera_t *cam){
+    if (cam->format == CAM_FORMAT_LUMA){
+        cam_luma_program_init(cam->pio, cam->sm, cam->offsetLuma, cam->pinBase);
+    }
+    else {
+        cam_program_init(cam->pio, cam->sm, cam->offset, cam->pinBase);
+    }
+}
+
+// claim the state machine and DMA channel used to capture frames
+static void init_camera_capture(camera_t *cam){
+    // both programs stay loaded so the format can change without touching instruction memory
+    cam->offset = pio_add_program(cam->pio, &cam_program);
+    cam->offsetLuma = pio_add_program(cam->pio, &cam_luma_program);
+    cam->sm = pio_claim_unused_sm(cam->pio, true);
+    cam_select_program(cam);
+
+    cam->dma = dma_claim_unused_channel(true);
+    hard_assert(numCameras < CAM_MAX_CAMERAS);
+    cameras[numCameras++] = cam;
+    dma_channel_set_irq0_enabled(cam->dma, true);
+    if (numCameras == 1){
+        irq_set_exclusive_handler(CAM_DMA_IRQ, cam_dma_handler);
+        irq_set_enabled(CAM_DMA_IRQ, true);
     }
+
+#if CAM_TELEMETRY
+    camStatsInit(&cam->stats);
+    // new image starts on falling VS, new row starts on rising HS
+    gpio_set_irq_enabled_with_callback(cam->pinBase + (VS - D0), GPIO_IRQ_EDGE_FALL, true, &cam_gpio_callback);
+    gpio_set_irq_enabled_with_callback(cam->pinBase + (HS - D0), GPIO_IRQ_EDGE_RISE, true, &cam_gpio_callback);
+#endif
 }
 
 // setup the camera pins
-void init_camera_pins(){
+void init_camera_pins(camera_t *cam){
+    // the PIO program expects D0-D7, VS, HS, MCLK and PCLK on consecutive pins like GP0-GP11
+    uint vs = cam->pinBase + (VS - D0);
+    uint hs = cam->pinBase + (HS - D0);
+    uint mclk = cam->pinBase + (MCLK - D0);
+    uint pclk = cam->pinBase + (PCLK - D0);
+
     // 8 data pins
-    gpio_init(D0);
-    gpio_set_dir(D0, GPIO_IN);
-    gpio_init(D1);
-    gpio_set_dir(D1, GPIO_IN);
-    gpio_init(D2);
-    gpio_set_dir(D2, GPIO_IN);
-    gpio_init(D3);
-    gpio_set_dir(D3, GPIO_IN);
-    gpio_init(D4);
-    gpio_set_dir(D4, GPIO_IN);
-    gpio_init(D5);
-    gpio_set_dir(D5, GPIO_IN);
-    gpio_init(D6);
-    gpio_set_dir(D6, GPIO_IN);
-    gpio_init(D7);
-    gpio_set_dir(D7, GPIO_IN);
-
-    gpio_init(RST); // reset pin
-    gpio_set_dir(RST, GPIO_OUT);
-    gpio_put(RST, 1);
-
-    gpio_init(PWDN); // powerdown pin
-    gpio_set_dir(PWDN, GPIO_OUT);
-    gpio_put(PWDN, 0);
+    uint i;
+    for(i=0;i<8;i++){
+        gpio_init(cam->pinBase + i);
+        gpio_set_dir(cam->pinBase + i, GPIO_IN);
+    }
+
+    gpio_init(cam->rst); // reset pin
+    gpio_set_dir(cam->rst, GPIO_OUT);
+    gpio_put(cam->rst, 1);
+
+    gpio_init(cam->pwdn); // powerdown pin
+    gpio_set_dir(cam->pwdn, GPIO_OUT);
+    gpio_put(cam->pwdn, 0);
 
     // set MCLK to 50% 25MHz PWM -> actually only 18.75MHz
-    gpio_set_function(MCLK, GPIO_FUNC_PWM); // Set the LED Pin to be PWM
-    uint slice_num = pwm_gpio_to_slice_num(MCLK); // Get PWM slice number
+    gpio_set_function(mclk, GPIO_FUNC_PWM); // Set the LED Pin to be PWM
+    uint slice_num = pwm_gpio_to_slice_num(mclk); // Get PWM slice number
     float div = 2; // must be between 1-255, 2 for 25MHz
     pwm_set_clkdiv(slice_num, div); // divider
     uint16_t wrap = 3; // when to rollover, must be less than 65535
     pwm_set_wrap(slice_num, wrap);
     pwm_set_enabled(slice_num, true); // turn on the PWM
-    pwm_set_gpio_level(MCLK, wrap / 2); // set the duty cycle to 50%
+    pwm_set_gpio_level(mclk, wrap / 2); // set the duty cycle to 50%
 
-    sleep_ms(1000); // give the camera time to get going
+    sleep_ms(CAM_SETTLE_MS); // give the camera time to get going
 
     // powerdown and restart
-    gpio_put(PWDN, 1);
+    gpio_put(cam->pwdn, 1);
     sleep_ms(1);
-    gpio_put(PWDN, 0);
-    sleep_ms(1000);
-
-    // I2C Initialisation. Using it at 100Khz.
-    i2c_init(I2C_PORT, 100*1000);
-    gpio_set_function(I2C_SDA, GPIO_FUNC_I2C);
-    gpio_set_function(I2C_SCL, GPIO_FUNC_I2C);
-    gpio_pull_up(I2C_SDA);
-    gpio_pull_up(I2C_SCL);
+    gpio_put(cam->pwdn, 0);
+    sleep_ms(CAM_SETTLE_MS);
+
+    // I2C Initialisation. SCCB is good for 400Khz.
+    i2c_init(cam->i2c, 400*1000);
+    gpio_set_function(cam->sda, GPIO_FUNC_I2C);
+    gpio_set_function(cam->scl, GPIO_FUNC_I2C);
+    gpio_pull_up(cam->sda);
+    gpio_pull_up(cam->scl);
     
     printf("Start init camera\n");
-    init_camera();
+    init_camera(cam);
     printf("End init camera\n");
 
-    // interrupts
-    gpio_init(VS); // vertical sync
-    gpio_set_dir(VS, GPIO_IN);
-    // new image starts on falling VS
-    gpio_set_irq_enabled_with_callback(VS, GPIO_IRQ_EDGE_FALL, true, &gpio_callback);
-
-    gpio_init(HS); // horizontal sync
-    gpio_set_dir(HS, GPIO_IN);
-    // new row starts on rising HS
-    gpio_set_irq_enabled_with_callback(HS, GPIO_IRQ_EDGE_RISE, true, &gpio_callback);
+    // sync and clock pins, read by the PIO state machine
+    gpio_init(vs); // vertical sync, new image starts on falling VS
+    gpio_set_dir(vs, GPIO_IN);
+    gpio_init(hs); // horizontal sync, new row starts on rising HS
+    gpio_set_dir(hs, GPIO_IN);
+    gpio_init(pclk); // pixel clock, read byte on rising PCLK
+    gpio_set_dir(pclk, GPIO_IN);
 
-    gpio_init(PCLK); // pixel clock
-    gpio_set_dir(PCLK, GPIO_IN);
-    // read byte on rising PCLK
-    gpio_set_irq_enabled_with_callback(PCLK, GPIO_IRQ_EDGE_RISE, true, &gpio_callback);
+    init_camera_capture(cam);
 }
 
 // init the camera with RST and I2C commands
-void init_camera(){
+void init_camera(camera_t *cam){
     // hardware reset the camera
-    gpio_put(RST, 0);
+    gpio_put(cam->rst, 0);
     sleep_ms(1);
-    gpio_put(RST, 1);
-    sleep_ms(1000);
+    gpio_put(cam->rst, 1);
+    sleep_ms(CAM_RESET_MS);
 
-    OV7670_write_register(0x12, 0x80); // software reset
-    sleep_ms(1000);
+    OV7670_write_register(cam, 0x12, 0x80); // software reset
+    sleep_ms(CAM_RESET_MS);
 
     // perform all the I2C writes for init
     // 25MHz * PLL / divisor = 24MHz for 30fps -> actually only 5fps
-    OV7670_write_register(OV7670_REG_CLKRC, 1); // div 1
-    OV7670_write_register(OV7670_REG_DBLV, 0); // no pll
+    OV7670_write_register(cam, OV7670_REG_CLKRC, 1); // div 1
+    OV7670_write_register(cam, OV7670_REG_DBLV, 0); // no pll
 
-    int i = 0;
+    // the register tables go out over DMA, one channel kept for it from here on
+    if (cam->sccbDma < 0){
+        cam->sccbDma = dma_claim_unused_channel(false);
+    }
+    if (cam->sccbDma < 0){
+        printf("no DMA channel for the camera registers\n");
+        return;
+    }
 
     // init regular registers
-    for(i=0; i<92; i++){
-        OV7670_write_register(OV7670_init[i][0],OV7670_init[i][1]);
-    }
+    OV7670_write_table(cam, OV7670_init);
 
-    // set colorspace to RGB565
-    for(i=0; i<12; i++){
-        OV7670_write_register(OV7670_rgb[i][0],OV7670_rgb[i][1]);
-    }
+    // set colorspace to RGB565, or YUV422 for luma
+    const uint8_t (*colorspace)[2] = cam->format == CAM_FORMAT_LUMA ? OV7670_yuv : OV7670_rgb;
+    OV7670_write_table(cam, colorspace);
+
+#if CAM_VERIFY_REGISTERS
+    printf("init mismatches = %d\n", OV7670_verify_table(cam, OV7670_init));
+    printf("colorspace mismatches = %d\n", OV7670_verify_table(cam, colorspace));
+#endif
 
     // init image size
-    
-    // Window settings were tediously determined empirically.
-    // I hope there's a formula for this, if a do-over is needed.
-    //{vstart,hstart,edge_offset,pclk_delay}
-            //{9, 162, 2, 2},  // SIZE_DIV1  640x480 VGA
-            //{10, 174, 4, 2}, // SIZE_DIV2  320x240 QVGA
-            //{11, 186, 2, 2}, // SIZE_DIV4  160x120 QQVGA
-            //{12, 210, 0, 2}, // SIZE_DIV8  80x60   ...
-            //{15, 252, 3, 2}, // SIZE_DIV16 40x30
-
-    uint8_t value;
-    uint8_t size = OV7670_SIZE_DIV8; // 80x60
-    uint16_t vstart = 12;
-    uint16_t hstart = 210;
-    uint16_t edge_offset = 0;
-    uint16_t pclk_delay = 2;
-
-    // Enable downsampling if sub-VGA, and zoom if 1:16 scale
-    value = (size > OV7670_SIZE_DIV1) ? OV7670_COM3_DCWEN : 0;
-    if (size == OV7670_SIZE_DIV16)
-    value |= OV7670_COM3_SCALEEN;
-    OV7670_write_register(OV7670_REG_COM3, value);
-
-    // Enable PCLK division if sub-VGA 2,4,8,16 = 0x19,1A,1B,1C
-    value = (size > OV7670_SIZE_DIV1) ? (0x18 + size) : 0;
-    OV7670_write_register(OV7670_REG_COM14, value);
-
-    // Horiz/vert downsample ratio, 1:8 max (H,V are always equal for now)
-    value = (size <= OV7670_SIZE_DIV8) ? size : OV7670_SIZE_DIV8;
-    OV7670_write_register(OV7670_REG_SCALING_DCWCTR, value * 0x11);
-
-    // Pixel clock divider if sub-VGA
-    value = (size > OV7670_SIZE_DIV1) ? (0xF0 + size) : 0x08;
-    OV7670_write_register(OV7670_REG_SCALING_PCLK_DIV, value);
-
-    // Apply 0.5 digital zoom at 1:16 size (others are downsample only)
-    value = (size == OV7670_SIZE_DIV16) ? 0x40 : 0x20; // 0.5, 1.0
-    // Read current SCALING_XSC and SCALING_YSC register values because
-    // test pattern settings are also stored in those registers and we
-    // don't want to corrupt anything there.
+    camera_set_resolution(cam, OV7670_SIZE_DIV8); // 80x60
 
-    uint8_t xsc = OV7670_read_register(OV7670_REG_SCALING_XSC);
-    uint8_t ysc = OV7670_read_register(OV7670_REG_SCALING_YSC);
-
-    xsc = (xsc & 0x80) | value; // Modify only scaling bits (not test pattern)
-    ysc = (ysc & 0x80) | value;
-    // Write modified result back to SCALING_XSC and SCALING_YSC
-    OV7670_write_register(OV7670_REG_SCALING_XSC, xsc);
-    OV7670_write_register(OV7670_REG_SCALING_YSC, ysc);
-
-    // Window size is scattered across multiple registers.
-    // Horiz/vert stops can be automatically calc'd from starts.
-    uint16_t vstop = vstart + 480;
-    uint16_t hstop = (hstart + 640) % 784;
-    OV7670_write_register(OV7670_REG_HSTART, hstart >> 3);
-    OV7670_write_register(OV7670_REG_HSTOP, hstop >> 3);
-    OV7670_write_register(OV7670_REG_HREF,(edge_offset << 6) | ((hstop & 0b111) << 3) | (hstart & 0b111));
-    OV7670_write_register(OV7670_REG_VSTART, vstart >> 2);
-    OV7670_write_register(OV7670_REG_VSTOP, vstop >> 2);
-    OV7670_write_register(OV7670_REG_VREF, ((vstop & 0b11) << 2) | (vstart & 0b11));
-    OV7670_write_register(OV7670_REG_SCALING_PCLK_DELAY, pclk_delay);
-
-    sleep_ms(300); // allow camera to settle with new settings 
-
-    //OV7670_test_pattern(OV7670_TEST_PATTERN_NONE);
-    //OV7670_test_pattern(OV7670_TEST_PATTERN_COLOR_BAR);
+    sleep_ms(CAM_CONFIG_SETTLE_MS); // allow camera to settle with new settings 
+
+    //OV7670_test_pattern(cam, OV7670_TEST_PATTERN_NONE);
+    //OV7670_test_pattern(cam, OV7670_TEST_PATTERN_COLOR_BAR);
     //sleep_ms(300);
 
-    uint8_t p = OV7670_read_register(OV7670_REG_PID);
+    uint8_t p = OV7670_read_register(cam, OV7670_REG_PID);
     printf("pid = %d (118)\n",p);
 
-    uint8_t v = OV7670_read_register(OV7670_REG_VER);
+    uint8_t v = OV7670_read_register(cam, OV7670_REG_VER);
     printf("ver = %d (115)\n",v);
 }
 
+// program the output size, scaling and window for one of the VGA divisions.
+// the ROI goes back to the whole image, or the middle of it if the whole image is too big
+// for the buffers, so the larger sizes can still be used with camera_set_roi().
+// refused while a setSaveImage(cam, 1) capture is pending, the DMA is armed for the old size.
+// a stream that was running carries on at the new size, the frame being captured is dropped
+bool camera_set_resolution(camera_t *cam, OV7670_size size){
+    if (size > OV7670_SIZE_DIV16 || getSaveImage(cam)){
+        return false;
+    }
+    uint16_t w = 640 >> size;
+    uint16_t h = 480 >> size;
+    // the stream is stopped while the registers change and started again after
+    bool streaming = atomic_load_explicit(&cam->streaming, memory_order_relaxed);
+    if (streaming){
+        stopStream(cam);
+    }
+
+    // Read current SCALING_XSC and SCALING_YSC register values because
+    // test pattern settings are also stored in those registers and we
+    // don't want to corrupt anything there.
+    uint8_t xsc = OV7670_read_register(cam, OV7670_REG_SCALING_XSC);
+    uint8_t ysc = OV7670_read_register(cam, OV7670_REG_SCALING_YSC);
+
+    // the capture and processing code follows the new geometry from the next frame on
+    cam->size = size;
+    camRoiDefault(&cam->roi, w, h, CAM_MAX_SIZEX, CAM_MAX_SIZEY);
+
+    // collected and sent in one go, see camregs.c
+    uint8_t regs[CAMREGS_RESOLUTION_MAX][2];
+    camRegsResolution(regs, size, xsc, ysc, &cam->roi);
+    OV7670_write_table(cam, regs);
+
+    cam->sizeX = cam->roi.w;
+    cam->sizeY = cam->roi.h;
+    if (streaming){
+        startStream(cam);
+    }
+    return true;
+}
+
+// only store the w by h pixels starting at column x, row y of the current resolution.
+// w must be a multiple of 4 and the window must fit in CAM_MAX_SIZEX by CAM_MAX_SIZEY.
+// getImageSizeX/Y() and everything that works on cam->data then see just the window.
+// refused while a setSaveImage(cam, 1) capture is pending, like camera_set_resolution().
+// a stream that was running carries on with the new window
+bool camera_set_roi(camera_t *cam, uint16_t x, uint16_t y, uint16_t w, uint16_t h){
+    camRoi_t roi = cam->roi;
+    if (getSaveImage(cam) || !camRoiSet(&roi, cam->roi.fullX, cam->roi.fullY, x, y, w, h, CAM_MAX_SIZEX, CAM_MAX_SIZEY)){
+        return false;
+    }
+    bool streaming = atomic_load_explicit(&cam->streaming, memory_order_relaxed);
+    if (streaming){
+        stopStream(cam);
+    }
+    cam->roi = roi;
+
+    uint8_t regs[4][2];
+    camRegsEnd(regs, camRegsWindowRows(regs, 0, cam->size, &cam->roi));
+    OV7670_write_table(cam, regs);
+
+    cam->sizeX = w;
+    cam->sizeY = h;
+    if (streaming){
+        startStream(cam);
+    }
+    return true;
+}
+
+// switch between RGB565 and luma only capture, see CAM_FORMAT_RGB565 and CAM_FORMAT_LUMA.
+// the first frame after a switch may still be in the old format.
+// refused while a setSaveImage(cam, 1) capture is pending, stopping the SM for the new program
+// would leave it unfinished and waitImage() waiting forever. a stream that was running carries on
+bool camera_set_format(camera_t *cam, int format){
+    if ((format != CAM_FORMAT_RGB565 && format != CAM_FORMAT_LUMA) || getSaveImage(cam)){
+        return false;
+    }
+    bool streaming = atomic_load_explicit(&cam->streaming, memory_order_relaxed);
+    if (streaming){
+        stopStream(cam);
+    }
+    OV7670_write_table(cam, format == CAM_FORMAT_LUMA ? OV7670_yuv : OV7670_rgb);
+
+    cam->format = format;
+    cam->bpp = (format == CAM_FORMAT_LUMA) ? 1 : 2;
+    pio_sm_set_enabled(cam->pio, cam->sm, false);
+    cam_select_program(cam);
+    if (streaming){
+        startStream(cam);
+    }
+    return true;
+}
+
+// current image width in pixels, the ROI width
+uint32_t getImageSizeX(camera_t *cam){
+    return cam->sizeX;
+}
+
+// current image height in pixels, the ROI height
+uint32_t getImageSizeY(camera_t *cam){
+    return cam->sizeY;
+}
+
 // Selects one of the camera's test patterns (or disable).
 // See Adafruit_OV7670.h for notes about minor visual bug here.
-void OV7670_test_pattern(OV7670_pattern pattern) {
+void OV7670_test_pattern(camera_t *cam, OV7670_pattern pattern) {
     // Read current SCALING_XSC and SCALING_YSC register settings,
     // so image scaling settings aren't corrupted.
-    uint8_t xsc = OV7670_read_register(OV7670_REG_SCALING_XSC);
-    uint8_t ysc = OV7670_read_register(OV7670_REG_SCALING_YSC);
+    uint8_t xsc = OV7670_read_register(cam, OV7670_REG_SCALING_XSC);
+    uint8_t ysc = OV7670_read_register(cam, OV7670_REG_SCALING_YSC);
     if (pattern & 1) {
       xsc |= 0x80;
     } else {
@@ -248,65 +404,261 @@ void OV7670_test_pattern(OV7670_pattern pattern) {
       ysc &= ~0x80;
     }
     // Write modified results back to SCALING_XSC and SCALING_YSC registers
-    OV7670_write_register(OV7670_REG_SCALING_XSC, xsc);
-    OV7670_write_register(OV7670_REG_SCALING_YSC, ysc);
+    OV7670_write_register(cam, OV7670_REG_SCALING_XSC, xsc);
+    OV7670_write_register(cam, OV7670_REG_SCALING_YSC, ysc);
   }
 
 // I2C write to the camera
-void OV7670_write_register(uint8_t reg, uint8_t value){
+void OV7670_write_register(camera_t *cam, uint8_t reg, uint8_t value){
     uint8_t buf[2];
     buf[0] = reg;
     buf[1] = value;
-    i2c_write_blocking(I2C_PORT, OV7670_ADDR, buf, 2, false);
-    sleep_ms(1); // after each
+    i2c_write_blocking(cam->i2c, OV7670_ADDR, buf, 2, false);
+}
+
+_Static_assert(CAMREGS_SCCB_STOP == I2C_IC_DATA_CMD_STOP_BITS, "camRegsSccb() stop bit");
+
+// I2C write a whole {reg, value} table ending in {0xff, 0xff}.
+// SCCB needs a stop after every register, so each pair is queued as its own
+// transaction and the camera's SCCB DMA channel feeds them to the I2C TX FIFO back to back.
+// returns the number of registers written, or -1 if the camera did not ack, the table
+// is too long or there is no DMA channel
+int OV7670_write_table(camera_t *cam, const uint8_t table[][2]){
+    if (cam->sccbDma < 0){
+        return -1;
+    }
+    int n = camRegsSccb(table, cam->sccbCmds, OV7670_MAX_TABLE);
+    if (n <= 0){
+        return n;
+    }
+
+    i2c_hw_t *hw = i2c_get_hw(cam->i2c);
+    hw->enable = 0;
+    hw->tar = OV7670_ADDR;
+    hw->enable = 1;
+    hw->dma_cr = I2C_IC_DMA_CR_TDMAE_BITS;
+
+    int chan = cam->sccbDma;
+    dma_channel_config c = dma_channel_get_default_config(chan);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_16);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, i2c_get_dreq(cam->i2c, true));
+    dma_channel_configure(chan, &c, &hw->data_cmd, cam->sccbCmds, 2*n, true);
+
+    // 2 bytes + address per register at 400kHz is ~70us, give it plenty of time
+    absolute_time_t timeout = make_timeout_time_ms(n);
+    bool ok = true;
+    while (dma_channel_is_busy(chan) || !(hw->status & I2C_IC_STATUS_TFE_BITS) || (hw->status & I2C_IC_STATUS_ACTIVITY_BITS)){
+        if ((hw->raw_intr_stat & I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS) || time_reached(timeout)){
+            ok = false;
+            break;
+        }
+        tight_loop_contents();
+    }
+    if (!ok){
+        dma_channel_abort(chan); // no interrupt on this channel, nothing to mask
+    }
+    hw->dma_cr = 0;
+    if (hw->raw_intr_stat & I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS){
+        hw->clr_tx_abrt; // reading clears the abort and releases the TX FIFO
+        ok = false;
+    }
+    return ok ? n : -1;
+}
+
+// read back every register of a {0xff, 0xff} terminated table.
+// some registers are changed by the camera itself (AEC/AGC/AWB), so a few mismatches are normal.
+// returns how many registers did not match
+int OV7670_verify_table(camera_t *cam, const uint8_t table[][2]){
+    int bad = 0;
+    int i;
+    for(i=0; i<OV7670_MAX_TABLE && table[i][0] != 0xff; i++){
+        uint8_t v = OV7670_read_register(cam, table[i][0]);
+        if (v != table[i][1]){
+            printf("reg 0x%02X = 0x%02X, wrote 0x%02X\n", table[i][0], v, table[i][1]);
+            bad++;
+        }
+    }
+    return bad;
 }
 
 // I2C read from the camera
-uint8_t OV7670_read_register(uint8_t reg){
+uint8_t OV7670_read_register(camera_t *cam, uint8_t reg){
     uint8_t buf;
-    i2c_write_blocking(I2C_PORT, OV7670_ADDR, &reg, 1, false);  // true to keep master control of bus
-    i2c_read_blocking(I2C_PORT, OV7670_ADDR, &buf, 1, false);  // false - finished with bus
+    i2c_write_blocking(cam->i2c, OV7670_ADDR, &reg, 1, false);  // true to keep master control of bus
+    i2c_read_blocking(cam->i2c, OV7670_ADDR, &buf, 1, false);  // false - finished with bus
     return buf;
 }
 
-// save an image
-void setSaveImage(uint32_t s){
-    saveImage = s;
+// save an image, starts the PIO and DMA for one frame
+void setSaveImage(camera_t *cam, uint32_t s){
+    if (atomic_load_explicit(&cam->streaming, memory_order_relaxed)){
+        stopStream(cam);
+    }
+    atomic_store_explicit(&cam->saveImage, s, memory_order_relaxed);
+    if (s){
+        cam->data = cam->buffers[0];
+        cam_arm_capture(cam, cam->data);
+    }
+    else {
+        cam_abort_capture(cam);
+    }
+}
+
+// block until the image asked for with setSaveImage() is in cam->data
+void waitImage(camera_t *cam){
+    while (getSaveImage(cam)){
+        tight_loop_contents();
+    }
+}
+
+// capture continuously, rotating through CAM_NUM_BUFFERS buffers
+void startStream(camera_t *cam){
+    stopStream(cam);
+    camRingInit(&cam->ring);
+    atomic_store_explicit(&cam->streaming, 1, memory_order_relaxed);
+    cam_arm_capture(cam, cam->buffers[camRingFill(&cam->ring)]);
+}
+
+// stop continuous capture, the frame in cam->data stays valid
+void stopStream(camera_t *cam){
+    atomic_store_explicit(&cam->streaming, 0, memory_order_relaxed);
+    cam_abort_capture(cam);
+}
+
+// wait for the newest finished frame and point cam->data at it.
+// the previous frame goes back to the capture rotation. returns the frame sequence number
+uint32_t getFrame(camera_t *cam){
+    int buf;
+    // lock free, the interrupt only ever swaps the middle buffer, see camring.h
+    while (!camRingTake(&cam->ring, &buf, &cam->heldSeq)){
+        tight_loop_contents();
+    }
+    cam->data = cam->buffers[buf];
+    return cam->heldSeq;
+}
+
+// sequence number of the frame in cam->data
+uint32_t getFrameSeq(camera_t *cam){
+    return cam->heldSeq;
 }
 
-// see if you are supposed to be saving an image
-uint32_t getSaveImage(){
-    return saveImage;
+// frames that were captured but replaced before getFrame() picked them up
+uint32_t getDroppedFrames(camera_t *cam){
+    return camRingDropped(&cam->ring);
 }
 
-// how many rows were counted, should be IMAGESIZEY
-uint32_t getHSCount(){
-    return hsCount;
+// see if you are supposed to be saving an image.
+// acquire pairs with the release in camera_frame_done(), once this reads 0 the frame is all there
+uint32_t getSaveImage(camera_t *cam){
+    return atomic_load_explicit(&cam->saveImage, memory_order_acquire);
 }
 
-// how many pixels were counted times 2, should be 2*IMAGESIZEX*IMAGESIZEY
-uint32_t getPixelCount(){
-    return rawIndex;
+// how many rows were counted, should be getImageSizeY()
+uint32_t getHSCount(camera_t *cam){
+    if (getSaveImage(cam)){
+        return getPixelCount(cam) / (cam->sizeX*cam->bpp);
+    }
+    return cam->hsCount;
+}
+
+// how many bytes were captured, should be getImageSizeX()*getImageSizeY() times 2 for RGB565 or 1 for luma
+uint32_t getPixelCount(camera_t *cam){
+    if (getSaveImage(cam)){
+        // still capturing, work it out from what the DMA has left to do
+        return cam_bytes(cam);
+    }
+    return cam->rawIndex;
+}
+
+// print the capture telemetry, see camstats.h
+void camera_print_stats(camera_t *cam){
+#if CAM_TELEMETRY
+    camStats_t copy;
+    // take a copy so the interrupts can't change it halfway through printing
+    uint32_t irq = save_and_disable_interrupts();
+    copy = cam->stats;
+    restore_interrupts(irq);
+    camStatsPrint(&copy);
+#else
+    printf("telemetry is off, set CAM_TELEMETRY\r\n");
+#endif
+}
+
+// start the telemetry counts and histograms over
+void camera_reset_stats(camera_t *cam){
+#if CAM_TELEMETRY
+    uint32_t irq = save_and_disable_interrupts();
+    camStatsInit(&cam->stats);
+    restore_interrupts(irq);
+#endif
+}
+
+// turn the firmware exposure control on or off. it starts from whatever the sensor is set to now
+void camera_set_auto_exposure(camera_t *cam, bool on){
+    if (on && !cam->aeOn){
+        uint8_t com1 = OV7670_read_register(cam, OV7670_REG_COM1);
+        uint16_t exposure = ((OV7670_read_register(cam, OV7670_REG_AECHH) & 0x3F) << 10)
+            | (OV7670_read_register(cam, OV7670_REG_AECH) << 2) | (com1 & 0b11);
+        uint8_t gain = OV7670_read_register(cam, OV7670_REG_GAIN);
+        camAeInit(&cam->ae, exposure, camAeGainValue(gain));
+        cam->ae.com1 = com1 & ~0b11;
+    }
+    cam->aeOn = on;
+}
+
+// call once per frame, after getFrame() or waitImage(), with the frame in cam->data.
+// the histogram is a few hundred pixels, and the registers are only written every few
+// frames when something has to change: 4 registers over DMA I2C, about 0.3ms.
+// capture keeps running in the PIO and DMA meanwhile, the new values show up a frame or two later
+void camera_auto_exposure(camera_t *cam){
+    if (!cam->aeOn){
+        return;
+    }
+    camAeMeasure(&cam->ae, cam->data, cam->sizeX, cam->sizeY, cam->format == CAM_FORMAT_LUMA);
+    if (!camAeUpdate(&cam->ae)){
+        return;
+    }
+    // gain stays in GAIN only, VREF holds the ROI rows so its gain bits are left at 0
+    uint8_t regs[5][2] = {
+        {OV7670_REG_GAIN, camAeGainCode(cam->ae.gain)},
+        {OV7670_REG_AECHH, (cam->ae.exposure >> 10) & 0x3F},
+        {OV7670_REG_AECH, (cam->ae.exposure >> 2) & 0xFF},
+        {OV7670_REG_COM1, cam->ae.com1 | (cam->ae.exposure & 0b11)},
+        {0xff, 0xff},
+    };
+    OV7670_write_table(cam, regs);
 }
 
 // convert the raw image to RGB
 // https://blog.usedbytes.com/2022/02/pico-pio-camera/
-void convertImage(){
-    picture.index = 0;
+void convertImage(camera_t *cam){
+    cam->picture.index = 0;
     int i = 0;
-    for(i=0;i<IMAGESIZEX*IMAGESIZEY*2;i=i+2){
+    if (cam->format == CAM_FORMAT_LUMA){
+        // gray, so findLine() and printImage() work the same
+        for(i=0;i<cam->sizeX*cam->sizeY;i++){
+            cam->picture.r[i] = cam->data[i];
+            cam->picture.g[i] = cam->data[i];
+            cam->picture.b[i] = cam->data[i];
+        }
+        cam->picture.index = i;
+        return;
+    }
+    for(i=0;i<cam->sizeX*cam->sizeY*2;i=i+2){
         
-        picture.r[picture.index] = (cameraData[i+1]>>3)<<3;
-        picture.g[picture.index] = (((cameraData[i+1]&0b111)<<3) | cameraData[i]>>5)<<2;
-        picture.b[picture.index] = (cameraData[i]&0b11111)<<3;
-        picture.index++;
+        cam->picture.r[cam->picture.index] = (cam->data[i+1]>>3)<<3;
+        cam->picture.g[cam->picture.index] = (((cam->data[i+1]&0b111)<<3) | cam->data[i]>>5)<<2;
+        cam->picture.b[cam->picture.index] = (cam->data[i]&0b11111)<<3;
+        cam->picture.index++;
     }
 }
 
 // threshold and then find the center of mass of a row
-int findLine(int row){
+int findLine(camera_t *cam, int row){
     int pos = 0;
-    int r = row*IMAGESIZEX; // find the index of the start of the row in the pixel array
+    int r = row*cam->sizeX; // find the index of the start of the row in the pixel array
     int sumMass = 0;
     int sumMassR = 0;
 
@@ -314,31 +666,31 @@ int findLine(int row){
 
     // find the row average brightness
     int sumBright = 0;
-    for(i=0;i<IMAGESIZEX;i++){
-        sumBright = sumBright + picture.r[r+i] + picture.g[r+i] + picture.b[r+i];
+    for(i=0;i<cam->sizeX;i++){
+        sumBright = sumBright + cam->picture.r[r+i] + cam->picture.g[r+i] + cam->picture.b[r+i];
     }
-    int avgBright = sumBright / IMAGESIZEX;
+    int avgBright = sumBright / cam->sizeX;
 
     // threshold the row
-    for(i=0;i<IMAGESIZEX;i++){
-        int mass = picture.r[r+i] + picture.g[r+i] + picture.b[r+i];
+    for(i=0;i<cam->sizeX;i++){
+        int mass = cam->picture.r[r+i] + cam->picture.g[r+i] + cam->picture.b[r+i];
         if (mass < avgBright){
             // not bright enough, set pixel to black
-            picture.r[r+i] = 0;
-            picture.g[r+i] = 0;
-            picture.b[r+i] = 0;
+            cam->picture.r[r+i] = 0;
+            cam->picture.g[r+i] = 0;
+            cam->picture.b[r+i] = 0;
         }
         else {
             // set to white
-            picture.r[r+i] = 255;
-            picture.g[r+i] = 255;
-            picture.b[r+i] = 255;
+            cam->picture.r[r+i] = 255;
+            cam->picture.g[r+i] = 255;
+            cam->picture.b[r+i] = 255;
         }
     }
 
     // calculate the center of mass of the thresholded row
-    for(i=0;i<IMAGESIZEX;i++){
-        int mass = picture.r[r+i] + picture.g[r+i] + picture.b[r+i];
+    for(i=0;i<cam->sizeX;i++){
+        int mass = cam->picture.r[r+i] + cam->picture.g[r+i] + cam->picture.b[r+i];
         sumMass = sumMass + mass;
         sumMassR = sumMassR + mass*i;
     }
@@ -346,18 +698,76 @@ int findLine(int row){
     return (int)(centerOfMass);
 }
 
+// the frame in cam->data, for the line finding in linefind.c
+static camFrame_t cam_frame(camera_t *cam){
+    camFrame_t f;
+    f.data = cam->data;
+    f.sizeX = cam->sizeX;
+    f.sizeY = cam->sizeY;
+    f.bpp = cam->bpp;
+    return f;
+}
+
+// same result as convertImage() then findLine(row), see frameFindLine()
+int findLineRaw(camera_t *cam, int row){
+    camFrame_t f = cam_frame(cam);
+    return frameFindLine(&f, row);
+}
+
+// fit the line over several rows, see frameTrackLine()
+void trackLine(camera_t *cam, const int *rows, int nrows, lineTrack_t *t){
+    camFrame_t f = cam_frame(cam);
+    frameTrackLine(&f, rows, nrows, t);
+}
+
 // change the color of a pixel for visualization purposes
-void setPixel(int row, int col, uint8_t r, uint8_t g, uint8_t b){
-    int index = row*IMAGESIZEX+col;
-    picture.r[index] = r;
-    picture.g[index] = g;
-    picture.b[index] = b;
+void setPixel(camera_t *cam, int row, int col, uint8_t r, uint8_t g, uint8_t b){
+    int index = row*cam->sizeX+col;
+    cam->picture.r[index] = r;
+    cam->picture.g[index] = g;
+    cam->picture.b[index] = b;
 }
 
 // print out the image to computer
-void printImage(){
+void printImage(camera_t *cam){
     int i = 0;
-    for(i=0;i<IMAGESIZEX*IMAGESIZEY;i++){
-        printf("%d %d %d %d\r\n", i, picture.r[i], picture.g[i], picture.b[i]);
+    for(i=0;i<cam->sizeX*cam->sizeY;i++){
+        printf("%d %d %d %d\r\n", i, cam->picture.r[i], cam->picture.g[i], cam->picture.b[i]);
+    }
+}
+
+// framelink.c's bytes out over USB, raw so stdio doesn't turn \n into \r\n
+static void usbSink(const uint8_t *data, int len){
+    stdio_put_string((const char *)data, len, false, false);
+}
+
+// send the raw RGB565 or luma frame in cam->data as one binary frame, see framelink.h
+void sendImage(camera_t *cam, uint8_t flags){
+    frameTx_t f;
+    uint8_t format = (cam->format == CAM_FORMAT_LUMA) ? FRAME_LUMA : FRAME_RGB565;
+    frameTxBegin(&f, usbSink, format, flags, cam->sizeX, cam->sizeY, cam->heldSeq);
+    frameTxWrite(&f, cam->data, cam->sizeX*cam->sizeY*cam->bpp);
+    frameTxEnd(&f);
+}
+
+// threshold cam->data into packed bits, see frameThreshold()
+void thresholdImage(camera_t *cam, binImage_t *img){
+    camFrame_t f = cam_frame(cam);
+    frameThreshold(&f, img);
+}
+
+// threshold every row against its mean like findLine() and send 1 bit per pixel
+void sendBinaryImage(camera_t *cam, uint8_t flags){
+    frameTx_t f;
+    uint8_t bits[(CAM_MAX_SIZEX+7)/8];
+    int rowBytes = (cam->sizeX+7)/8;
+    int row;
+
+    thresholdImage(cam, &cam->binary);
+    frameTxBegin(&f, usbSink, FRAME_BINARY, flags, cam->sizeX, cam->sizeY, cam->heldSeq);
+    for(row=0;row<cam->sizeY;row++){
+        binRowBytes(&cam->binary, row, bits);
+        frameTxWrite(&f, bits, rowBytes);
     }
+    frameTxEnd(&f);
 }
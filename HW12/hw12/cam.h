@@ -2,11 +2,25 @@
 #define CAM_h
 
 #include <stdio.h>
+#include <math.h>
+#include <stdatomic.h>
 #include "pico/stdlib.h"
 #include "hardware/i2c.h"
 #include "hardware/gpio.h"
 #include "hardware/pwm.h"
+#include "hardware/pio.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
 #include "ov7670.h"
+#include "framelink.h"
+#include "camstats.h"
+#include "camroi.h"
+#include "camexposure.h"
+#include "binimage.h"
+#include "linefind.h"
+#include "camring.h"
+#include "camregs.h"
 
 // I2C defines
 #define I2C_PORT i2c1
@@ -36,40 +50,128 @@
 // PWDN to GP13
 #define PWDN 13
 
+// startup delays. the datasheet only asks for 1ms after reset, these leave some margin
+#define CAM_SETTLE_MS 10 // after starting MCLK and after powerdown
+#define CAM_RESET_MS 10 // after hardware and software reset
+#define CAM_CONFIG_SETTLE_MS 100 // after the register tables, lets AEC/AWB catch up
+// 1 to read back and print the init tables after writing them
+#define CAM_VERIFY_REGISTERS 0
+
+// capture is done by a PIO state machine, bytes are moved into the frame buffers by DMA
+#define CAM_PIO pio0
+#define CAM_DMA_IRQ DMA_IRQ_0
+#define CAM_MAX_CAMERAS 2 // cameras sharing the DMA interrupt
+// 1 to time every frame and check rows and row lengths, costs one interrupt per row
+#define CAM_TELEMETRY 1
+
+// pixel formats, camera_set_format() switches at runtime
+#define CAM_FORMAT_RGB565 0 // 2 bytes per pixel
+#define CAM_FORMAT_LUMA 1 // sensor sends YUV422, only the Y byte is kept, 1 byte per pixel
+
 // RGB565 example:
 // https://blog.usedbytes.com/2022/02/pico-pio-camera/
 
-void init_camera_pins();
-void init_camera();
-void setSaveImage(uint32_t);
-uint32_t getSaveImage();
-uint32_t getHSCount();
-uint32_t getPixelCount();
-void convertImage();
-void printImage();
-int findLine(int row);
-void setPixel(int row, int col, uint8_t r, uint8_t g, uint8_t b);
-
-static volatile uint8_t saveImage = 0; // user requests image
-static volatile uint8_t startImage = 0; // got a start of frame
-static volatile uint8_t startCollect = 0; // got a start of row
-static volatile uint32_t rawIndex = 0;
-static volatile uint32_t hsCount = 0;
-static volatile uint32_t vsCount = 0;
-#define IMAGESIZEX 80
-#define IMAGESIZEY 60
-static volatile uint8_t cameraData[IMAGESIZEX*IMAGESIZEY*2];
+// largest image the buffers can hold, camera_set_resolution() picks the size at runtime.
+// bigger sizes work too, with camera_set_roi() picking the part that is stored
+#define CAM_MAX_SIZEX 160
+#define CAM_MAX_SIZEY 120
+// in stream mode the sensor fills one buffer, the newest frame waits in another and the
+// application works on the third, see camring.h
+#define CAM_NUM_BUFFERS CAMRING_BUFFERS
 
 typedef struct cameraImage{
     uint32_t index;
-    uint8_t r[IMAGESIZEX*IMAGESIZEY];
-    uint8_t g[IMAGESIZEX*IMAGESIZEY];
-    uint8_t b[IMAGESIZEX*IMAGESIZEY];
+    uint8_t r[CAM_MAX_SIZEX*CAM_MAX_SIZEY];
+    uint8_t g[CAM_MAX_SIZEX*CAM_MAX_SIZEY];
+    uint8_t b[CAM_MAX_SIZEX*CAM_MAX_SIZEY];
 } cameraImage_t;
-static volatile struct cameraImage picture;
+
+// everything one camera needs, pass it to every function below.
+// fill it with camera_init_config() and change the pins/peripherals before init_camera_pins()
+typedef struct camera{
+    // configuration
+    i2c_inst_t *i2c;
+    uint sda, scl;
+    uint pinBase; // D0, the rest follow in the same order as GP0-GP11
+    uint rst, pwdn;
+    PIO pio;
+
+    // capture hardware, claimed in init_camera_pins()
+    uint sm;
+    uint offset; // cam program
+    uint offsetLuma; // cam_luma program
+    int dma;
+
+    // register writes, see OV7670_write_table()
+    int sccbDma; // claimed in init_camera(), -1 if there was none free
+    uint16_t sccbCmds[2*OV7670_MAX_TABLE];
+
+    // image geometry
+    OV7670_size size;
+    camRoi_t roi; // part of the sensor image that is stored
+    uint16_t sizeX, sizeY; // stored image, the ROI size
+    int format; // CAM_FORMAT_RGB565 or CAM_FORMAT_LUMA
+    int bpp; // bytes stored per pixel, 2 or 1
+
+    // DMA writes whole words, so the frames must be word aligned and a multiple of 4 bytes
+    uint8_t buffers[CAM_NUM_BUFFERS][CAM_MAX_SIZEX*CAM_MAX_SIZEY*2] __attribute__((aligned(4)));
+    uint8_t *data; // the frame being processed
+
+    // handoff between the DMA interrupt and the main loop, see camera_frame_done()
+    atomic_int saveImage; // user requests image, cleared when the frame is done
+    atomic_int streaming;
+    camRing_t ring; // stream mode buffers
+    uint32_t rawIndex;
+    uint32_t hsCount;
+    uint32_t heldSeq; // frame in data
+    camStats_t stats; // written from the VS/HS and DMA interrupts
+
+    // firmware exposure control, see camera_auto_exposure()
+    bool aeOn;
+    camAe_t ae;
+
+    cameraImage_t picture;
+    binImage_t binary; // thresholded by thresholdImage(), 1 bit per pixel
+} camera_t;
+
+void camera_init_config(camera_t *cam);
+void init_camera_pins(camera_t *cam);
+void init_camera(camera_t *cam);
+bool camera_set_resolution(camera_t *cam, OV7670_size size);
+bool camera_set_format(camera_t *cam, int format);
+bool camera_set_roi(camera_t *cam, uint16_t x, uint16_t y, uint16_t w, uint16_t h);
+uint32_t getImageSizeX(camera_t *cam);
+uint32_t getImageSizeY(camera_t *cam);
+void camera_frame_done(camera_t *cam, uint32_t bytes);
+void setSaveImage(camera_t *cam, uint32_t s);
+uint32_t getSaveImage(camera_t *cam);
+void waitImage(camera_t *cam);
+uint32_t getHSCount(camera_t *cam);
+uint32_t getPixelCount(camera_t *cam);
+void camera_print_stats(camera_t *cam);
+void camera_reset_stats(camera_t *cam);
+void camera_set_auto_exposure(camera_t *cam, bool on);
+void camera_auto_exposure(camera_t *cam);
+void startStream(camera_t *cam);
+void stopStream(camera_t *cam);
+uint32_t getFrame(camera_t *cam);
+uint32_t getFrameSeq(camera_t *cam);
+uint32_t getDroppedFrames(camera_t *cam);
+void convertImage(camera_t *cam);
+void printImage(camera_t *cam);
+void sendImage(camera_t *cam, uint8_t flags);
+void sendBinaryImage(camera_t *cam, uint8_t flags);
+void thresholdImage(camera_t *cam, binImage_t *img);
+int findLine(camera_t *cam, int row);
+int findLineRaw(camera_t *cam, int row);
+void trackLine(camera_t *cam, const int *rows, int nrows, lineTrack_t *t);
+void setPixel(camera_t *cam, int row, int col, uint8_t r, uint8_t g, uint8_t b);
+
 // I2C functions
-void OV7670_write_register(uint8_t reg, uint8_t value);
-uint8_t OV7670_read_register(uint8_t reg);
-void OV7670_test_pattern(OV7670_pattern pattern);
+void OV7670_write_register(camera_t *cam, uint8_t reg, uint8_t value);
+int OV7670_write_table(camera_t *cam, const uint8_t table[][2]);
+int OV7670_verify_table(camera_t *cam, const uint8_t table[][2]);
+uint8_t OV7670_read_register(camera_t *cam, uint8_t reg);
+void OV7670_test_pattern(camera_t *cam, OV7670_pattern pattern);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,145 @@
+#include "camexposure.h"
+
+void camAeInit(camAe_t *ae, uint16_t exposure, uint16_t gain){
+    int i;
+    ae->target = 110;
+    ae->deadband = 8;
+    ae->settleFrames = 2;
+    ae->expMin = 1;
+    ae->expMax = 500; // a little under one frame of rows
+    ae->gainMax = 16*16;
+
+    ae->exposure = exposure;
+    ae->gain = camAeGainValue(camAeGainCode(gain));
+    ae->com1 = 0;
+    ae->wait = 0;
+    ae->mean = 0;
+    ae->clipped = 0;
+    ae->samples = 0;
+    ae->changes = 0;
+    for(i=0;i<CAMAE_BINS;i++){
+        ae->hist[i] = 0;
+    }
+}
+
+// brightness histogram of a sparse grid of pixels, RGB565 is scored as (r+g+b)/3 like findLine()
+void camAeMeasure(camAe_t *ae, const uint8_t *data, int sizeX, int sizeY, bool luma){
+    int bpp = luma ? 1 : 2;
+    uint32_t sum = 0;
+    uint32_t n = 0;
+    int row, i;
+    for(i=0;i<CAMAE_BINS;i++){
+        ae->hist[i] = 0;
+    }
+    for(row=CAMAE_STEP/2;row<sizeY;row=row+CAMAE_STEP){
+        const uint8_t *p = data + row*sizeX*bpp;
+        for(i=CAMAE_STEP/2;i<sizeX;i=i+CAMAE_STEP){
+            int v;
+            if (luma){
+                v = p[i];
+            }
+            else {
+                uint8_t lo = p[2*i];
+                uint8_t hi = p[2*i+1];
+                v = (((hi>>3)<<3) + ((((hi&0b111)<<3) | (lo>>5))<<2) + ((lo&0b11111)<<3)) / 3;
+            }
+            ae->hist[v >> 4]++;
+            sum = sum + v;
+            n++;
+        }
+    }
+    ae->samples = n;
+    ae->mean = n ? sum / n : 0;
+    ae->clipped = ae->hist[CAMAE_BINS-1];
+}
+
+// decide on a new exposure and gain from the last measurement.
+// returns true if they changed and the registers need writing
+bool camAeUpdate(camAe_t *ae){
+    if (ae->wait){
+        ae->wait--;
+        return false;
+    }
+    if (ae->samples == 0){
+        return false;
+    }
+
+    int mean = ae->mean ? ae->mean : 1;
+    int err = mean - ae->target;
+    bool tooClipped = ae->clipped * 4 > ae->samples; // a quarter of the image is blown out
+    if (err >= -ae->deadband && err <= ae->deadband && !tooClipped){
+        return false;
+    }
+
+    // total light is exposure * gain, scale it by target/mean, at most 2x either way per step
+    float ratio = (float)ae->target / mean;
+    if (ratio > 2.0f){
+        ratio = 2.0f;
+    }
+    if (ratio < 0.5f){
+        ratio = 0.5f;
+    }
+    if (tooClipped && ratio > 0.8f){
+        ratio = 0.8f;
+    }
+    float total = (float)ae->exposure * ae->gain * ratio;
+
+    // exposure first at 1x gain, then gain for whatever exposure can't reach
+    float exp = total / 16;
+    if (exp < ae->expMin){
+        exp = ae->expMin;
+    }
+    if (exp > ae->expMax){
+        exp = ae->expMax;
+    }
+    uint16_t exposure = exp + 0.5f;
+    float gain = total / exposure;
+    if (gain < 16){
+        gain = 16;
+    }
+    if (gain > ae->gainMax){
+        gain = ae->gainMax;
+    }
+    uint16_t g = camAeGainValue(camAeGainCode(gain + 0.5f));
+
+    if (exposure == ae->exposure && g == ae->gain){
+        // already at a limit
+        return false;
+    }
+    ae->exposure = exposure;
+    ae->gain = g;
+    ae->wait = ae->settleFrames;
+    ae->changes++;
+    return true;
+}
+
+// OV7670 GAIN register for a gain (16 is 1x). gain = (GAIN[7]+1)*(GAIN[6]+1)*(GAIN[5]+1)*(GAIN[4]+1)*(1+GAIN[3:0]/16),
+// so each of the top bits doubles it and the low nibble fills in between. 1x to just under 32x
+uint8_t camAeGainCode(uint16_t gain){
+    uint8_t code = 0;
+    int bit = 4;
+    if (gain < 16){
+        gain = 16;
+    }
+    while (gain >= 32 && bit < 8){
+        code |= 1 << bit;
+        gain = gain / 2;
+        bit++;
+    }
+    if (gain > 31){
+        gain = 31;
+    }
+    return code | (gain - 16);
+}
+
+// the gain a GAIN register value gives, 16 is 1x
+uint16_t camAeGainValue(uint8_t code){
+    uint16_t gain = 16 + (code & 0x0F);
+    int bit;
+    for(bit=4;bit<8;bit++){
+        if (code & (1 << bit)){
+            gain = gain * 2;
+        }
+    }
+    return gain;
+}
@@ -0,0 +1,42 @@
+#ifndef CAMEXPOSURE_h
+#define CAMEXPOSURE_h
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Exposure and gain control in firmware, instead of the sensor's own AEC/AGC (off in OV7670_init).
+// Every frame a sparse brightness histogram is taken from the stored image, and every few
+// frames the exposure time and gain are nudged so the mean brightness sits at the target.
+// Exposure is used first since it adds no noise, gain only once exposure is at its limit.
+// No pico calls in here, cam.c reads and writes the registers.
+
+#define CAMAE_BINS 16
+#define CAMAE_STEP 4 // only every 4th pixel of every 4th row is looked at
+
+typedef struct camAe{
+    // settings, camAeInit() fills in defaults
+    uint8_t target; // mean brightness to aim for, 0-255
+    uint8_t deadband; // leave it alone while the mean is this close
+    uint8_t settleFrames; // frames for a change to show up before measuring again
+    uint16_t expMin, expMax; // exposure limits, sensor rows
+    uint16_t gainMax; // gain limit, 16 is 1x
+
+    // state
+    uint16_t exposure; // sensor rows
+    uint16_t gain; // 16 is 1x, always one the sensor can do exactly, see camAeGainCode()
+    uint8_t com1; // COM1 bits that are not exposure, kept when COM1 is written
+    uint8_t wait; // frames left to settle
+    uint8_t mean; // last measured mean brightness
+    uint32_t clipped; // samples in the top bin last frame
+    uint32_t samples;
+    uint32_t changes; // how many times the registers were changed
+    uint32_t hist[CAMAE_BINS];
+} camAe_t;
+
+void camAeInit(camAe_t *ae, uint16_t exposure, uint16_t gain);
+void camAeMeasure(camAe_t *ae, const uint8_t *data, int sizeX, int sizeY, bool luma);
+bool camAeUpdate(camAe_t *ae);
+uint8_t camAeGainCode(uint16_t gain);
+uint16_t camAeGainValue(uint8_t code);
+
+#endif
@@ -0,0 +1,89 @@
+#include "camregs.h"
+
+// add one register to a table, returns the new length
+static int put(uint8_t regs[][2], int n, uint8_t reg, uint8_t value){
+    regs[n][0] = reg;
+    regs[n][1] = value;
+    return n + 1;
+}
+
+// the {0xff, 0xff} end marker, returns the number of registers before it
+int camRegsEnd(uint8_t regs[][2], int n){
+    put(regs, n, 0xff, 0xff);
+    return n;
+}
+
+// the VSTART/VSTOP registers for the ROI rows, added at n. returns the new length.
+// only the rows in the window come out of the sensor at all
+int camRegsWindowRows(uint8_t regs[][2], int n, OV7670_size size, const camRoi_t *roi){
+    uint16_t vstart, vstop;
+    camRoiRows(roi, OV7670_window[size][0], 1 << size, &vstart, &vstop);
+    n = put(regs, n, OV7670_REG_VSTART, vstart >> 2);
+    n = put(regs, n, OV7670_REG_VSTOP, vstop >> 2);
+    n = put(regs, n, OV7670_REG_VREF, ((vstop & 0b11) << 2) | (vstart & 0b11));
+    return n;
+}
+
+// output size, scaling and window for one of the VGA divisions, with the rows cut to roi.
+// xsc and ysc are what the sensor has now, their test pattern bit is kept.
+// regs needs CAMREGS_RESOLUTION_MAX entries, returns the number of registers
+int camRegsResolution(uint8_t regs[][2], OV7670_size size, uint8_t xsc, uint8_t ysc, const camRoi_t *roi){
+    uint8_t value;
+    int n = 0;
+    uint16_t hstart = OV7670_window[size][1];
+    uint16_t edge_offset = OV7670_window[size][2];
+    uint16_t pclk_delay = OV7670_window[size][3];
+
+    // Enable downsampling if sub-VGA, and zoom if 1:16 scale
+    value = (size > OV7670_SIZE_DIV1) ? OV7670_COM3_DCWEN : 0;
+    if (size == OV7670_SIZE_DIV16)
+    value |= OV7670_COM3_SCALEEN;
+    n = put(regs, n, OV7670_REG_COM3, value);
+
+    // Enable PCLK division if sub-VGA 2,4,8,16 = 0x19,1A,1B,1C
+    value = (size > OV7670_SIZE_DIV1) ? (0x18 + size) : 0;
+    n = put(regs, n, OV7670_REG_COM14, value);
+
+    // Horiz/vert downsample ratio, 1:8 max (H,V are always equal for now)
+    value = (size <= OV7670_SIZE_DIV8) ? size : OV7670_SIZE_DIV8;
+    n = put(regs, n, OV7670_REG_SCALING_DCWCTR, value * 0x11);
+
+    // Pixel clock divider if sub-VGA
+    value = (size > OV7670_SIZE_DIV1) ? (0xF0 + size) : 0x08;
+    n = put(regs, n, OV7670_REG_SCALING_PCLK_DIV, value);
+
+    // Apply 0.5 digital zoom at 1:16 size (others are downsample only)
+    value = (size == OV7670_SIZE_DIV16) ? 0x40 : 0x20; // 0.5, 1.0
+    // test pattern settings are also stored in those registers, modify only the scaling bits
+    n = put(regs, n, OV7670_REG_SCALING_XSC, (xsc & 0x80) | value);
+    n = put(regs, n, OV7670_REG_SCALING_YSC, (ysc & 0x80) | value);
+
+    // Window size is scattered across multiple registers.
+    // Horiz/vert stops can be automatically calc'd from starts.
+    // the columns stay full width, the HREF edge settings above were found by trial
+    // for the whole line, the PIO drops the columns outside the ROI instead
+    uint16_t hstop = (hstart + 640) % 784;
+    n = put(regs, n, OV7670_REG_HSTART, hstart >> 3);
+    n = put(regs, n, OV7670_REG_HSTOP, hstop >> 3);
+    n = put(regs, n, OV7670_REG_HREF, (edge_offset << 6) | ((hstop & 0b111) << 3) | (hstart & 0b111));
+    n = put(regs, n, OV7670_REG_SCALING_PCLK_DELAY, pclk_delay);
+
+    n = camRegsWindowRows(regs, n, size, roi);
+    return camRegsEnd(regs, n);
+}
+
+// the I2C data_cmd words that send a table. SCCB wants a stop after every register, so each
+// {reg, value} is a write of its own with the stop on the value byte. cmds needs 2*max words.
+// returns the number of registers, or -1 if there are more than max
+int camRegsSccb(const uint8_t table[][2], uint16_t *cmds, int max){
+    int n = 0;
+    while (table[n][0] != 0xff){
+        if (n == max){
+            return -1;
+        }
+        cmds[2*n] = table[n][0];
+        cmds[2*n+1] = table[n][1] | CAMREGS_SCCB_STOP;
+        n++;
+    }
+    return n;
+}
@@ -0,0 +1,20 @@
+#ifndef CAMREGS_h
+#define CAMREGS_h
+
+#include <stdint.h>
+#include "ov7670.h"
+#include "camroi.h"
+
+// The OV7670 register tables cam.c sends, worked out without touching the I2C.
+// Tables are {reg, value} pairs ending in {0xff, 0xff} like the ones in ov7670.h, so
+// OV7670_write_table() sends them in one go. No pico calls in here, see sim/camregs_check.c.
+
+#define CAMREGS_RESOLUTION_MAX 14 // camRegsResolution() table with its end marker
+#define CAMREGS_SCCB_STOP 0x200 // stop after this byte, the same bit as I2C_IC_DATA_CMD_STOP_BITS
+
+int camRegsResolution(uint8_t regs[][2], OV7670_size size, uint8_t xsc, uint8_t ysc, const camRoi_t *roi);
+int camRegsWindowRows(uint8_t regs[][2], int n, OV7670_size size, const camRoi_t *roi);
+int camRegsEnd(uint8_t regs[][2], int n);
+int camRegsSccb(const uint8_t table[][2], uint16_t *cmds, int max);
+
+#endif
@@ -0,0 +1,49 @@
+#include "camring.h"
+
+// call with the capture stopped
+void camRingInit(camRing_t *r){
+    int i;
+    r->fill = 0;
+    r->held = 2;
+    for(i=0;i<CAMRING_BUFFERS;i++){
+        r->seq[i] = 0;
+    }
+    r->next = 0;
+    atomic_store_explicit(&r->middle, 1, memory_order_relaxed);
+    atomic_store_explicit(&r->dropped, 0, memory_order_relaxed);
+}
+
+// capture side: the buffer to capture into
+int camRingFill(camRing_t *r){
+    return r->fill;
+}
+
+// capture side: the frame in the fill buffer is done. it becomes the newest frame and
+// the capture carries on in the buffer that was in the middle
+void camRingPublish(camRing_t *r){
+    r->seq[r->fill] = r->next++;
+    // release so the application sees the whole frame, acquire so we don't fill a buffer it still reads
+    unsigned old = atomic_exchange_explicit(&r->middle, r->fill | CAMRING_FRESH, memory_order_acq_rel);
+    if (old & CAMRING_FRESH){
+        atomic_fetch_add_explicit(&r->dropped, 1, memory_order_relaxed);
+    }
+    r->fill = old & 3;
+}
+
+// application side: swap the held buffer for the newest frame if there is one since the last take.
+// returns false and leaves *buf and *seq alone if not, the held buffer stays valid either way
+bool camRingTake(camRing_t *r, int *buf, uint32_t *seq){
+    if (!(atomic_load_explicit(&r->middle, memory_order_relaxed) & CAMRING_FRESH)){
+        return false;
+    }
+    unsigned old = atomic_exchange_explicit(&r->middle, r->held, memory_order_acq_rel);
+    r->held = old & 3;
+    *buf = r->held;
+    *seq = r->seq[r->held];
+    return true;
+}
+
+// frames that were captured but replaced before camRingTake() picked them up
+uint32_t camRingDropped(camRing_t *r){
+    return atomic_load_explicit(&r->dropped, memory_order_relaxed);
+}
@@ -0,0 +1,34 @@
+#ifndef CAMRING_h
+#define CAMRING_h
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+// Which frame buffer the capture fills and which one the application holds, in stream mode.
+// Three buffers: the DMA fills one, the newest finished frame waits in the middle one, and
+// the application works on the third. The end of a frame swaps the filled buffer into the
+// middle and carries on with whatever was there, so the capture never waits and never
+// writes into the frame the application holds. Taking a frame swaps the middle one out when
+// it is marked fresh. A frame that is replaced before anyone takes it counts as dropped.
+// Same swap as mailbox.c. No pico calls in here, see sim/camring_check.c.
+
+#define CAMRING_BUFFERS 3
+#define CAMRING_FRESH 4 // set in middle when a frame was finished since the last take
+
+typedef struct camRing{
+    atomic_uint middle; // buffer between the capture and the application, plus CAMRING_FRESH
+    uint8_t fill; // buffer being captured, only used by the capture side
+    uint8_t held; // buffer handed out, only used by the application side
+    uint32_t seq[CAMRING_BUFFERS]; // frame number of what is in each buffer
+    uint32_t next; // number of the next finished frame, capture side
+    atomic_uint dropped; // frames replaced before they were taken
+} camRing_t;
+
+void camRingInit(camRing_t *r);
+int camRingFill(camRing_t *r);
+void camRingPublish(camRing_t *r);
+bool camRingTake(camRing_t *r, int *buf, uint32_t *seq);
+uint32_t camRingDropped(camRing_t *r);
+
+#endif
@@ -0,0 +1,72 @@
+#include "camroi.h"
+
+// the window must be inside the sensor image and fit in a maxX by maxY buffer.
+// the width must be a multiple of 4 so every row is whole DMA words, even in luma mode
+bool camRoiSet(camRoi_t *r, uint16_t fullX, uint16_t fullY, uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t maxX, uint16_t maxY){
+    if (w == 0 || h == 0 || w % 4){
+        return false;
+    }
+    if (x + w > fullX || y + h > fullY){
+        return false;
+    }
+    if (w > maxX || h > maxY){
+        return false;
+    }
+    r->fullX = fullX;
+    r->fullY = fullY;
+    r->x = x;
+    r->y = y;
+    r->w = w;
+    r->h = h;
+    return true;
+}
+
+// the whole image if it fits, otherwise the biggest window that does, in the middle
+void camRoiDefault(camRoi_t *r, uint16_t fullX, uint16_t fullY, uint16_t maxX, uint16_t maxY){
+    uint16_t w = fullX < maxX ? fullX : maxX;
+    uint16_t h = fullY < maxY ? fullY : maxY;
+    r->fullX = fullX;
+    r->fullY = fullY;
+    r->w = w;
+    r->h = h;
+    r->x = ((fullX - w) / 2) & ~3; // keeps the skip a whole number of words
+    r->y = (fullY - h) / 2;
+}
+
+// bytes the PIO throws away at the start of every row. the camera always sends 2 bytes
+// per pixel, RGB565 or YUYV, so this does not depend on the stored format
+uint32_t camRoiSkipBytes(const camRoi_t *r){
+    return r->x * 2;
+}
+
+// bytes stored for one frame
+uint32_t camRoiFrameBytes(const camRoi_t *r, int bpp){
+    return r->w * r->h * bpp;
+}
+
+// sensor rows for VSTART/VSTOP. vstart is where the full image starts and scale is
+// how many sensor rows make one output row (1 << OV7670_size)
+void camRoiRows(const camRoi_t *r, uint16_t vstart, int scale, uint16_t *vfirst, uint16_t *vstop){
+    *vfirst = vstart + r->y * scale;
+    *vstop = *vfirst + r->h * scale;
+}
+
+// what the sensor window and PIO together do to a full frame, for a made up or recorded
+// frame on the computer. full is fullX*fullY*2 camera bytes, out gets w*h*bpp bytes
+void camRoiCrop(const camRoi_t *r, const uint8_t *full, uint8_t *out, bool luma){
+    int row, i;
+    for(row=0;row<r->h;row++){
+        const uint8_t *p = full + ((r->y + row)*r->fullX + r->x)*2;
+        if (luma){
+            // Y is the first byte of each pair
+            for(i=0;i<r->w;i++){
+                *out++ = p[2*i];
+            }
+        }
+        else {
+            for(i=0;i<r->w*2;i++){
+                *out++ = p[i];
+            }
+        }
+    }
+}
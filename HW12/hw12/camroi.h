@@ -0,0 +1,25 @@
+#ifndef CAMROI_h
+#define CAMROI_h
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Region of interest: the band of rows and columns that is actually stored.
+// Rows outside it are cut by the sensor's VSTART/VSTOP window, so they never come out of
+// the camera. Columns outside it are clocked out by the camera but the PIO skips them.
+// No pico calls in here, so the bookkeeping can run on the computer against a made up frame.
+
+typedef struct camRoi{
+    uint16_t fullX, fullY; // what the sensor outputs at the current resolution
+    uint16_t x, y; // top left corner of the window, output pixels
+    uint16_t w, h; // window size, output pixels
+} camRoi_t;
+
+bool camRoiSet(camRoi_t *r, uint16_t fullX, uint16_t fullY, uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t maxX, uint16_t maxY);
+void camRoiDefault(camRoi_t *r, uint16_t fullX, uint16_t fullY, uint16_t maxX, uint16_t maxY);
+uint32_t camRoiSkipBytes(const camRoi_t *r);
+uint32_t camRoiFrameBytes(const camRoi_t *r, int bpp);
+void camRoiRows(const camRoi_t *r, uint16_t vstart, int scale, uint16_t *vfirst, uint16_t *vstop);
+void camRoiCrop(const camRoi_t *r, const uint8_t *full, uint8_t *out, bool luma);
+
+#endif
@@ -0,0 +1,146 @@
+#include <stdio.h>
+#include "camstats.h"
+
+// bytes are only known to the nearest DMA word, so a row this close counts as right
+#define ROW_SLACK 4
+
+void camHistInit(camHist_t *h, uint32_t binWidth){
+    int i;
+    h->binWidth = binWidth;
+    h->count = 0;
+    h->min = 0xFFFFFFFF;
+    h->max = 0;
+    h->sum = 0;
+    for(i=0;i<CAMSTATS_BINS;i++){
+        h->bins[i] = 0;
+    }
+}
+
+void camHistAdd(camHist_t *h, uint32_t v){
+    uint32_t bin = v / h->binWidth;
+    if (bin >= CAMSTATS_BINS){
+        bin = CAMSTATS_BINS - 1;
+    }
+    h->bins[bin]++;
+    h->count++;
+    h->sum += v;
+    if (v < h->min){
+        h->min = v;
+    }
+    if (v > h->max){
+        h->max = v;
+    }
+}
+
+// one line of totals, then one line per bin that has anything in it
+void camHistPrint(const camHist_t *h, const char *name){
+    int i;
+    if (h->count == 0){
+        printf("%s: none\r\n", name);
+        return;
+    }
+    printf("%s: n=%lu min=%lu avg=%lu max=%lu\r\n", name, (unsigned long)h->count, (unsigned long)h->min,
+        (unsigned long)(h->sum / h->count), (unsigned long)h->max);
+    for(i=0;i<CAMSTATS_BINS;i++){
+        if (h->bins[i]){
+            printf("  %lu%s %lu\r\n", (unsigned long)(i * h->binWidth), i == CAMSTATS_BINS-1 ? "+" : "", (unsigned long)h->bins[i]);
+        }
+    }
+}
+
+void camStatsInit(camStats_t *s){
+    s->inFrame = false;
+    s->lastVS = 0;
+    s->frameStart = 0;
+    s->rows = 0;
+    s->rowStartBytes = 0;
+    s->rowMin = 0xFFFFFFFF;
+    s->rowMax = 0;
+    s->frames = 0;
+    s->overruns = 0;
+    s->underruns = 0;
+    s->rowErrors = 0;
+    s->byteErrors = 0;
+    s->lastRows = 0;
+    s->lastRowMin = 0;
+    s->lastRowMax = 0;
+    camHistInit(&s->period, 20000); // 20ms bins, 0-320ms
+    camHistInit(&s->duration, 20000);
+}
+
+// falling VS at time now. bytes is how far the capture has got, armed if a capture is waiting for this VS
+void camStatsVS(camStats_t *s, uint32_t now, uint32_t bytes, bool armed){
+    if (s->lastVS){
+        camHistAdd(&s->period, now - s->lastVS);
+    }
+    s->lastVS = now;
+
+    if (s->inFrame && bytes > 0){
+        // the last frame never finished
+        s->underruns++;
+    }
+    s->inFrame = armed;
+    s->frameStart = now;
+    s->rows = 0;
+    s->rowStartBytes = bytes;
+    s->rowMin = 0xFFFFFFFF;
+    s->rowMax = 0;
+}
+
+// finish off the row that started at rowStartBytes
+static void endRow(camStats_t *s, uint32_t bytes){
+    uint32_t n = bytes - s->rowStartBytes;
+    if (n < s->rowMin){
+        s->rowMin = n;
+    }
+    if (n > s->rowMax){
+        s->rowMax = n;
+    }
+}
+
+// rising HS, a row starts at this byte count
+void camStatsHS(camStats_t *s, uint32_t bytes){
+    if (!s->inFrame){
+        return;
+    }
+    if (s->rows){
+        endRow(s, bytes);
+    }
+    s->rows++;
+    s->rowStartBytes = bytes;
+}
+
+// the DMA finished at time now after bytes bytes, compare with the expected rows and bytes per row
+void camStatsDone(camStats_t *s, uint32_t now, uint32_t bytes, uint32_t rows, uint32_t rowBytes, bool overrun){
+    if (!s->inFrame){
+        return;
+    }
+    if (s->rows){
+        endRow(s, bytes);
+    }
+    s->inFrame = false;
+    s->frames++;
+    camHistAdd(&s->duration, now - s->frameStart);
+    if (overrun){
+        s->overruns++;
+    }
+    if (s->rows != rows){
+        s->rowErrors++;
+    }
+    if (s->rowMin + ROW_SLACK < rowBytes || s->rowMax > rowBytes + ROW_SLACK){
+        s->byteErrors++;
+    }
+    s->lastRows = s->rows;
+    s->lastRowMin = s->rowMin;
+    s->lastRowMax = s->rowMax;
+}
+
+void camStatsPrint(const camStats_t *s){
+    printf("frames=%lu overruns=%lu underruns=%lu rowErrors=%lu byteErrors=%lu\r\n",
+        (unsigned long)s->frames, (unsigned long)s->overruns, (unsigned long)s->underruns,
+        (unsigned long)s->rowErrors, (unsigned long)s->byteErrors);
+    printf("last frame: rows=%lu row bytes %lu-%lu\r\n", (unsigned long)s->lastRows,
+        (unsigned long)s->lastRowMin, (unsigned long)s->lastRowMax);
+    camHistPrint(&s->period, "VS period us");
+    camHistPrint(&s->duration, "capture us");
+}
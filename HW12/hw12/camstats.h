@@ -0,0 +1,55 @@
+#ifndef CAMSTATS_h
+#define CAMSTATS_h
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Capture health numbers, fed from the VS/HS interrupts and the end of each frame.
+// No pico calls in here, the times and byte counts are passed in.
+
+#define CAMSTATS_BINS 16
+
+// running histogram with fixed width bins, the last bin also holds everything above it
+typedef struct camHist{
+    uint32_t binWidth;
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+    uint32_t bins[CAMSTATS_BINS];
+} camHist_t;
+
+typedef struct camStats{
+    // frame in progress
+    bool inFrame;
+    uint32_t lastVS; // time of the last falling VS, us
+    uint32_t frameStart; // time the frame being captured started, us
+    uint32_t rows; // HS edges seen in this frame
+    uint32_t rowStartBytes; // bytes captured when the current row started
+    uint32_t rowMin; // shortest and longest finished row in this frame, bytes
+    uint32_t rowMax;
+
+    // totals since camStatsInit()
+    uint32_t frames;
+    uint32_t overruns; // the DMA fell behind and the PIO FIFO filled up
+    uint32_t underruns; // a new VS arrived before the frame was complete
+    uint32_t rowErrors; // frames with the wrong number of rows
+    uint32_t byteErrors; // frames with a row of the wrong length
+    uint32_t lastRows; // numbers for the last finished frame
+    uint32_t lastRowMin;
+    uint32_t lastRowMax;
+    camHist_t period; // VS to VS, us
+    camHist_t duration; // VS to last byte, us
+} camStats_t;
+
+void camHistInit(camHist_t *h, uint32_t binWidth);
+void camHistAdd(camHist_t *h, uint32_t v);
+void camHistPrint(const camHist_t *h, const char *name);
+
+void camStatsInit(camStats_t *s);
+void camStatsVS(camStats_t *s, uint32_t now, uint32_t bytes, bool armed);
+void camStatsHS(camStats_t *s, uint32_t bytes);
+void camStatsDone(camStats_t *s, uint32_t now, uint32_t bytes, uint32_t rows, uint32_t rowBytes, bool overrun);
+void camStatsPrint(const camStats_t *s);
+
+#endif
@@ -0,0 +1,116 @@
+#include "framelink.h"
+
+// CRC-32 a nibble at a time, small table and still quick enough for a frame
+static const uint32_t crcTable[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
+// send whatever is collected
+static void flushOut(frameTx_t *f){
+    if (f->outCount){
+        f->sink(f->out, f->outCount);
+        f->outCount = 0;
+    }
+}
+
+// one byte on the wire
+static void putByte(frameTx_t *f, uint8_t b){
+    f->crc ^= b;
+    f->crc = (f->crc >> 4) ^ crcTable[f->crc & 0xF];
+    f->crc = (f->crc >> 4) ^ crcTable[f->crc & 0xF];
+    f->out[f->outCount++] = b;
+    if (f->outCount == FRAMELINK_CHUNK){
+        flushOut(f);
+    }
+}
+
+// send the pending literal bytes as one PackBits literal packet
+static void flushLiterals(frameTx_t *f){
+    if (f->litCount){
+        putByte(f, f->litCount - 1);
+        int i;
+        for(i=0;i<f->litCount;i++){
+            putByte(f, f->lit[i]);
+        }
+        f->litCount = 0;
+    }
+}
+
+// the current run ended, repeats of 3 or more are worth a run packet
+static void flushRun(frameTx_t *f){
+    if (f->runCount >= 3){
+        flushLiterals(f);
+        putByte(f, 257 - f->runCount);
+        putByte(f, f->runByte);
+    }
+    else {
+        int i;
+        for(i=0;i<f->runCount;i++){
+            f->lit[f->litCount++] = f->runByte;
+            if (f->litCount == 128){
+                flushLiterals(f);
+            }
+        }
+    }
+    f->runCount = 0;
+}
+
+// start a frame and send the header
+void frameTxBegin(frameTx_t *f, frameSink_t sink, uint8_t format, uint8_t flags, uint16_t width, uint16_t height, uint32_t seq){
+    f->sink = sink;
+    f->flags = flags;
+    f->crc = 0xFFFFFFFF;
+    f->outCount = 0;
+    f->litCount = 0;
+    f->runCount = 0;
+
+    putByte(f, 'F');
+    putByte(f, 'R');
+    putByte(f, format);
+    putByte(f, flags);
+    putByte(f, width & 0xFF);
+    putByte(f, width >> 8);
+    putByte(f, height & 0xFF);
+    putByte(f, height >> 8);
+    putByte(f, seq & 0xFF);
+    putByte(f, (seq >> 8) & 0xFF);
+    putByte(f, (seq >> 16) & 0xFF);
+    putByte(f, seq >> 24);
+}
+
+// add payload bytes, compressed if the frame was started with FRAME_RLE
+void frameTxWrite(frameTx_t *f, const uint8_t *data, int len){
+    int i;
+    if (!(f->flags & FRAME_RLE)){
+        for(i=0;i<len;i++){
+            putByte(f, data[i]);
+        }
+        return;
+    }
+    for(i=0;i<len;i++){
+        if (f->runCount && data[i] == f->runByte && f->runCount < 128){
+            f->runCount++;
+            continue;
+        }
+        if (f->runCount){
+            flushRun(f);
+        }
+        f->runByte = data[i];
+        f->runCount = 1;
+    }
+}
+
+// finish the payload and send the CRC
+void frameTxEnd(frameTx_t *f){
+    if (f->flags & FRAME_RLE){
+        flushRun(f);
+        flushLiterals(f);
+    }
+    uint32_t crc = ~f->crc;
+    putByte(f, crc & 0xFF);
+    putByte(f, (crc >> 8) & 0xFF);
+    putByte(f, (crc >> 16) & 0xFF);
+    putByte(f, crc >> 24);
+    flushOut(f);
+}
@@ -0,0 +1,56 @@
+#ifndef FRAMELINK_h
+#define FRAMELINK_h
+
+#include <stdint.h>
+
+// Binary image frames over USB serial, much smaller than printImage() text.
+//
+// header, 12 bytes, little endian:
+//   'F' 'R'          magic
+//   uint8  format    FRAME_RGB565, FRAME_BINARY or FRAME_LUMA
+//   uint8  flags     FRAME_RLE if the payload is PackBits compressed
+//   uint16 width
+//   uint16 height
+//   uint32 seq       frame sequence number
+// payload:
+//   RGB565: width*height*2 bytes, exactly as they came out of the camera
+//   LUMA: width*height bytes, one Y byte per pixel
+//   BINARY: 1 bit per pixel, MSB is the leftmost pixel, each row padded to a whole byte
+//   with FRAME_RLE the payload is PackBits: a control byte n, 0-127 means n+1 literal
+//   bytes follow, 129-255 means repeat the next byte 257-n times (128 is not used).
+//   the decoder knows the raw size from the header, so it stops when it has enough.
+// trailer:
+//   uint32 crc       CRC-32 (same as zlib.crc32) of the header and payload as sent
+//
+// python/read_frames.py decodes these on the computer.
+// No pico calls in here, the bytes go to a sink, see sim/framelink_check.c.
+
+#define FRAME_RGB565 0
+#define FRAME_BINARY 1
+#define FRAME_LUMA 2
+
+#define FRAME_RLE 0x01
+
+#define FRAMELINK_CHUNK 64 // bytes collected before each write to USB
+
+// where the bytes go, at most FRAMELINK_CHUNK at a time. cam.c writes them to USB
+typedef void (*frameSink_t)(const uint8_t *data, int len);
+
+typedef struct frameTx{
+    frameSink_t sink;
+    uint8_t flags;
+    uint32_t crc;
+    uint8_t out[FRAMELINK_CHUNK];
+    int outCount;
+    // PackBits state
+    uint8_t lit[128];
+    int litCount;
+    uint8_t runByte;
+    int runCount;
+} frameTx_t;
+
+void frameTxBegin(frameTx_t *f, frameSink_t sink, uint8_t format, uint8_t flags, uint16_t width, uint16_t height, uint32_t seq);
+void frameTxWrite(frameTx_t *f, const uint8_t *data, int len);
+void frameTxEnd(frameTx_t *f);
+
+#endif
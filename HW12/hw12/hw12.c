@@ -1,6 +1,51 @@
 #include <stdio.h>
 #include "pico/stdlib.h"
+#include "pico/multicore.h"
 #include "cam.h"
+#include "mailbox.h"
+
+// 1 to stream line positions continuously instead of waiting for a command per image
+#define STREAM_MODE 0
+// 1 to run the camera and line finding on core 1 and the control loop on core 0
+#define PIPELINE_MODE 0
+#define CONTROL_MS 10 // control loop period on core 0
+#define FLAG_VALUE 123
+
+static camera_t cam;
+static lineMailbox_t lineMail;
+
+#if PIPELINE_MODE
+// core 1: capture, find the line and publish it, forever
+void core1_entry() {
+    // set the camera up from here so its DMA interrupt runs on core 1
+    camera_init_config(&cam);
+    init_camera_pins(&cam);
+
+    int y = getImageSizeY(&cam);
+    int rows[5] = {y/2, 5*y/8, 3*y/4, 7*y/8, y-1};
+    lineTrack_t track;
+
+    camera_set_auto_exposure(&cam, true);
+    startStream(&cam);
+    multicore_fifo_push_blocking(FLAG_VALUE);
+
+    while (true) {
+        uint32_t seq = getFrame(&cam);
+        camera_auto_exposure(&cam);
+        lineMsg_t *msg = mailboxWriteSlot(&lineMail);
+        msg->seq = seq;
+        msg->time = time_us_32();
+        msg->dropped = getDroppedFrames(&cam);
+        msg->com = findLineRaw(&cam, y/2);
+        trackLine(&cam, rows, 5, &track);
+        msg->offset = track.offset;
+        msg->heading = track.heading;
+        msg->curvature = track.curvature;
+        msg->confidence = track.confidence;
+        mailboxPublish(&lineMail);
+    }
+}
+#endif
 
 int main()
 {
@@ -11,19 +56,126 @@ int main()
     }
     //printf("Hello, camera!\n");
 
-    init_camera_pins();
+#if PIPELINE_MODE
+    mailboxInit(&lineMail);
+    multicore_launch_core1(core1_entry);
+    // wait for core 1 to have the camera running
+    if (multicore_fifo_pop_blocking() != FLAG_VALUE){
+        printf("core 1 did not start\r\n");
+    }
+
+    // never waits on the camera, uses whatever estimate is newest
+    absolute_time_t next = get_absolute_time();
+    while (true) {
+        bool fresh;
+        const lineMsg_t *msg = mailboxLatest(&lineMail, &fresh);
+        uint32_t age = time_us_32() - msg->time;
+        printf("%lu %d %lu %lu %d %.2f %.3f %.4f %.2f\r\n", msg->seq, fresh, age, msg->dropped, msg->com,
+            msg->offset, msg->heading, msg->curvature, msg->confidence);
+        next = delayed_by_ms(next, CONTROL_MS);
+        sleep_until(next);
+    }
+#endif
+
+    camera_init_config(&cam);
+    init_camera_pins(&cam);
+
+#if STREAM_MODE
+    // rows to look for the line on, from the far half of the image down to the bottom
+    int y = getImageSizeY(&cam);
+    int rows[5] = {y/2, 5*y/8, 3*y/4, 7*y/8, y-1};
+    lineTrack_t track;
+
+    camera_set_auto_exposure(&cam, true);
+    startStream(&cam);
+    while (true) {
+        // the camera is already filling the other buffer while this one is processed
+        uint32_t seq = getFrame(&cam);
+        camera_auto_exposure(&cam);
+        int com = findLineRaw(&cam, getImageSizeY(&cam)/2); // no need to convert the whole image
+        trackLine(&cam, rows, 5, &track);
+        printf("%lu %lu %d %.2f %.3f %.4f %.2f\r\n", seq, getDroppedFrames(&cam), com,
+            track.offset, track.heading, track.curvature, track.confidence);
+    }
+#endif
  
     while (true) {
         // uncomment these and printImage() when testing with python 
         char m[10];
         scanf("%s",m);
 
-        setSaveImage(1);
-        while(getSaveImage()==1){}
-        convertImage();
-        int com = findLine(IMAGESIZEY/2); // calculate the position of the center of the ine
-        //setPixel(IMAGESIZEY/2,com,0,255,0); // draw the center so you can see it in python
-        printImage();
+        // r0-r4 picks the VGA division, r3 is 80x60, r0 and r1 are cut down to fit the buffers
+        if (m[0] == 'r'){
+            if (!camera_set_resolution(&cam, m[1]-'0')){
+                printf("unknown size\r\n");
+            }
+            continue;
+        }
+
+        // o x y w h only stores that window, r resets it to the whole image
+        if (m[0] == 'o'){
+            int x, y, w, h;
+            scanf("%d %d %d %d", &x, &y, &w, &h);
+            if (!camera_set_roi(&cam, x, y, w, h)){
+                printf("window does not fit\r\n");
+            }
+            continue;
+        }
+
+        // f0 is RGB565, f1 is luma only
+        if (m[0] == 'f'){
+            if (!camera_set_format(&cam, m[1]-'0')){
+                printf("unknown format\r\n");
+            }
+            continue;
+        }
+
+        // t prints the capture telemetry, z clears it
+        if (m[0] == 't'){
+            camera_print_stats(&cam);
+            continue;
+        }
+        if (m[0] == 'z'){
+            camera_reset_stats(&cam);
+            continue;
+        }
+
+        // a1 turns the firmware exposure control on, a0 off
+        if (m[0] == 'a'){
+            camera_set_auto_exposure(&cam, m[1] == '1');
+            continue;
+        }
+
+        setSaveImage(&cam, 1);
+        waitImage(&cam);
+        camera_auto_exposure(&cam);
+
+        // b sends the raw image and k the thresholded image as binary frames, read with read_frames.py
+        if (m[0] == 'b'){
+            sendImage(&cam, FRAME_RLE);
+            continue;
+        }
+        if (m[0] == 'k'){
+            sendBinaryImage(&cam, FRAME_RLE);
+            continue;
+        }
+        // e cleans up the thresholded image and prints where the white is
+        if (m[0] == 'e'){
+            static binImage_t clean;
+            binRun_t runs[8];
+            float cx = 0, cy = 0;
+            thresholdImage(&cam, &cam.binary);
+            binErode(&cam.binary, &clean);
+            int count = binCentroid(&clean, &cx, &cy);
+            int n = binRuns(&clean, getImageSizeY(&cam)/2, runs, 8);
+            printf("%d %.1f %.1f %d\r\n", count, cx, cy, n);
+            continue;
+        }
+
+        convertImage(&cam);
+        int com = findLine(&cam, getImageSizeY(&cam)/2); // calculate the position of the center of the ine
+        //setPixel(&cam, getImageSizeY(&cam)/2,com,0,255,0); // draw the center so you can see it in python
+        printImage(&cam);
         // printf("%d\r\n",com); // comment this when testing with python
     }
 }
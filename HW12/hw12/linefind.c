@@ -0,0 +1,166 @@
+#include <math.h>
+#include "linefind.h"
+
+// brightness of one RGB565 pixel, the same r+g+b that convertImage() and findLine() use
+static inline int rgb565Bright(uint8_t lo, uint8_t hi){
+    return ((hi>>3)<<3) + ((((hi&0b111)<<3) | (lo>>5))<<2) + ((lo&0b11111)<<3);
+}
+
+// brightness of pixel i in a row of the frame. in luma mode convertImage() makes a gray pixel
+// with r = g = b = Y, so it is 3*Y: the row mean is then rounded down the same way as findLine()'s.
+// luma is loop invariant in the callers, so the compiler splits the loops and there is no test per pixel
+static inline int pixelBright(const uint8_t *p, int i, bool luma){
+    return luma ? 3*p[i] : rgb565Bright(p[2*i], p[2*i+1]);
+}
+
+// average brightness of a row, the threshold findLine() uses
+static int rowMean(const camFrame_t *f, const uint8_t *p){
+    bool luma = f->bpp == 1;
+    int sumBright = 0;
+    int i;
+    for(i=0;i<f->sizeX;i++){
+        sumBright = sumBright + pixelBright(p, i, luma);
+    }
+    return sumBright / f->sizeX;
+}
+
+// threshold one row of the frame against its mean and return the white pixel count.
+// *sumCol gets the sum of the white columns
+static int rowWhite(const camFrame_t *f, int row, int *sumCol){
+    const uint8_t *p = f->data + row*f->sizeX*f->bpp;
+    bool luma = f->bpp == 1;
+    int i;
+
+    int avgBright = rowMean(f, p);
+
+    // threshold and accumulate in the same pass
+    int count = 0;
+    *sumCol = 0;
+    for(i=0;i<f->sizeX;i++){
+        if (pixelBright(p, i, luma) >= avgBright){
+            count++;
+            *sumCol = *sumCol + i;
+        }
+    }
+    return count;
+}
+
+// same result as convertImage() then findLine(row), but works straight from the camera bytes.
+// only the one row is decoded, nothing is written back, and it is all integer math.
+// the white pixels all have the same mass, so the center of mass is just their average column
+int frameFindLine(const camFrame_t *f, int row){
+    int sumCol;
+    int count = rowWhite(f, row, &sumCol);
+    // the brightest pixel is always at or above the average, so count > 0
+    return sumCol / count;
+}
+
+// find the line on several rows and fit x = a + b*y + c*y*y through the centers,
+// with y counted up from the bottom of the image (closest to the robot).
+// a row only counts if the white part is narrower than half the image, a flat row
+// thresholds to mostly white and says nothing about where the line is.
+void frameTrackLine(const camFrame_t *f, const int *rows, int nrows, lineTrack_t *t){
+    float ys[BIN_MAX_Y];
+    float xs[BIN_MAX_Y];
+    int n = 0;
+    int i;
+
+    for(i=0;i<nrows && n<BIN_MAX_Y;i++){
+        if (rows[i] < 0 || rows[i] >= f->sizeY){
+            continue;
+        }
+        int sumCol;
+        int count = rowWhite(f, rows[i], &sumCol);
+        if (count < f->sizeX/2){
+            ys[n] = f->sizeY - 1 - rows[i];
+            xs[n] = (float)sumCol / count;
+            n++;
+        }
+    }
+
+    t->rows = n;
+    t->offset = 0;
+    t->heading = 0;
+    t->curvature = 0;
+    t->confidence = 0;
+    if (n == 0){
+        return;
+    }
+
+    // sums for the least squares normal equations
+    float s0 = n, s1 = 0, s2 = 0, s3 = 0, s4 = 0;
+    float t0 = 0, t1 = 0, t2 = 0;
+    for(i=0;i<n;i++){
+        float y = ys[i];
+        float y2 = y*y;
+        s1 += y;
+        s2 += y2;
+        s3 += y2*y;
+        s4 += y2*y2;
+        t0 += xs[i];
+        t1 += xs[i]*y;
+        t2 += xs[i]*y2;
+    }
+
+    float a = t0 / s0;
+    float b = 0;
+    float c = 0;
+    if (n >= 3){
+        // quadratic, Cramer's rule on the 3x3 system
+        float det = s0*(s2*s4 - s3*s3) - s1*(s1*s4 - s3*s2) + s2*(s1*s3 - s2*s2);
+        if (det != 0){
+            a = (t0*(s2*s4 - s3*s3) - s1*(t1*s4 - s3*t2) + s2*(t1*s3 - s2*t2)) / det;
+            b = (s0*(t1*s4 - s3*t2) - t0*(s1*s4 - s3*s2) + s2*(s1*t2 - t1*s2)) / det;
+            c = (s0*(s2*t2 - t1*s3) - s1*(s1*t2 - t1*s2) + t0*(s1*s3 - s2*s2)) / det;
+        }
+    }
+    else if (n == 2){
+        // straight line through the two points
+        float det = s0*s2 - s1*s1;
+        if (det != 0){
+            a = (t0*s2 - s1*t1) / det;
+            b = (s0*t1 - s1*t0) / det;
+        }
+    }
+
+    // rms distance of the centers from the fit
+    float err = 0;
+    for(i=0;i<n;i++){
+        float d = xs[i] - (a + b*ys[i] + c*ys[i]*ys[i]);
+        err += d*d;
+    }
+    err = sqrtf(err / n);
+
+    t->offset = a - (f->sizeX - 1) / 2.0f; // pixels, + is right of center
+    t->heading = atanf(b); // radians, + leans right going up the image
+    t->curvature = 2*c / powf(1 + b*b, 1.5f); // 1/pixels
+    // fewer usable rows or a poor fit both lower the confidence, 0 to 1
+    t->confidence = ((float)n / nrows) / (1 + err);
+}
+
+// threshold every row of the frame against its mean like findLine(), straight into packed bits.
+// then binErode(), binRowCentroid(), binRuns() etc work on whole words, see binimage.h
+void frameThreshold(const camFrame_t *f, binImage_t *img){
+    bool luma = f->bpp == 1;
+    int row, i;
+
+    binClear(img, f->sizeX, f->sizeY);
+    for(row=0;row<f->sizeY;row++){
+        const uint8_t *p = f->data + row*f->sizeX*f->bpp;
+        int avgBright = rowMean(f, p);
+        uint32_t *w = img->bits[row];
+        uint32_t word = 0;
+        for(i=0;i<f->sizeX;i++){
+            if (pixelBright(p, i, luma) >= avgBright){
+                word |= 1u << (i&31);
+            }
+            if ((i&31) == 31){
+                w[i>>5] = word;
+                word = 0;
+            }
+        }
+        if (f->sizeX & 31){
+            w[f->sizeX>>5] = word;
+        }
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef LINEFIND_h
+#define LINEFIND_h
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "binimage.h"
+
+// Line finding on a captured frame, the part of the processing that doesn't touch the hardware.
+// cam.c calls these on cam->data, and they build on the computer for replaying recorded frames (sim/).
+
+// a frame as it is stored by the capture, RGB565 (2 bytes per pixel) or luma (1 byte per pixel)
+typedef struct camFrame{
+    const uint8_t *data;
+    int sizeX, sizeY;
+    int bpp;
+} camFrame_t;
+
+// line fit over several rows, see frameTrackLine()
+typedef struct lineTrack{
+    int rows; // rows where the line was found
+    float offset; // pixels from center at the bottom row, + is right
+    float heading; // radians, 0 is straight up the image
+    float curvature; // 1/pixels
+    float confidence; // 0 to 1
+} lineTrack_t;
+
+int frameFindLine(const camFrame_t *f, int row);
+void frameTrackLine(const camFrame_t *f, const int *rows, int nrows, lineTrack_t *t);
+void frameThreshold(const camFrame_t *f, binImage_t *img);
+
+#endif
@@ -0,0 +1,33 @@
+#include <string.h>
+#include "mailbox.h"
+
+// call before core 1 starts
+void mailboxInit(lineMailbox_t *m){
+    memset(m->slots, 0, sizeof(m->slots));
+    m->back = 0;
+    m->front = 2;
+    atomic_store_explicit(&m->middle, 1, memory_order_relaxed);
+}
+
+// writer: fill this in, then mailboxPublish()
+lineMsg_t *mailboxWriteSlot(lineMailbox_t *m){
+    return &m->slots[m->back];
+}
+
+// writer: hand the filled slot over and take the old middle one to fill next time
+void mailboxPublish(lineMailbox_t *m){
+    // release so the reader sees the whole message, acquire so we don't write over a slot it is still copying
+    unsigned old = atomic_exchange_explicit(&m->middle, m->back | MAILBOX_FRESH, memory_order_acq_rel);
+    m->back = old & 3;
+}
+
+// reader: newest message, fresh is true if it wasn't returned before. all zeros until the first publish
+const lineMsg_t *mailboxLatest(lineMailbox_t *m, bool *fresh){
+    *fresh = false;
+    if (atomic_load_explicit(&m->middle, memory_order_relaxed) & MAILBOX_FRESH){
+        unsigned old = atomic_exchange_explicit(&m->middle, m->front, memory_order_acq_rel);
+        m->front = old & 3;
+        *fresh = true;
+    }
+    return &m->slots[m->front];
+}
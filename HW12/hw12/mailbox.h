@@ -0,0 +1,39 @@
+#ifndef MAILBOX_h
+#define MAILBOX_h
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+// Latest line estimate passed from core 1 to core 0.
+// One writer and one reader, neither ever waits for the other: a triple buffer where
+// the writer fills its own slot and swaps it into the middle, and the reader swaps the
+// middle out when it is marked fresh. The reader always gets the newest whole message,
+// older ones it never read are simply overwritten.
+
+#define MAILBOX_FRESH 4 // set in middle when the writer has published since the last read
+
+typedef struct lineMsg{
+    uint32_t seq; // camera frame the estimate came from
+    uint32_t dropped; // frames the camera overwrote before core 1 got to them
+    uint32_t time; // time_us_32() when the frame was picked up
+    int com; // findLineRaw() on the middle row
+    float offset; // trackLine() results
+    float heading;
+    float curvature;
+    float confidence;
+} lineMsg_t;
+
+typedef struct lineMailbox{
+    lineMsg_t slots[3];
+    atomic_uint middle; // slot between the two cores, plus MAILBOX_FRESH
+    uint8_t back; // slot the writer fills, only used by the writer
+    uint8_t front; // slot the reader looks at, only used by the reader
+} lineMailbox_t;
+
+void mailboxInit(lineMailbox_t *m);
+lineMsg_t *mailboxWriteSlot(lineMailbox_t *m);
+void mailboxPublish(lineMailbox_t *m);
+const lineMsg_t *mailboxLatest(lineMailbox_t *m, bool *fresh);
+
+#endif
@@ -187,6 +187,7 @@
 #define OV7670_REG_SATCTR 0xC9             //< Saturation control
 
 #define OV7670_REG_LAST OV7670_REG_SATCTR //< Maximum register address
+#define OV7670_MAX_TABLE 128 //< Longest {reg, value} table, tables end in {0xff, 0xff}
 
 static const uint8_t OV7670_init[92][2] = {
     {OV7670_REG_TSLB, OV7670_TSLB_YLAST},    // No auto window
@@ -312,6 +313,16 @@ static const uint8_t OV7670_rgb[12][2] = {
     {0xff, 0xff},
 };
 
+static const uint8_t OV7670_yuv[5][2] = {
+    // Manual output format, YUV422 in Y U Y V order, full 0-255 output range
+    {OV7670_REG_COM7, OV7670_COM7_YUV},
+    {OV7670_REG_TSLB, OV7670_TSLB_YLAST}, // with COM13 UVSWAP clear, Y comes first
+    {OV7670_REG_COM13, OV7670_COM13_UVSAT},
+    {OV7670_REG_COM15, OV7670_COM15_R00FF},
+
+    {0xff, 0xff},
+};
+
 /** Supported sizes (VGA division factor) for OV7670_set_size() */
 typedef enum {
     OV7670_SIZE_DIV1 = 0, ///< 640 x 480
@@ -321,6 +332,17 @@ typedef enum {
     OV7670_SIZE_DIV16,    ///< 40 x 30
   } OV7670_size;
 
+// Window settings were tediously determined empirically.
+// I hope there's a formula for this, if a do-over is needed.
+// Indexed by OV7670_size: {vstart,hstart,edge_offset,pclk_delay}
+static const uint16_t OV7670_window[5][4] = {
+    {9, 162, 2, 2},  // SIZE_DIV1  640x480 VGA
+    {10, 174, 4, 2}, // SIZE_DIV2  320x240 QVGA
+    {11, 186, 2, 2}, // SIZE_DIV4  160x120 QQVGA
+    {12, 210, 0, 2}, // SIZE_DIV8  80x60   ...
+    {15, 252, 3, 2}, // SIZE_DIV16 40x30
+};
+
   typedef enum {
     OV7670_TEST_PATTERN_NONE = 0,       ///< Disable test pattern
     OV7670_TEST_PATTERN_SHIFTING_1,     ///< "Shifting 1" pattern
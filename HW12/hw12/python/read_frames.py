@@ -0,0 +1,104 @@
+# reads the binary frames sent by sendImage() and sendBinaryImage(), see framelink.h
+# python3 -m pip install pyserial numpy matplotlib
+
+import struct
+import zlib
+
+import numpy as np
+import matplotlib.pyplot as plt
+
+FRAME_RGB565 = 0
+FRAME_BINARY = 1
+FRAME_LUMA = 2
+FRAME_RLE = 0x01
+HEADER = struct.Struct('<2sBBHHI')
+
+def unpackbits_rle(data, size):
+    # PackBits, stop once we have the whole image
+    out = bytearray()
+    i = 0
+    while len(out) < size:
+        n = data[i]
+        i += 1
+        if n < 128:
+            out += data[i:i+n+1]
+            i += n+1
+        elif n > 128:
+            out += bytes([data[i]]) * (257-n)
+            i += 1
+    return bytes(out), i
+
+def raw_size(fmt, width, height):
+    if fmt == FRAME_RGB565:
+        return width*height*2
+    if fmt == FRAME_LUMA:
+        return width*height
+    return ((width+7)//8)*height
+
+def read_frame(read):
+    # read(n) returns n bytes, from a serial port or a file
+    # returns (seq, image) where image is HxWx3 for RGB565, HxW 0-255 for luma or HxW 0/255 for binary
+    sync = b''
+    while sync != b'FR':
+        sync = (sync + read(1))[-2:]
+    header = b'FR' + read(HEADER.size-2)
+    _, fmt, flags, width, height, seq = HEADER.unpack(header)
+    size = raw_size(fmt, width, height)
+
+    if flags & FRAME_RLE:
+        # read one packet at a time, the length is only known after decoding
+        payload = bytearray()
+        got = 0
+        while got < size:
+            n = read(1)
+            payload += n
+            if n[0] < 128:
+                payload += read(n[0]+1)
+                got += n[0]+1
+            elif n[0] > 128:
+                payload += read(1)
+                got += 257-n[0]
+        raw, _ = unpackbits_rle(bytes(payload), size)
+    else:
+        payload = read(size)
+        raw = payload
+
+    crc, = struct.unpack('<I', read(4))
+    if zlib.crc32(header + bytes(payload)) != crc:
+        raise ValueError('bad crc on frame %d' % seq)
+
+    if fmt == FRAME_RGB565:
+        px = np.frombuffer(raw, dtype='<u2').reshape(height, width)
+        # same unpacking as convertImage()
+        r = ((px >> 11) << 3).astype(np.uint8)
+        g = (((px >> 5) & 0x3F) << 2).astype(np.uint8)
+        b = ((px & 0x1F) << 3).astype(np.uint8)
+        return seq, np.stack((r, g, b), axis=-1)
+    if fmt == FRAME_LUMA:
+        return seq, np.frombuffer(raw, dtype=np.uint8).reshape(height, width)
+    bits = np.unpackbits(np.frombuffer(raw, dtype=np.uint8).reshape(height, -1), axis=1)
+    return seq, bits[:, :width] * 255
+
+if __name__ == '__main__':
+    import serial
+    ser = serial.Serial('COM4') # the name of your port here
+    print('Opening port: ' + str(ser.name))
+
+    has_quit = False
+    # menu loop
+    while not has_quit:
+        selection = input('\nENTER COMMAND (b raw, k thresholded, q quit): ')
+        if selection == 'q':
+            print('Exiting client')
+            has_quit = True
+            ser.close()
+            continue
+        if selection not in ('b', 'k'):
+            print('Invalid Selection ' + selection)
+            continue
+        ser.write((selection+'\n').encode())
+        seq, image = read_frame(ser.read)
+        print('frame %d' % seq)
+        plt.imshow(image, cmap='gray' if image.ndim == 2 else None)
+        plt.axis("off")
+        plt.show()
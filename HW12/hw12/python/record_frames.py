@@ -0,0 +1,37 @@
+# records frames from the camera into a trace file for sim/replay
+# python3 record_frames.py COM4 trace.fr 100
+#
+# a trace file is just the binary frames from sendImage() back to back, exactly as they came
+# over USB (see framelink.h): 12 byte header, payload (PackBits if FRAME_RLE is set), CRC-32.
+# RGB565 and luma frames can both be replayed, each one keeps its own size and seq number.
+# set the resolution (r), window (o) and format (f) on the camera first, they are recorded in the headers
+
+import sys
+
+import serial
+
+from read_frames import read_frame
+
+def record(ser, out, count):
+    for i in range(count):
+        ser.write(b'b\n')
+        raw = bytearray()
+        def read(n):
+            # keep every byte so the frame is saved exactly as sent, CRC and all
+            data = ser.read(n)
+            raw.extend(data)
+            return data
+        seq, image = read_frame(read)
+        # drop anything before the sync bytes
+        out.write(raw[raw.index(b'FR'):])
+        print('frame %d seq %d %dx%d' % (i, seq, image.shape[1], image.shape[0]))
+
+if __name__ == '__main__':
+    port = sys.argv[1] if len(sys.argv) > 1 else 'COM4' # the name of your port here
+    name = sys.argv[2] if len(sys.argv) > 2 else 'trace.fr'
+    count = int(sys.argv[3]) if len(sys.argv) > 3 else 100
+    ser = serial.Serial(port)
+    print('Opening port: ' + str(ser.name))
+    with open(name, 'wb') as out:
+        record(ser, out, count)
+    ser.close()
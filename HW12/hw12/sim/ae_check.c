@@ -0,0 +1,223 @@
+// Checks the firmware exposure control in camexposure.c on the computer, against a simulated sensor.
+//
+//   ae_check
+//
+// The sensor makes each pixel from the scene's reflectance times the light times exposure
+// times gain, with a little noise, and clips at 255. New register values take effect a frame
+// after they are written, like the OV7670 where the frame being read out was already exposed.
+//
+// - from too dark and from too bright it gets the mean into the deadband and stays there
+// - after the light steps up or down it gets back within a few frames
+// - exposure is used before gain, and neither goes past its limits
+// - when a limit is reached it stops writing the registers every frame
+// - an image with more than a quarter blown out is pulled down even if the mean is on target
+// - the same on RGB565 and luma frames
+// - the GAIN register codes: every code's gain maps back to it, and a gain maps to the code at
+//   or just under it
+//
+// Prints what it checked and exits with 1 if anything was wrong.
+
+#include <stdio.h>
+#include <math.h>
+
+#include "camexposure.h"
+
+static int failed = 0;
+
+static void check(int ok, const char *what){
+    printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+    if (!ok){
+        failed = 1;
+    }
+}
+
+#define SX 80
+#define SY 60
+
+static uint32_t noise = 1;
+
+// the simulated sensor, exposure and gain are what it is using for the next frame
+typedef struct sensor{
+    float light; // scene brightness, 1 is ordinary room light
+    bool lamp; // a lamp blowing out the left of the top two thirds
+    bool luma;
+    uint16_t exposure, gain;
+    uint16_t nextExposure, nextGain; // written, used from the frame after next
+    bool pending;
+    uint8_t data[SX*SY*2];
+} sensor_t;
+
+// reflectance of the scene: a floor gradient with a bright line down the middle
+static float reflect(int x, int y){
+    float r = 0.25f + 0.35f * y / SY;
+    if (x > SX/2 - 4 && x < SX/2 + 4){
+        r = 0.9f;
+    }
+    return r;
+}
+
+// one frame with the settings in use, then the ones written last frame come in
+static void expose(sensor_t *s){
+    int x, y;
+    for(y=0;y<SY;y++){
+        for(x=0;x<SX;x++){
+            noise = noise * 1664525 + 1013904223;
+            float v = reflect(x, y) * s->light * 2.2f * s->exposure * s->gain / 16;
+            if (s->lamp && x < SX/2 && y < 2*SY/3){
+                v = 1000;
+            }
+            v += (int)(noise >> 29) - 4;
+            int b = v < 0 ? 0 : v > 255 ? 255 : (int)v;
+            if (s->luma){
+                s->data[y*SX + x] = b;
+            }
+            else {
+                uint16_t px = ((b >> 3) << 11) | ((b >> 2) << 5) | (b >> 3);
+                s->data[2*(y*SX + x)] = px & 0xFF;
+                s->data[2*(y*SX + x) + 1] = px >> 8;
+            }
+        }
+    }
+    if (s->pending){
+        s->exposure = s->nextExposure;
+        s->gain = s->nextGain;
+        s->pending = false;
+    }
+}
+
+typedef struct run{
+    int settled; // frame the mean got into the deadband and stayed, -1 if it didn't
+    int writes; // register writes
+    int lastWrite;
+    bool orderOk; // gain above 1x only with exposure at its limit
+    bool limitsOk;
+    bool spacingOk; // writes at least settleFrames apart
+} run_t;
+
+// camera_auto_exposure() for frames frames
+static void runAe(camAe_t *ae, sensor_t *s, int frames, run_t *r){
+    int n;
+    int since = 1000;
+    r->settled = -1;
+    r->writes = 0;
+    r->lastWrite = -1;
+    r->orderOk = true;
+    r->limitsOk = true;
+    r->spacingOk = true;
+    for(n=0;n<frames;n++){
+        expose(s);
+        camAeMeasure(ae, s->data, SX, SY, s->luma);
+        int err = ae->mean - ae->target;
+        bool in = err >= -ae->deadband && err <= ae->deadband;
+        if (in && r->settled < 0){
+            r->settled = n;
+        }
+        if (!in){
+            r->settled = -1;
+        }
+        since++;
+        if (camAeUpdate(ae)){
+            s->nextExposure = ae->exposure;
+            s->nextGain = camAeGainValue(camAeGainCode(ae->gain));
+            s->pending = true;
+            r->writes++;
+            r->lastWrite = n;
+            r->spacingOk = r->spacingOk && since > ae->settleFrames;
+            since = 0;
+        }
+        r->orderOk = r->orderOk && (ae->gain == 16 || ae->exposure == ae->expMax);
+        r->limitsOk = r->limitsOk && ae->exposure >= ae->expMin && ae->exposure <= ae->expMax && ae->gain >= 16 && ae->gain <= ae->gainMax;
+    }
+}
+
+static void start(camAe_t *ae, sensor_t *s, bool luma, float light, uint16_t exposure){
+    camAeInit(ae, exposure, 16);
+    s->light = light;
+    s->lamp = false;
+    s->luma = luma;
+    s->exposure = exposure;
+    s->gain = 16;
+    s->pending = false;
+}
+
+static void checkConverge(bool luma){
+    static camAe_t ae;
+    static sensor_t s;
+    run_t r;
+    int ok = 1, steps = 1, limits = 1;
+    int worst = 0;
+    static const float lights[] = {1, 4, 0.25f, 0.1f, 2, 1};
+    int i;
+
+    // from too dark and from too bright
+    start(&ae, &s, luma, 1, 5);
+    runAe(&ae, &s, 100, &r);
+    ok = r.settled >= 0 && r.settled <= 30 && r.lastWrite < r.settled + ae.settleFrames + 2 && r.spacingOk;
+    worst = r.settled;
+    start(&ae, &s, luma, 1, 480);
+    runAe(&ae, &s, 100, &r);
+    ok = ok && r.settled >= 0 && r.settled <= 30 && r.lastWrite < r.settled + ae.settleFrames + 2 && r.spacingOk;
+    worst = r.settled > worst ? r.settled : worst;
+    printf("     %s: in the deadband after %d frames at most\n", luma ? "luma" : "RGB565", worst);
+    check(ok, luma ? "luma: gets there from too dark and too bright and stays" : "RGB565: gets there from too dark and too bright and stays");
+
+    // the light changes, each step starts from where the last one ended
+    start(&ae, &s, luma, 1, 100);
+    worst = 0;
+    for(i=0;i<6;i++){
+        s.light = lights[i];
+        runAe(&ae, &s, 60, &r);
+        steps = steps && r.settled >= 0 && r.settled <= 20 && r.orderOk && r.limitsOk && r.spacingOk;
+        worst = r.settled > worst ? r.settled : worst;
+    }
+    printf("     %s: back in the deadband %d frames after a light change at most\n", luma ? "luma" : "RGB565", worst);
+    check(steps, luma ? "luma: settles again after the light steps, exposure before gain" : "RGB565: settles again after the light steps, exposure before gain");
+
+    // too dark even at the limits, and too bright even at the shortest exposure
+    start(&ae, &s, luma, 0.002f, 100);
+    runAe(&ae, &s, 100, &r);
+    limits = r.limitsOk && ae.exposure == ae.expMax && ae.gain >= ae.gainMax - 16 && r.lastWrite < 60;
+    start(&ae, &s, luma, 400, 100);
+    runAe(&ae, &s, 100, &r);
+    limits = limits && r.limitsOk && ae.exposure == ae.expMin && ae.gain == 16 && r.lastWrite < 60;
+    check(limits, luma ? "luma: stops at the limits and stops writing" : "RGB565: stops at the limits and stops writing");
+}
+
+static void checkClipped(){
+    static camAe_t ae;
+    static sensor_t s;
+    run_t r;
+    start(&ae, &s, false, 1, 100);
+    runAe(&ae, &s, 60, &r);
+    uint16_t before = ae.exposure;
+    s.lamp = true;
+    runAe(&ae, &s, 60, &r);
+    // the lamp keeps a third of the image at 255 whatever the exposure
+    check(ae.exposure < before && r.writes > 0 && ae.clipped * 4 > ae.samples, "more than a quarter blown out pulls the exposure down");
+}
+
+static void checkGainCodes(){
+    int code, g;
+    int ok = 1;
+    for(code=0;code<256;code++){
+        // the top bits double, so only codes with the top bits filled from bit 4 up are the ones it makes
+        int top = code >> 4;
+        if (top & (top + 1)){
+            continue;
+        }
+        ok = ok && camAeGainCode(camAeGainValue(code)) == code;
+    }
+    for(g=16;g<=31*16;g++){
+        uint16_t v = camAeGainValue(camAeGainCode(g));
+        ok = ok && v <= g && v * 17 >= g * 16 - 16;
+    }
+    check(ok, "GAIN codes: each gain maps back to its code, and a gain to the one at or just under it");
+}
+
+int main(){
+    checkConverge(false);
+    checkConverge(true);
+    checkClipped();
+    checkGainCodes();
+    return failed;
+}
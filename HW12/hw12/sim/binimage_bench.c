@@ -0,0 +1,255 @@
+// Compares the word at a time operations in binimage.c with plain per pixel versions, for the
+// answers and the time, on the computer.
+//
+//   binimage_bench
+//
+// The per pixel versions keep one byte per pixel and do what the comments in binimage.c say,
+// with a pixel off the edge of the image being the edge pixel.
+//
+// - binErode() and binDilate() against 3x3 min and max, at widths either side of the word edges
+// - binRowCount(), binRowCentroid(), binCentroid(), binRuns() and binRowBytes() against loops
+//   over the pixels, including when there are more runs than asked for
+// - nothing set past sizeX in a row
+// - the time per frame for erode, dilate and centroid both ways
+//
+// Prints what it checked and exits with 1 if anything was wrong.
+// The times are from the computer, only the ratio says anything about the pico.
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "binimage.h"
+
+static int failed = 0;
+
+static void check(int ok, const char *what){
+    printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+    if (!ok){
+        failed = 1;
+    }
+}
+
+static uint32_t noise = 1;
+
+static uint32_t random32(){
+    noise = noise * 1664525 + 1013904223;
+    return noise;
+}
+
+static double nowUs(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// one byte per pixel
+typedef struct pixImage{
+    int sizeX, sizeY;
+    uint8_t p[BIN_MAX_Y][BIN_MAX_X];
+} pixImage_t;
+
+static int pixAt(const pixImage_t *img, int x, int y){
+    x = x < 0 ? 0 : (x >= img->sizeX ? img->sizeX-1 : x);
+    y = y < 0 ? 0 : (y >= img->sizeY ? img->sizeY-1 : y);
+    return img->p[y][x];
+}
+
+// 3x3 min (erode) or max (dilate)
+static void pixMorph(const pixImage_t *in, pixImage_t *out, int dilate){
+    int x, y, dx, dy;
+    out->sizeX = in->sizeX;
+    out->sizeY = in->sizeY;
+    for(y=0;y<in->sizeY;y++){
+        for(x=0;x<in->sizeX;x++){
+            int v = !dilate;
+            for(dy=-1;dy<=1;dy++){
+                for(dx=-1;dx<=1;dx++){
+                    v = dilate ? (v | pixAt(in, x+dx, y+dy)) : (v & pixAt(in, x+dx, y+dy));
+                }
+            }
+            out->p[y][x] = v;
+        }
+    }
+}
+
+static int pixCentroid(const pixImage_t *img, float *cx, float *cy){
+    int x, y;
+    int count = 0, sumX = 0, sumY = 0;
+    for(y=0;y<img->sizeY;y++){
+        for(x=0;x<img->sizeX;x++){
+            if (img->p[y][x]){
+                count++;
+                sumX += x;
+                sumY += y;
+            }
+        }
+    }
+    if (count){
+        *cx = (float)sumX / count;
+        *cy = (float)sumY / count;
+    }
+    return count;
+}
+
+// a made up image: specks at density/256, plus a few solid blocks so runs and erosion have something
+static void makeImage(pixImage_t *pix, binImage_t *bin, int sizeX, int sizeY, int density){
+    int x, y, k;
+    pix->sizeX = sizeX;
+    pix->sizeY = sizeY;
+    binClear(bin, sizeX, sizeY);
+    for(y=0;y<sizeY;y++){
+        for(x=0;x<sizeX;x++){
+            pix->p[y][x] = (random32() >> 24) < (uint32_t)density;
+        }
+    }
+    for(k=0;k<3;k++){
+        int bx = random32() % sizeX, by = random32() % sizeY;
+        int bw = 1 + random32() % 12, bh = 1 + random32() % 8;
+        for(y=by;y<by+bh && y<sizeY;y++){
+            for(x=bx;x<bx+bw && x<sizeX;x++){
+                pix->p[y][x] = 1;
+            }
+        }
+    }
+    for(y=0;y<sizeY;y++){
+        for(x=0;x<sizeX;x++){
+            if (pix->p[y][x]){
+                bin->bits[y][x>>5] |= 1u << (x&31);
+            }
+        }
+    }
+}
+
+// the same pixels, and nothing past sizeX
+static int same(const binImage_t *bin, const pixImage_t *pix){
+    int x, y;
+    if (bin->sizeX != pix->sizeX || bin->sizeY != pix->sizeY){
+        return 0;
+    }
+    for(y=0;y<pix->sizeY;y++){
+        for(x=0;x<bin->words*32;x++){
+            int bit = (bin->bits[y][x>>5] >> (x&31)) & 1;
+            if (bit != (x < pix->sizeX ? pix->p[y][x] : 0)){
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+// the row functions against loops over the pixels
+static int rowsRight(const binImage_t *bin, const pixImage_t *pix){
+    int x, y, i;
+    for(y=0;y<pix->sizeY;y++){
+        const uint8_t *p = pix->p[y];
+        int count = 0, sum = 0;
+        binRun_t want[BIN_MAX_X], got[BIN_MAX_X];
+        int runs = 0;
+        for(x=0;x<pix->sizeX;x++){
+            count += p[x];
+            sum += p[x] ? x : 0;
+            if (p[x] && (x == 0 || !p[x-1])){
+                want[runs].start = x;
+                runs++;
+            }
+            if (p[x] && (x == pix->sizeX-1 || !p[x+1])){
+                want[runs-1].end = x + 1;
+            }
+        }
+        int gotSum;
+        if (binRowCount(bin, y) != count || binRowCentroid(bin, y, &gotSum) != count || gotSum != sum){
+            return 0;
+        }
+        // all the runs, and the first few when there is only room for some
+        int n = binRuns(bin, y, got, BIN_MAX_X);
+        int few = binRuns(bin, y, got + runs, 2);
+        if (n != runs || few != (runs < 2 ? runs : 2)){
+            return 0;
+        }
+        for(i=0;i<runs;i++){
+            if (got[i].start != want[i].start || got[i].end != want[i].end){
+                return 0;
+            }
+        }
+        for(i=0;i<few;i++){
+            if (got[runs+i].start != want[i].start || got[runs+i].end != want[i].end){
+                return 0;
+            }
+        }
+        // bytes with the leftmost pixel in the MSB, padding 0
+        uint8_t bytes[BIN_MAX_X/8 + 1];
+        binRowBytes(bin, y, bytes);
+        for(x=0;x<(pix->sizeX+7)/8*8;x++){
+            int bit = (bytes[x/8] >> (7 - x%8)) & 1;
+            if (bit != (x < pix->sizeX ? p[x] : 0)){
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+static pixImage_t pix, pixOut;
+static binImage_t bin, binOut;
+
+static void timeOps(int sizeX, int sizeY){
+    int frames = 500;
+    int i;
+    float cx, cy;
+    volatile int sink = 0;
+    makeImage(&pix, &bin, sizeX, sizeY, 60);
+    double start = nowUs();
+    for(i=0;i<frames;i++){
+        pixMorph(&pix, &pixOut, 0);
+        pixMorph(&pixOut, &pix, 1);
+        sink += pixCentroid(&pix, &cx, &cy);
+    }
+    double pixUs = (nowUs() - start) / frames;
+    start = nowUs();
+    for(i=0;i<frames;i++){
+        binErode(&bin, &binOut);
+        binDilate(&binOut, &bin);
+        sink += binCentroid(&bin, &cx, &cy);
+    }
+    double binUs = (nowUs() - start) / frames;
+    printf("     %dx%d erode + dilate + centroid: per pixel %.2f us, words %.2f us, %.0fx\n", sizeX, sizeY, pixUs, binUs, pixUs / binUs);
+}
+
+int main(){
+    static const int widths[] = {1, 2, 5, 31, 32, 33, 63, 64, 65, 75, 80, 96, 127, 128, 129, 159, 160};
+    static const int heights[] = {1, 2, 3, 60, 120};
+    static const int densities[] = {0, 30, 128, 230, 256};
+    int w, h, d;
+    int morph = 1, rows = 1, centroid = 1;
+
+    for(w=0;w<17;w++){
+        for(h=0;h<5;h++){
+            for(d=0;d<5;d++){
+                float cx = -1, cy = -1, px = -1, py = -1;
+                makeImage(&pix, &bin, widths[w], heights[h], densities[d]);
+                rows = rows && rowsRight(&bin, &pix);
+                centroid = centroid && binCentroid(&bin, &cx, &cy) == pixCentroid(&pix, &px, &py) && cx == px && cy == py;
+
+                binErode(&bin, &binOut);
+                pixMorph(&pix, &pixOut, 0);
+                morph = morph && same(&binOut, &pixOut);
+                binDilate(&bin, &binOut);
+                pixMorph(&pix, &pixOut, 1);
+                morph = morph && same(&binOut, &pixOut);
+                // and on the result, so the edge bits of an output are checked as an input too
+                binErode(&binOut, &bin);
+                pixMorph(&pixOut, &pix, 0);
+                morph = morph && same(&bin, &pix) && rowsRight(&bin, &pix);
+            }
+        }
+    }
+    check(morph, "binErode() and binDilate() are 3x3 min and max, nothing past the row end");
+    check(rows, "row counts, column sums, runs and bytes are the same as loops over the pixels");
+    check(centroid, "binCentroid() is the same as a loop over the pixels");
+
+    timeOps(80, 60);
+    timeOps(160, 120);
+    printf("     RAM: per pixel %d bytes an image, words %d\n", (int)sizeof(pix.p), (int)sizeof(bin.bits));
+    return failed;
+}
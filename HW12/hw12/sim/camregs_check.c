@@ -0,0 +1,99 @@
+// Checks the register tables camera_set_resolution() and camera_set_roi() send, on the computer.
+//
+//   camregs_check
+//
+// The write logs below are the {register, value} bytes after the address on the I2C bus,
+// as the logic analyser shows them. DIV4, DIV8 and DIV16 are what the original driver
+// (Adafruit's OV7670_set_size()) sent for the whole image. DIV1 and DIV2 don't fit the
+// buffers, so their VSTART/VSTOP/VREF are the 120 rows in the middle that camRoiDefault() picks.
+// DIV2's HREF is 0x36: the edge offset of 4 in OV7670_window doesn't fit its 2 bits.
+//
+// - every size writes the same registers to the same values as the log, each only once
+// - the test pattern bit in SCALING_XSC/YSC is kept
+// - an ROI only changes the three row registers
+//
+// Prints what it checked and exits with 1 if anything was wrong.
+
+#include <stdio.h>
+#include <string.h>
+
+#include "camregs.h"
+
+static int failed = 0;
+
+static void check(int ok, const char *what){
+    printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+    if (!ok){
+        failed = 1;
+    }
+}
+
+static const uint8_t resolutionLog[5][13][2] = {
+    {{0x0C, 0x00}, {0x3E, 0x00}, {0x72, 0x00}, {0x73, 0x08}, {0x70, 0x20}, {0x71, 0x20}, {0x17, 0x14}, {0x18, 0x02}, {0x32, 0x92}, {0x19, 0x2F}, {0x1A, 0x4D}, {0x03, 0x05}, {0xA2, 0x02}},
+    {{0x0C, 0x04}, {0x3E, 0x19}, {0x72, 0x11}, {0x73, 0xF1}, {0x70, 0x20}, {0x71, 0x20}, {0x17, 0x15}, {0x18, 0x03}, {0x32, 0x36}, {0x19, 0x20}, {0x1A, 0x5C}, {0x03, 0x0A}, {0xA2, 0x02}},
+    {{0x0C, 0x04}, {0x3E, 0x1A}, {0x72, 0x22}, {0x73, 0xF2}, {0x70, 0x20}, {0x71, 0x20}, {0x17, 0x17}, {0x18, 0x05}, {0x32, 0x92}, {0x19, 0x02}, {0x1A, 0x7A}, {0x03, 0x0F}, {0xA2, 0x02}},
+    {{0x0C, 0x04}, {0x3E, 0x1B}, {0x72, 0x33}, {0x73, 0xF3}, {0x70, 0x20}, {0x71, 0x20}, {0x17, 0x1A}, {0x18, 0x08}, {0x32, 0x12}, {0x19, 0x03}, {0x1A, 0x7B}, {0x03, 0x00}, {0xA2, 0x02}},
+    {{0x0C, 0x0C}, {0x3E, 0x1C}, {0x72, 0x33}, {0x73, 0xF4}, {0x70, 0x40}, {0x71, 0x40}, {0x17, 0x1F}, {0x18, 0x0D}, {0x32, 0xE4}, {0x19, 0x03}, {0x1A, 0x7B}, {0x03, 0x0F}, {0xA2, 0x02}},
+};
+
+// camera_set_roi() at 80x60 rows 20-39, and at 160x120 rows 30-69
+static const uint8_t roiLog[2][3][2] = {
+    {{0x19, 0x2B}, {0x1A, 0x53}, {0x03, 0x00}},
+    {{0x19, 0x20}, {0x1A, 0x48}, {0x03, 0x0F}},
+};
+
+// the sensor's registers after a list of writes, starting from made up contents.
+// returns 0 if a register is written twice
+static int apply(uint8_t sensor[256], const uint8_t (*regs)[2], int n){
+    int written[256] = {0};
+    int i;
+    int once = 1;
+    for(i=0;i<256;i++){
+        sensor[i] = i * 7 + 3;
+    }
+    for(i=0;i<n;i++){
+        once = once && !written[regs[i][0]];
+        written[regs[i][0]] = 1;
+        sensor[regs[i][0]] = regs[i][1];
+    }
+    return once;
+}
+
+// a table the driver makes against a log, the same writes in any order
+static int sameWrites(const uint8_t (*regs)[2], int n, const uint8_t (*log)[2], int logN){
+    uint8_t a[256], b[256];
+    int once = apply(a, regs, n);
+    apply(b, log, logN);
+    return once && n == logN && !memcmp(a, b, sizeof(a)) && regs[n][0] == 0xff && regs[n][1] == 0xff;
+}
+
+int main(){
+    uint8_t regs[CAMREGS_RESOLUTION_MAX][2];
+    camRoi_t roi;
+    int size, n;
+    int ok = 1;
+
+    for(size=OV7670_SIZE_DIV1;size<=OV7670_SIZE_DIV16;size++){
+        camRoiDefault(&roi, 640 >> size, 480 >> size, 160, 120);
+        n = camRegsResolution(regs, size, 0x3A, 0x3A, &roi);
+        if (!sameWrites((const uint8_t (*)[2])regs, n, resolutionLog[size], 13)){
+            printf("     size %d differs from the log\n", size);
+            ok = 0;
+        }
+    }
+    check(ok, "every resolution writes what the log has");
+
+    camRoiDefault(&roi, 80, 60, 160, 120);
+    camRegsResolution(regs, OV7670_SIZE_DIV8, 0xA5, 0x25, &roi);
+    check(regs[4][0] == OV7670_REG_SCALING_XSC && regs[4][1] == 0xA0 && regs[5][1] == 0x20, "the test pattern bits are kept");
+
+    ok = camRoiSet(&roi, 80, 60, 0, 20, 80, 20, 160, 120);
+    n = camRegsEnd(regs, camRegsWindowRows(regs, 0, OV7670_SIZE_DIV8, &roi));
+    ok = ok && sameWrites((const uint8_t (*)[2])regs, n, roiLog[0], 3);
+    ok = ok && camRoiSet(&roi, 160, 120, 20, 30, 100, 40, 160, 120);
+    n = camRegsEnd(regs, camRegsWindowRows(regs, 0, OV7670_SIZE_DIV4, &roi));
+    ok = ok && sameWrites((const uint8_t (*)[2])regs, n, roiLog[1], 3);
+    check(ok, "an ROI writes only the row registers in the log");
+
+    return failed;
+}
@@ -0,0 +1,250 @@
+// Checks the stream mode buffer rotation in camring.c on the computer, with a fake capture source.
+//
+//   camring_check
+//
+// The fake source writes the frame number over a whole buffer and then does what
+// camera_frame_done() does, the application side does what getFrame() does and reads its
+// buffer back while the source keeps going.
+//
+// - a frame is always there to take after each one finished, however the two sides interleave
+// - the buffer taken is never the one being filled, and a taken frame is never written over
+// - the frame taken is the newest one, frame numbers only go up
+// - every frame is either taken or counted as dropped
+// - the same with the source and the application on two threads
+//
+// Prints what it checked and exits with 1 if anything was wrong.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "camring.h"
+
+#define WORDS 64 // a small frame is enough to catch a buffer being shared
+
+static int failed = 0;
+
+static void check(int ok, const char *what){
+    printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+    if (!ok){
+        failed = 1;
+    }
+}
+
+static uint32_t noise = 1;
+
+static uint32_t random32(){
+    noise = noise * 1664525 + 1013904223;
+    return noise;
+}
+
+typedef struct fakeCam{
+    camRing_t ring;
+    uint32_t buffers[CAMRING_BUFFERS][WORDS];
+    uint32_t published; // frames finished
+    uint32_t taken;
+    int held; // -1 before the first take
+    uint32_t heldSeq;
+    int bad; // something the checks above don't allow
+} fakeCam_t;
+
+static void fakeInit(fakeCam_t *c){
+    camRingInit(&c->ring);
+    memset(c->buffers, 0xFF, sizeof(c->buffers));
+    c->published = 0;
+    c->taken = 0;
+    c->held = -1;
+    c->heldSeq = 0;
+    c->bad = 0;
+}
+
+// the DMA writing part of a frame into the fill buffer
+static void fakeCapture(fakeCam_t *c, int from, int to){
+    int fill = camRingFill(&c->ring);
+    int i;
+    if (fill == c->held){
+        c->bad = 1;
+    }
+    for(i=from;i<to;i++){
+        c->buffers[fill][i] = c->published;
+    }
+}
+
+// the end of frame interrupt
+static void fakeDone(fakeCam_t *c){
+    camRingPublish(&c->ring);
+    c->published++;
+}
+
+// getFrame() that doesn't wait, returns 0 if nothing new
+static int fakeTake(fakeCam_t *c){
+    int buf;
+    uint32_t seq;
+    if (!camRingTake(&c->ring, &buf, &seq)){
+        return 0;
+    }
+    if ((c->taken && seq <= c->heldSeq) || seq != c->published - 1 || buf == camRingFill(&c->ring)){
+        c->bad = 1;
+    }
+    c->held = buf;
+    c->heldSeq = seq;
+    c->taken++;
+    return 1;
+}
+
+// the application reading its frame, every word must still be its frame number
+static void fakeRead(fakeCam_t *c){
+    int i;
+    if (c->held < 0){
+        return;
+    }
+    for(i=0;i<WORDS;i++){
+        if (c->buffers[c->held][i] != c->heldSeq){
+            c->bad = 1;
+        }
+    }
+}
+
+// the order the old two buffer rotation got stuck on: take one frame, then wait for the next
+static void checkSteady(){
+    static fakeCam_t c;
+    int i;
+    int ok = 1;
+    fakeInit(&c);
+    for(i=0;i<100;i++){
+        fakeCapture(&c, 0, WORDS);
+        fakeDone(&c);
+        ok = ok && fakeTake(&c);
+        fakeRead(&c);
+    }
+    check(ok && !c.bad && camRingDropped(&c.ring) == 0, "a frame to take after every frame, none dropped when keeping up");
+
+    // a slow application: three frames finish for each one it takes
+    fakeInit(&c);
+    ok = 1;
+    for(i=0;i<300;i++){
+        fakeCapture(&c, 0, WORDS);
+        fakeDone(&c);
+        if (i % 3 == 2){
+            ok = ok && fakeTake(&c);
+            fakeRead(&c);
+        }
+    }
+    check(ok && !c.bad && camRingDropped(&c.ring) == 200 && c.taken == 100, "a slow application gets the newest frame, the others count as dropped");
+}
+
+// the two sides in a random order, the capture part way through a frame when the application runs
+static void checkRandom(){
+    static fakeCam_t c;
+    int r, i;
+    int stuck = 0;
+    fakeInit(&c);
+    for(r=0;r<200000;r++){
+        int at = 0;
+        int kind = random32() % 4;
+        int steps = random32() % 4;
+        for(i=0;i<steps;i++){
+            // application: maybe take, then read while the capture carries on
+            int next = at + random32() % (WORDS - at + 1);
+            fakeCapture(&c, at, next);
+            at = next;
+            if (kind){
+                fakeTake(&c);
+            }
+            fakeRead(&c);
+        }
+        fakeCapture(&c, at, WORDS);
+        fakeDone(&c);
+        // getFrame() straight after a frame must never find nothing
+        if (kind == 3 && !fakeTake(&c)){
+            stuck = 1;
+        }
+        fakeRead(&c);
+    }
+    uint32_t pending = atomic_load(&c.ring.middle) & CAMRING_FRESH ? 1 : 0;
+    check(!c.bad, "random interleaving: never the fill buffer, never written over, always the newest");
+    check(!stuck, "random interleaving: a frame is always there after one finished");
+    check(c.taken + camRingDropped(&c.ring) + pending == c.published, "every frame is taken or counted as dropped");
+}
+
+// the source and the application on their own threads
+typedef struct threaded{
+    camRing_t ring;
+    uint32_t buffers[CAMRING_BUFFERS][WORDS];
+    atomic_int running;
+    uint32_t frames;
+    uint32_t taken;
+    int bad;
+} threaded_t;
+
+static void *sourceThread(void *arg){
+    threaded_t *t = arg;
+    uint32_t n, i;
+    for(n=0;n<t->frames;n++){
+        uint32_t *buf = t->buffers[camRingFill(&t->ring)];
+        for(i=0;i<WORDS;i++){
+            buf[i] = n;
+        }
+        camRingPublish(&t->ring);
+        if (n % 3 == 0){
+            sched_yield(); // lets the application in on a single core too
+        }
+    }
+    atomic_store(&t->running, 0);
+    return NULL;
+}
+
+static void *appThread(void *arg){
+    threaded_t *t = arg;
+    uint32_t last = 0;
+    int buf, i;
+    uint32_t seq;
+    while (1){
+        int running = atomic_load(&t->running);
+        if (camRingTake(&t->ring, &buf, &seq)){
+            if (t->taken && seq <= last){
+                t->bad = 1;
+            }
+            last = seq;
+            t->taken++;
+            // read it twice with the source writing meanwhile, it must not change
+            for(i=0;i<2*WORDS;i++){
+                if (t->buffers[buf][i % WORDS] != seq){
+                    t->bad = 1;
+                }
+            }
+        }
+        else if (!running){
+            break;
+        }
+        else {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void checkThreads(){
+    static threaded_t t;
+    pthread_t src, app;
+    camRingInit(&t.ring);
+    atomic_store(&t.running, 1);
+    t.frames = 200000;
+    t.taken = 0;
+    t.bad = 0;
+    pthread_create(&app, NULL, appThread, &t);
+    pthread_create(&src, NULL, sourceThread, &t);
+    pthread_join(src, NULL);
+    pthread_join(app, NULL);
+    check(!t.bad && t.taken > 0 && t.taken + camRingDropped(&t.ring) == t.frames, "two threads: frames whole and in order, all accounted for");
+    printf("     %u frames, %u taken, %u dropped\n", t.frames, t.taken, camRingDropped(&t.ring));
+}
+
+int main(){
+    checkSteady();
+    checkRandom();
+    checkThreads();
+    return failed;
+}
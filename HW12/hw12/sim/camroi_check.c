@@ -0,0 +1,201 @@
+// Checks the ROI bookkeeping in camroi.c on the computer, against a made up sensor.
+//
+//   camroi_check
+//
+// Every pixel the made up sensor sends says where it came from, so a window that is off by a
+// row, a column or a byte shows up.
+//
+// - camRoiSet() takes exactly the windows that are inside the image, fit the buffers and are
+//   whole words wide, and leaves the ROI alone when it refuses one
+// - camRoiDefault() is the whole image when it fits, otherwise the middle, at every resolution
+// - camRoiCrop() keeps the right pixels and bytes, RGB565 and luma
+// - the skip, row and frame byte counts the PIO and DMA are set up with match the crop
+// - the sensor rows from camRoiRows() are the window's rows
+// - a line found in a window is at its column in the full image less the window's x
+//
+// Prints what it checked and exits with 1 if anything was wrong.
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "camroi.h"
+#include "linefind.h"
+
+static int failed = 0;
+
+static void check(int ok, const char *what){
+    printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+    if (!ok){
+        failed = 1;
+    }
+}
+
+// the two bytes the made up sensor sends for pixel x, y
+static uint8_t byte0(int x, int y){
+    return x * 7 + y * 13;
+}
+
+static uint8_t byte1(int x, int y){
+    return (x >> 3) ^ (y * 5);
+}
+
+static uint8_t full[640*480*2];
+static uint8_t out[BIN_MAX_X*BIN_MAX_Y*2 + 4]; // and a word to see nothing is written past the frame
+
+static void sense(int fullX, int fullY){
+    int x, y;
+    for(y=0;y<fullY;y++){
+        for(x=0;x<fullX;x++){
+            full[(y*fullX + x)*2] = byte0(x, y);
+            full[(y*fullX + x)*2 + 1] = byte1(x, y);
+        }
+    }
+}
+
+// the crop against where each byte came from
+static int cropRight(const camRoi_t *r, bool luma){
+    int x, y;
+    memset(out, 0xEE, sizeof(out));
+    camRoiCrop(r, full, out, luma);
+    for(y=0;y<r->h;y++){
+        for(x=0;x<r->w;x++){
+            if (luma){
+                if (out[y*r->w + x] != byte0(r->x + x, r->y + y)){
+                    return 0;
+                }
+            }
+            else if (out[(y*r->w + x)*2] != byte0(r->x + x, r->y + y) || out[(y*r->w + x)*2 + 1] != byte1(r->x + x, r->y + y)){
+                return 0;
+            }
+        }
+    }
+    // nothing written past the frame
+    int bytes = camRoiFrameBytes(r, luma ? 1 : 2);
+    return out[bytes] == 0xEE;
+}
+
+// the byte counts cam_arm_capture() uses against the crop: skip, then a row, then the rest of the row
+static int countsRight(const camRoi_t *r){
+    uint32_t skip = camRoiSkipBytes(r);
+    return skip == r->x * 2u && skip % 4 == 0 && skip + r->w*2u <= r->fullX*2u
+        && camRoiFrameBytes(r, 2) == r->w*r->h*2u && camRoiFrameBytes(r, 1) == (uint32_t)r->w*r->h
+        && camRoiFrameBytes(r, 1) % 4 == 0;
+}
+
+static void checkSet(){
+    camRoi_t r, before;
+    int x, y, w, h;
+    int ok = 1;
+    int taken = 0;
+    // every window on a 40x30 image with a 24x20 buffer
+    for(x=0;x<=41;x++){
+        for(y=0;y<=31;y++){
+            for(w=0;w<=42;w++){
+                for(h=0;h<=32;h+=3){
+                    bool want = w > 0 && h > 0 && w % 4 == 0 && x + w <= 40 && y + h <= 30 && w <= 24 && h <= 20;
+                    camRoiDefault(&r, 40, 30, 24, 20);
+                    before = r;
+                    bool got = camRoiSet(&r, 40, 30, x, y, w, h, 24, 20);
+                    if (got != want){
+                        ok = 0;
+                    }
+                    else if (got){
+                        ok = ok && r.x == x && r.y == y && r.w == w && r.h == h && r.fullX == 40 && r.fullY == 30;
+                        taken++;
+                    }
+                    else {
+                        ok = ok && !memcmp(&r, &before, sizeof(r));
+                    }
+                }
+            }
+        }
+    }
+    printf("     %d windows taken\n", taken);
+    check(ok, "camRoiSet() takes exactly the windows that fit, and leaves the ROI alone otherwise");
+}
+
+static void checkDefault(){
+    camRoi_t r;
+    int size;
+    int ok = 1, crops = 1;
+    for(size=0;size<=4;size++){
+        int fullX = 640 >> size, fullY = 480 >> size;
+        camRoiDefault(&r, fullX, fullY, BIN_MAX_X, BIN_MAX_Y);
+        if (fullX <= BIN_MAX_X && fullY <= BIN_MAX_Y){
+            ok = ok && r.x == 0 && r.y == 0 && r.w == fullX && r.h == fullY;
+        }
+        else {
+            // in the middle, to within the word the left edge is rounded down to
+            int left = r.x, right = fullX - r.x - r.w;
+            int top = r.y, bottom = fullY - r.y - r.h;
+            ok = ok && r.w == BIN_MAX_X && r.h == BIN_MAX_Y && right - left >= 0 && right - left < 8 && bottom - top >= 0 && bottom - top <= 1;
+        }
+        ok = ok && countsRight(&r);
+        sense(fullX, fullY);
+        crops = crops && cropRight(&r, false) && cropRight(&r, true);
+    }
+    check(ok, "camRoiDefault(): the whole image when it fits, the middle when it doesn't");
+    check(crops, "camRoiDefault(): the crop keeps the right bytes at every resolution");
+}
+
+static void checkWindows(){
+    static const int windows[][4] = {
+        {0, 0, 4, 1}, {76, 59, 4, 1}, {0, 0, 80, 60}, {1, 1, 8, 2}, {3, 7, 40, 30}, {37, 20, 12, 40},
+    };
+    camRoi_t r;
+    int i;
+    int ok = 1;
+    sense(80, 60);
+    for(i=0;i<6;i++){
+        ok = ok && camRoiSet(&r, 80, 60, windows[i][0], windows[i][1], windows[i][2], windows[i][3], BIN_MAX_X, BIN_MAX_Y);
+        ok = ok && cropRight(&r, false) && cropRight(&r, true);
+        ok = ok && camRoiSkipBytes(&r) == r.x * 2u && camRoiFrameBytes(&r, 2) == 2*camRoiFrameBytes(&r, 1);
+    }
+    check(ok, "windows at the corners, odd offsets and full size crop the right bytes");
+
+    // the rows the sensor sends: VSTART 10, 4 sensor rows per output row at 160x120
+    uint16_t first, stop;
+    camRoiSet(&r, 160, 120, 0, 30, 160, 40, BIN_MAX_X, BIN_MAX_Y);
+    camRoiRows(&r, 10, 4, &first, &stop);
+    ok = first == 10 + 30*4 && stop == first + 40*4;
+    camRoiDefault(&r, 160, 120, BIN_MAX_X, BIN_MAX_Y);
+    camRoiRows(&r, 10, 4, &first, &stop);
+    ok = ok && first == 10 && stop == 10 + 120*4;
+    check(ok, "camRoiRows(): the sensor rows are the window's rows");
+}
+
+// a vertical line at a known column of the full image, found in a window
+static void checkLine(){
+    static const int windows[][4] = {{0, 0, 160, 120}, {40, 0, 80, 120}, {80, 30, 48, 60}, {100, 90, 60, 30}};
+    camRoi_t r;
+    int i, x, y;
+    int ok = 1;
+    int col = 110;
+    for(y=0;y<120;y++){
+        for(x=0;x<160;x++){
+            uint16_t px = x >= col - 2 && x <= col + 2 ? 0xFFFF : 0x2104;
+            full[(y*160 + x)*2] = px & 0xFF;
+            full[(y*160 + x)*2 + 1] = px >> 8;
+        }
+    }
+    for(i=0;i<4;i++){
+        camRoiSet(&r, 160, 120, windows[i][0], windows[i][1], windows[i][2], windows[i][3], BIN_MAX_X, BIN_MAX_Y);
+        camRoiCrop(&r, full, out, false);
+        camFrame_t f = {out, r.w, r.h, 2};
+        int rows[3] = {0, r.h/2, r.h-1};
+        lineTrack_t t;
+        frameTrackLine(&f, rows, 3, &t);
+        ok = ok && frameFindLine(&f, r.h/2) == col - r.x;
+        ok = ok && t.rows == 3 && fabsf(t.offset + (r.w - 1) / 2.0f + r.x - col) < 0.01f;
+    }
+    check(ok, "a line in a window is at its full image column less the window's x");
+}
+
+int main(){
+    checkSet();
+    checkDefault();
+    checkWindows();
+    checkLine();
+    return failed;
+}
@@ -0,0 +1,186 @@
+// Checks the capture telemetry in camstats.c on the computer, with made up VS/HS/end of frame sequences.
+//
+//   camstats_check
+//
+// The sequences are what cam_gpio_callback() and cam_dma_handler() pass in: the time, and the
+// bytes the DMA has written so far, which it only knows to the nearest 4 byte word.
+//
+// - good frames count as frames and nothing else, whatever the row length is against the word size
+// - a short or long row, a missing or extra row, a FIFO overrun and a frame cut short by the
+//   next VS each count once, against the right counter
+// - edges while nothing is armed don't count
+// - the histograms: bin edges, the last bin holding everything above, min, max and average,
+//   and periods across the 32 bit microsecond wrap
+//
+// Prints what it checked and exits with 1 if anything was wrong.
+
+#include <stdio.h>
+#include <string.h>
+
+#include "camstats.h"
+
+static int failed = 0;
+
+static void check(int ok, const char *what){
+    printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+    if (!ok){
+        failed = 1;
+    }
+}
+
+// how a made up frame goes wrong
+typedef struct badFrame{
+    int shortRow; // this row is 8 bytes short, -1 for none
+    int longRow; // this row is 8 bytes long, -1 for none
+    int rows; // rows the sensor sends, 0 for the right number
+    int cutAt; // the next VS comes after this many rows, 0 for none
+    bool overrun;
+    bool armed;
+} badFrame_t;
+
+static const badFrame_t good = {-1, -1, 0, 0, false, true};
+
+// what cam_bytes() reads back, whole words only
+static uint32_t dmaBytes(uint32_t bytes){
+    return bytes & ~3u;
+}
+
+// one frame of sizeY rows of rowBytes starting with the VS at time now, rows 500us apart.
+// returns the time the frame ended
+static uint32_t sendFrame(camStats_t *s, uint32_t now, int sizeY, int rowBytes, badFrame_t b){
+    int rows = b.rows ? b.rows : sizeY;
+    uint32_t bytes = 0;
+    int i;
+    camStatsVS(s, now, 0, b.armed);
+    for(i=0;i<rows;i++){
+        now += 500;
+        camStatsHS(s, b.armed ? dmaBytes(bytes) : 0);
+        if (b.cutAt && i == b.cutAt){
+            return now;
+        }
+        bytes += rowBytes;
+        bytes += i == b.shortRow ? -8 : 0;
+        bytes += i == b.longRow ? 8 : 0;
+    }
+    if (b.armed){
+        camStatsDone(s, now + 500, dmaBytes(bytes), sizeY, rowBytes, b.overrun);
+    }
+    return now + 500;
+}
+
+// what the counters should be
+static int counts(const camStats_t *s, uint32_t frames, uint32_t overruns, uint32_t underruns, uint32_t rowErrors, uint32_t byteErrors){
+    return s->frames == frames && s->overruns == overruns && s->underruns == underruns
+        && s->rowErrors == rowErrors && s->byteErrors == byteErrors;
+}
+
+static void checkFrames(){
+    static camStats_t s;
+    static const int widths[] = {160, 80, 78, 77, 75, 1280};
+    int i, w;
+    int ok = 1;
+    uint32_t now = 1000;
+
+    for(w=0;w<6;w++){
+        camStatsInit(&s);
+        for(i=0;i<10;i++){
+            sendFrame(&s, now, 60, widths[w], good);
+            now += 33333;
+        }
+        ok = ok && counts(&s, 10, 0, 0, 0, 0) && s.lastRows == 60;
+        ok = ok && s.lastRowMin + 4 >= (uint32_t)widths[w] && s.lastRowMax <= (uint32_t)widths[w] + 4;
+    }
+    check(ok, "good frames at row lengths that are and aren't whole words count as frames only");
+
+    badFrame_t b;
+    camStatsInit(&s);
+    b = good;
+    b.shortRow = 17;
+    sendFrame(&s, now, 60, 160, b);
+    ok = counts(&s, 1, 0, 0, 0, 1) && s.lastRowMin == 152;
+    b = good;
+    b.longRow = 59;
+    sendFrame(&s, now += 33333, 60, 160, b);
+    ok = ok && counts(&s, 2, 0, 0, 0, 2) && s.lastRowMax == 168;
+    check(ok, "a short row and a long last row are byte errors");
+
+    camStatsInit(&s);
+    b = good;
+    b.rows = 59;
+    sendFrame(&s, now += 33333, 60, 160, b);
+    ok = counts(&s, 1, 0, 0, 1, 0) && s.lastRows == 59;
+    b.rows = 61;
+    sendFrame(&s, now += 33333, 60, 160, b);
+    ok = ok && counts(&s, 2, 0, 0, 2, 0) && s.lastRows == 61;
+    check(ok, "a missing and an extra row are row errors");
+
+    camStatsInit(&s);
+    b = good;
+    b.overrun = true;
+    sendFrame(&s, now += 33333, 60, 160, b);
+    check(counts(&s, 1, 1, 0, 0, 0), "a FIFO overrun counts once");
+
+    // the frame is cut short, the next VS finds it armed with bytes captured
+    camStatsInit(&s);
+    b = good;
+    b.cutAt = 30;
+    uint32_t end = sendFrame(&s, now += 33333, 60, 160, b);
+    camStatsVS(&s, end + 100, 30*160, true);
+    ok = counts(&s, 0, 0, 1, 0, 0);
+    // a VS with nothing captured yet is just the start
+    camStatsVS(&s, end + 200, 0, true);
+    ok = ok && counts(&s, 0, 0, 1, 0, 0);
+    check(ok, "a frame cut short by the next VS is an underrun, not a frame");
+
+    camStatsInit(&s);
+    b = good;
+    b.armed = false;
+    for(i=0;i<5;i++){
+        sendFrame(&s, now += 33333, 60, 160, b);
+    }
+    camStatsDone(&s, now, 1234, 60, 160, true);
+    ok = counts(&s, 0, 0, 0, 0, 0) && s.rows == 0 && s.period.count == 4;
+    check(ok, "nothing armed: the VS period is kept, no frames, rows or errors");
+}
+
+static void checkHist(){
+    static camHist_t h;
+    int i;
+    int ok = 1;
+    camHistInit(&h, 100);
+    // each bin edge, one below it, and far past the end
+    for(i=0;i<CAMSTATS_BINS;i++){
+        camHistAdd(&h, i*100);
+        camHistAdd(&h, i*100 + 99);
+    }
+    camHistAdd(&h, 1000000);
+    camHistAdd(&h, 0xFFFFFFFF);
+    for(i=0;i<CAMSTATS_BINS-1;i++){
+        ok = ok && h.bins[i] == 2;
+    }
+    ok = ok && h.bins[CAMSTATS_BINS-1] == 4 && h.count == 2*CAMSTATS_BINS + 2;
+    ok = ok && h.min == 0 && h.max == 0xFFFFFFFF;
+    uint64_t sum = 0;
+    for(i=0;i<CAMSTATS_BINS;i++){
+        sum += 2*i*100 + 99;
+    }
+    ok = ok && h.sum == sum + 1000000 + 0xFFFFFFFFull;
+    check(ok, "histogram: bin edges, the last bin takes everything above, min, max and sum");
+
+    static camStats_t s;
+    camStatsInit(&s);
+    uint32_t now = 0xFFFFFFFF - 50000;
+    for(i=0;i<4;i++){
+        sendFrame(&s, now, 60, 160, good);
+        now += 33333;
+    }
+    ok = s.period.count == 3 && s.period.min == 33333 && s.period.max == 33333 && s.period.bins[1] == 3;
+    ok = ok && s.duration.count == 4 && s.duration.min == 30500 && s.duration.max == 30500;
+    check(ok, "VS period and capture time across the microsecond counter wrapping");
+}
+
+int main(){
+    checkFrames();
+    checkHist();
+    return failed;
+}
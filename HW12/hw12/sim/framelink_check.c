@@ -0,0 +1,228 @@
+// Checks the binary frames framelink.c sends, on the computer.
+//
+//   framelink_check
+//
+// The frames go to a sink that keeps the bytes in memory, and are read back with readFrame()
+// from frames.c, the same decoder replay uses.
+//
+// - RGB565, luma and binary frames, raw and PackBits, come back byte for byte
+// - PackBits edge cases: runs of 2 to 257 between literals of 0 to 300 bytes,
+//   a run at the very end, all one byte, no repeats at all
+// - the payload split over many frameTxWrite() calls sends the same bytes as one call
+// - the CRC is zlib's, and any single bit flipped after the magic is caught
+// - the sink never gets more than FRAMELINK_CHUNK bytes at a time
+//
+// Prints what it checked and exits with 1 if anything was wrong.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "framelink.h"
+#include "frames.h"
+
+static int failed = 0;
+
+static void check(int ok, const char *what){
+    printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+    if (!ok){
+        failed = 1;
+    }
+}
+
+#define WIRE_MAX (FRAMES_MAX_X*FRAMES_MAX_Y*3)
+
+// what went over the wire
+static uint8_t wire[WIRE_MAX];
+static int wireLen;
+static int bigChunk; // a sink call with more than FRAMELINK_CHUNK bytes
+
+static void memSink(const uint8_t *data, int len){
+    if (len > FRAMELINK_CHUNK || wireLen + len > WIRE_MAX){
+        bigChunk = 1;
+        return;
+    }
+    memcpy(wire + wireLen, data, len);
+    wireLen += len;
+}
+
+static uint32_t noise = 1;
+
+static uint8_t random8(){
+    noise = noise * 1664525 + 1013904223;
+    return noise >> 24;
+}
+
+// the bitwise CRC-32 zlib uses
+static uint32_t crc32(const uint8_t *p, int n){
+    uint32_t crc = 0xFFFFFFFF;
+    int i, k;
+    for(i=0;i<n;i++){
+        crc ^= p[i];
+        for(k=0;k<8;k++){
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
+
+// send data as one frame, in pieces of at most piece bytes (0 is all at once)
+static void send(uint8_t format, uint8_t flags, int sizeX, int sizeY, uint32_t seq, const uint8_t *data, int len, int piece){
+    frameTx_t f;
+    int at = 0;
+    wireLen = 0;
+    frameTxBegin(&f, memSink, format, flags, sizeX, sizeY, seq);
+    while (at < len){
+        int n = piece ? 1 + random8() % piece : len;
+        n = n < len - at ? n : len - at;
+        frameTxWrite(&f, data + at, n);
+        at += n;
+    }
+    frameTxEnd(&f);
+}
+
+static uint8_t raw[FRAMES_MAX_X*FRAMES_MAX_Y*2];
+static uint8_t back[FRAMES_MAX_X*FRAMES_MAX_Y*2];
+
+static uint8_t gotFormat;
+static int gotX, gotY;
+static uint32_t gotSeq;
+
+// readFrame() on what is on the wire
+static int readWire(){
+    FILE *in = fmemopen(wire, wireLen, "rb");
+    int r = readFrame(in, back, sizeof(back), &gotFormat, &gotX, &gotY, &gotSeq);
+    fclose(in);
+    return r;
+}
+
+// read what is on the wire back, returns 1 if it is the frame that was sent
+static int readBack(uint8_t format, int sizeX, int sizeY, uint32_t seq, const uint8_t *data, int len){
+    return readWire() == 1 && gotFormat == format && gotX == sizeX && gotY == sizeY && gotSeq == seq && !memcmp(back, data, len);
+}
+
+// both ways, one call and in pieces, returns 1 if all of them came back
+static int roundTrip(uint8_t format, int sizeX, int sizeY, const uint8_t *data, int len){
+    static uint32_t seq = 0x12345678;
+    int flags, piece;
+    int ok = 1;
+    for(flags=0;flags<=FRAME_RLE;flags++){
+        for(piece=0;piece<=130;piece+=13){
+            seq += 0x01010101;
+            send(format, flags, sizeX, sizeY, seq, data, len, piece);
+            ok = ok && readBack(format, sizeX, sizeY, seq, data, len);
+            ok = ok && crc32(wire, wireLen - 4) == (wire[wireLen-4] | (wire[wireLen-3] << 8) | (wire[wireLen-2] << 16) | ((uint32_t)wire[wireLen-1] << 24));
+        }
+    }
+    return ok;
+}
+
+// a luma frame of 40x30 that is one pattern: runs of run bytes, then lit bytes with no repeats
+static int pattern(int run, int lit, int endRun){
+    int n = 40*30;
+    int at = 0;
+    uint8_t b = 0;
+    while (at < n){
+        int i;
+        b += 37;
+        for(i=0;i<run && at<n;i++){
+            raw[at++] = b;
+        }
+        for(i=0;i<lit && at<n;i++){
+            raw[at++] = b + 1 + i;
+        }
+    }
+    if (endRun){
+        memset(raw + n - endRun, 0xAA, endRun);
+    }
+    return roundTrip(FRAME_LUMA, 40, 30, raw, n);
+}
+
+static void checkRle(){
+    static const int runs[] = {2, 3, 127, 128, 129, 130, 255, 256, 257};
+    static const int lits[] = {0, 1, 2, 126, 127, 128, 129, 300};
+    int i, j;
+    int ok = 1;
+    for(i=0;i<9;i++){
+        for(j=0;j<8;j++){
+            ok = ok && pattern(runs[i], lits[j], 0);
+        }
+    }
+    check(ok, "PackBits: runs of 2 to 257 between literals of 0 to 300 bytes");
+    check(pattern(1, 0, 5) && pattern(0, 300, 2) && pattern(0, 300, 129) && pattern(5, 2, 1), "PackBits: runs and literals that end the frame");
+
+    memset(raw, 0x33, 40*30);
+    ok = roundTrip(FRAME_LUMA, 40, 30, raw, 40*30);
+    send(FRAME_LUMA, FRAME_RLE, 40, 30, 1, raw, 40*30, 0);
+    check(ok && wireLen == 12 + 2*((40*30 + 127)/128) + 4, "PackBits: all one byte is a run packet per 128");
+
+    for(i=0;i<40*30;i++){
+        raw[i] = i * 7;
+    }
+    ok = roundTrip(FRAME_LUMA, 40, 30, raw, 40*30);
+    send(FRAME_LUMA, FRAME_RLE, 40, 30, 1, raw, 40*30, 0);
+    check(ok && wireLen == 12 + 40*30 + (40*30 + 127)/128 + 4, "PackBits: no repeats costs one byte per 128");
+}
+
+static void checkFormats(){
+    int luma, i;
+    int ok = 1;
+    for(luma=0;luma<2;luma++){
+        makeFrame(raw, 3, 80, 60, luma);
+        if (luma){
+            // luma frames are the Y bytes only, see camRoiCrop()
+            for(i=0;i<80*60;i++){
+                raw[i] = raw[2*i];
+            }
+        }
+        ok = ok && roundTrip(luma ? FRAME_LUMA : FRAME_RGB565, 80, 60, raw, 80*60*(luma ? 1 : 2));
+    }
+    makeFrame(raw, 3, 320, 240, 0);
+    ok = ok && roundTrip(FRAME_RGB565, 320, 240, raw, 320*240*2);
+    check(ok, "RGB565 and luma frames come back byte for byte");
+
+    // a thresholded line, rows of 10 bytes with the rest of the last byte padded
+    int rowBytes = (75 + 7)/8;
+    memset(raw, 0, rowBytes*60);
+    for(i=0;i<60;i++){
+        raw[i*rowBytes + 3 + i/20] = 0xF0;
+    }
+    ok = roundTrip(FRAME_BINARY, 75, 60, raw, rowBytes*60);
+    send(FRAME_BINARY, FRAME_RLE, 75, 60, 1, raw, rowBytes*60, 0);
+    check(ok, "binary frames with padded rows come back");
+    printf("     binary 75x60: %d bytes raw, %d with PackBits\n", 12 + rowBytes*60 + 4, wireLen);
+}
+
+static void checkCrc(){
+    check(crc32((const uint8_t *)"123456789", 9) == 0xCBF43926, "the CRC is zlib's CRC-32");
+
+    static uint8_t sent[WIRE_MAX];
+    int flags, i, bit;
+    int caught = 1;
+    int flips = 0;
+    makeFrame(raw, 9, 40, 30, 0);
+    for(flags=0;flags<=FRAME_RLE;flags++){
+        send(FRAME_RGB565, flags, 40, 30, 77, raw, 40*30*2, 0);
+        int len = wireLen;
+        memcpy(sent, wire, len);
+        for(i=2;i<len;i++){
+            for(bit=0;bit<8;bit++){
+                memcpy(wire, sent, len);
+                wire[i] ^= 1 << bit;
+                wireLen = len;
+                caught = caught && readWire() != 1;
+                flips++;
+            }
+        }
+    }
+    printf("     %d single bit flips\n", flips);
+    check(caught, "every single bit flipped after the magic is caught");
+    check(!bigChunk, "the sink never gets more than FRAMELINK_CHUNK bytes");
+}
+
+int main(){
+    checkFormats();
+    checkRle();
+    checkCrc();
+    return failed;
+}
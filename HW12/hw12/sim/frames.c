@@ -0,0 +1,124 @@
+#include <string.h>
+#include <math.h>
+
+#include "frames.h"
+#include "framelink.h"
+
+// same CRC-32 as framelink.c and zlib
+static uint32_t crc32Add(uint32_t crc, const uint8_t *p, int n){
+    int i, k;
+    for(i=0;i<n;i++){
+        crc ^= p[i];
+        for(k=0;k<8;k++){
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+        }
+    }
+    return crc;
+}
+
+// read one sendImage() frame from a trace into raw, which holds max bytes.
+// returns 0 at the end of the file, -1 on a bad frame
+int readFrame(FILE *in, uint8_t *raw, int max, uint8_t *format, int *sizeX, int *sizeY, uint32_t *seq){
+    uint8_t h[12];
+    int c, last = 0;
+    // find the sync bytes
+    while ((c = fgetc(in)) != EOF){
+        if (last == 'F' && c == 'R'){
+            break;
+        }
+        last = c;
+    }
+    if (c == EOF || fread(h+2, 1, 10, in) != 10){
+        return 0;
+    }
+    h[0] = 'F';
+    h[1] = 'R';
+    *format = h[2];
+    uint8_t flags = h[3];
+    *sizeX = h[4] | (h[5] << 8);
+    *sizeY = h[6] | (h[7] << 8);
+    *seq = h[8] | (h[9] << 8) | (h[10] << 16) | ((uint32_t)h[11] << 24);
+
+    int size;
+    if (*format == FRAME_RGB565){
+        size = *sizeX * *sizeY * 2;
+    }
+    else if (*format == FRAME_LUMA){
+        size = *sizeX * *sizeY;
+    }
+    else {
+        size = ((*sizeX+7)/8) * *sizeY;
+    }
+    if (size > max){
+        return -1;
+    }
+
+    uint32_t crc = crc32Add(0xFFFFFFFF, h, 12);
+    int got = 0;
+    while (got < size){
+        if (!(flags & FRAME_RLE)){
+            if (fread(raw, 1, size, in) != (size_t)size){
+                return 0;
+            }
+            crc = crc32Add(crc, raw, size);
+            got = size;
+            break;
+        }
+        // PackBits, see framelink.h
+        uint8_t n, b;
+        if (fread(&n, 1, 1, in) != 1){
+            return 0;
+        }
+        crc = crc32Add(crc, &n, 1);
+        if (n < 128){
+            if (got + n + 1 > size || fread(raw+got, 1, n+1, in) != (size_t)(n+1)){
+                return -1;
+            }
+            crc = crc32Add(crc, raw+got, n+1);
+            got = got + n + 1;
+        }
+        else if (n > 128){
+            if (got + 257 - n > size || fread(&b, 1, 1, in) != 1){
+                return -1;
+            }
+            crc = crc32Add(crc, &b, 1);
+            memset(raw+got, b, 257 - n);
+            got = got + 257 - n;
+        }
+    }
+
+    uint8_t t[4];
+    if (fread(t, 1, 4, in) != 4){
+        return 0;
+    }
+    uint32_t sent = t[0] | (t[1] << 8) | (t[2] << 16) | ((uint32_t)t[3] << 24);
+    return ~crc == sent ? 1 : -1;
+}
+
+// a bright line on a darker floor, drifting side to side and bending, with some noise.
+// frame n of a sequence, written as 2 byte pixels like the camera: RGB565, or YUYV with U and V at 128
+void makeFrame(uint8_t *raw, int n, int sizeX, int sizeY, int luma){
+    static uint32_t noise = 1;
+    float shift = 0.25f * sizeX * sinf(n * 0.1f);
+    float bend = 0.4f * sizeX * sinf(n * 0.05f) / (sizeY * sizeY);
+    float width = sizeX / 16.0f + 1;
+    int x, y;
+    for(y=0;y<sizeY;y++){
+        float up = sizeY - 1 - y; // counted from the bottom like trackLine()
+        float center = sizeX / 2.0f + shift + bend * up * up;
+        for(x=0;x<sizeX;x++){
+            noise = noise * 1664525 + 1013904223;
+            int v = (fabsf(x - center) < width ? 200 : 60) + (int)(noise >> 28) - 8;
+            uint8_t *p = raw + (y*sizeX + x)*2;
+            if (luma){
+                p[0] = v;
+                p[1] = 128;
+            }
+            else {
+                uint16_t px = ((v >> 3) << 11) | ((v >> 2) << 5) | (v >> 3);
+                p[0] = px & 0xFF;
+                p[1] = px >> 8;
+            }
+        }
+    }
+}
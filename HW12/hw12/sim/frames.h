@@ -0,0 +1,16 @@
+#ifndef FRAMES_h
+#define FRAMES_h
+
+#include <stdio.h>
+#include <stdint.h>
+
+// Frames for the host tools: read back from a trace recorded with python/record_frames.py,
+// or made up the way the camera sends them.
+
+#define FRAMES_MAX_X 640
+#define FRAMES_MAX_Y 480
+
+int readFrame(FILE *in, uint8_t *raw, int max, uint8_t *format, int *sizeX, int *sizeY, uint32_t *seq);
+void makeFrame(uint8_t *raw, int n, int sizeX, int sizeY, int luma);
+
+#endif
@@ -0,0 +1,60 @@
+#include "legacy.h"
+
+// convertImage(): the RGB565 or luma frame into 8 bit planes
+void legacyConvert(legacyImage_t *pic, const uint8_t *data, int sizeX, int sizeY, int bpp){
+    int i;
+    int index = 0;
+    pic->sizeX = sizeX;
+    pic->sizeY = sizeY;
+    if (bpp == 1){
+        // gray, so findLine() and printImage() work the same
+        for(i=0;i<sizeX*sizeY;i++){
+            pic->r[i] = data[i];
+            pic->g[i] = data[i];
+            pic->b[i] = data[i];
+        }
+        return;
+    }
+    for(i=0;i<sizeX*sizeY*2;i=i+2){
+        pic->r[index] = (data[i+1]>>3)<<3;
+        pic->g[index] = (((data[i+1]&0b111)<<3) | data[i]>>5)<<2;
+        pic->b[index] = (data[i]&0b11111)<<3;
+        index++;
+    }
+}
+
+// findLine(): threshold the row against its mean in place, then the center of mass
+int legacyFindLine(legacyImage_t *pic, int row){
+    int r = row*pic->sizeX;
+    int sumMass = 0;
+    int sumMassR = 0;
+    int i;
+
+    int sumBright = 0;
+    for(i=0;i<pic->sizeX;i++){
+        sumBright = sumBright + pic->r[r+i] + pic->g[r+i] + pic->b[r+i];
+    }
+    int avgBright = sumBright / pic->sizeX;
+
+    for(i=0;i<pic->sizeX;i++){
+        int mass = pic->r[r+i] + pic->g[r+i] + pic->b[r+i];
+        if (mass < avgBright){
+            pic->r[r+i] = 0;
+            pic->g[r+i] = 0;
+            pic->b[r+i] = 0;
+        }
+        else {
+            pic->r[r+i] = 255;
+            pic->g[r+i] = 255;
+            pic->b[r+i] = 255;
+        }
+    }
+
+    for(i=0;i<pic->sizeX;i++){
+        int mass = pic->r[r+i] + pic->g[r+i] + pic->b[r+i];
+        sumMass = sumMass + mass;
+        sumMassR = sumMassR + mass*i;
+    }
+    float centerOfMass = (float)sumMassR / sumMass;
+    return (int)(centerOfMass);
+}
@@ -0,0 +1,21 @@
+#ifndef LEGACY_h
+#define LEGACY_h
+
+#include <stdint.h>
+
+// convertImage() and findLine() from cam.c as they were before findLineRaw(), working on
+// the r, g, b planes. The host checks compare the new line finding against these.
+
+#define LEGACY_MAX_PIXELS (640*480)
+
+typedef struct legacyImage{
+    int sizeX, sizeY;
+    uint8_t r[LEGACY_MAX_PIXELS];
+    uint8_t g[LEGACY_MAX_PIXELS];
+    uint8_t b[LEGACY_MAX_PIXELS];
+} legacyImage_t;
+
+void legacyConvert(legacyImage_t *pic, const uint8_t *data, int sizeX, int sizeY, int bpp);
+int legacyFindLine(legacyImage_t *pic, int row);
+
+#endif
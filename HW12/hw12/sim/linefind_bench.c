@@ -0,0 +1,174 @@
+// Compares findLineRaw() (frameFindLine() in linefind.c) with the convertImage() + findLine()
+// path it replaced, for the answers and the time, on the computer.
+//
+//   linefind_bench                  made up frames
+//   linefind_bench trace.fr         frames recorded with python/record_frames.py as well
+//
+// - the same column on every row of every frame, RGB565 and luma
+// - including flat rows, all black, all white and random noise
+// - the time per frame for the middle row, the way hw12.c uses it
+//
+// Prints what it checked and exits with 1 if anything was wrong.
+// The times are from the computer, only the ratio says anything about the pico.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "linefind.h"
+#include "camroi.h"
+#include "framelink.h"
+#include "frames.h"
+#include "legacy.h"
+
+static int failed = 0;
+
+static void check(int ok, const char *what){
+    printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+    if (!ok){
+        failed = 1;
+    }
+}
+
+static uint8_t raw[FRAMES_MAX_X*FRAMES_MAX_Y*2];
+static uint8_t frame[BIN_MAX_X*BIN_MAX_Y*2];
+static legacyImage_t pic;
+
+static double nowUs(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// every row of the frame both ways, returns the number of rows that differ
+static int compareRows(const camFrame_t *f){
+    int row;
+    int bad = 0;
+    legacyConvert(&pic, f->data, f->sizeX, f->sizeY, f->bpp);
+    for(row=0;row<f->sizeY;row++){
+        int want = legacyFindLine(&pic, row);
+        int got = frameFindLine(f, row);
+        if (want != got){
+            if (bad < 5){
+                printf("     %dx%d bpp %d row %d: findLine %d, findLineRaw %d\n", f->sizeX, f->sizeY, f->bpp, row, want, got);
+            }
+            bad++;
+        }
+    }
+    return bad;
+}
+
+static uint32_t noise = 1;
+
+// the awkward frames: random bytes, and rows that are flat, black, white or one pixel different
+static void makeOdd(uint8_t *data, int bytes, int kind, int rowBytes){
+    int i;
+    for(i=0;i<bytes;i++){
+        noise = noise * 1664525 + 1013904223;
+        data[i] = noise >> 24;
+    }
+    if (kind == 0){
+        return;
+    }
+    int row;
+    for(row=0;row*rowBytes<bytes;row++){
+        uint8_t *p = data + row*rowBytes;
+        switch (row % 4){
+        case 0: memset(p, 0, rowBytes); break;
+        case 1: memset(p, 0xFF, rowBytes); break;
+        case 2: memset(p, 0x5A, rowBytes); break;
+        case 3: memset(p, 0x10, rowBytes); p[(row*7) % rowBytes] = 0x11; break;
+        }
+    }
+}
+
+// time for the middle row of frames, old path and new
+static void timeFrames(camFrame_t *f, int frames, double *oldUs, double *newUs){
+    int i;
+    volatile int sink = 0;
+    double start = nowUs();
+    for(i=0;i<frames;i++){
+        legacyConvert(&pic, f->data, f->sizeX, f->sizeY, f->bpp);
+        sink += legacyFindLine(&pic, f->sizeY/2);
+    }
+    *oldUs = (nowUs() - start) / frames;
+    start = nowUs();
+    for(i=0;i<frames;i++){
+        sink += frameFindLine(f, f->sizeY/2);
+    }
+    *newUs = (nowUs() - start) / frames;
+}
+
+int main(int argc, char **argv){
+    static const int sizes[][2] = {{80, 60}, {160, 120}, {40, 30}};
+    int s, n, luma;
+    int bad = 0;
+
+    for(s=0;s<3;s++){
+        for(luma=0;luma<2;luma++){
+            camRoi_t r;
+            camRoiDefault(&r, sizes[s][0], sizes[s][1], BIN_MAX_X, BIN_MAX_Y);
+            for(n=0;n<50;n++){
+                makeFrame(raw, n, sizes[s][0], sizes[s][1], luma);
+                camRoiCrop(&r, raw, frame, luma);
+                camFrame_t f = {frame, r.w, r.h, luma ? 1 : 2};
+                bad += compareRows(&f);
+            }
+        }
+    }
+    check(bad == 0, "made up frames: the same column on every row, RGB565 and luma");
+
+    bad = 0;
+    for(n=0;n<200;n++){
+        int bpp = 1 + n % 2;
+        makeOdd(frame, 80*60*bpp, n % 4 >= 2, 80*bpp);
+        camFrame_t f = {frame, 80, 60, bpp};
+        bad += compareRows(&f);
+    }
+    check(bad == 0, "noise and flat rows: the same column on every row, RGB565 and luma");
+
+    if (argc > 1){
+        FILE *in = fopen(argv[1], "rb");
+        int frames = 0;
+        if (!in){
+            perror(argv[1]);
+            return 2;
+        }
+        bad = 0;
+        while (1){
+            uint8_t format;
+            int sizeX, sizeY;
+            uint32_t seq;
+            int r = readFrame(in, raw, sizeof(raw), &format, &sizeX, &sizeY, &seq);
+            if (r == 0){
+                break;
+            }
+            if (r < 0 || format == FRAME_BINARY || sizeX > BIN_MAX_X || sizeY > BIN_MAX_Y){
+                continue;
+            }
+            camFrame_t f = {raw, sizeX, sizeY, format == FRAME_LUMA ? 1 : 2};
+            bad += compareRows(&f);
+            frames++;
+        }
+        fclose(in);
+        printf("     %d recorded frames\n", frames);
+        check(bad == 0, "recorded frames: the same column on every row");
+    }
+
+    for(s=0;s<2;s++){
+        for(luma=0;luma<2;luma++){
+            double oldUs, newUs;
+            camRoi_t r;
+            camRoiDefault(&r, sizes[s][0], sizes[s][1], BIN_MAX_X, BIN_MAX_Y);
+            makeFrame(raw, 7, sizes[s][0], sizes[s][1], luma);
+            camRoiCrop(&r, raw, frame, luma);
+            camFrame_t f = {frame, r.w, r.h, luma ? 1 : 2};
+            timeFrames(&f, 2000, &oldUs, &newUs);
+            printf("     %dx%d %s: convertImage + findLine %.2f us, findLineRaw %.3f us, %.0fx\n", r.w, r.h,
+                luma ? "luma" : "RGB565", oldUs, newUs, oldUs / newUs);
+        }
+    }
+    printf("     RAM: convertImage planes %d bytes, findLineRaw none\n", 3*BIN_MAX_X*BIN_MAX_Y);
+    return failed;
+}
@@ -0,0 +1,156 @@
+// Checks the luma only capture mode gives the same line as findLine() would, on the computer.
+//
+//   luma_check
+//
+// A scene of coloured tape on a floor goes through a model of the sensor that puts out either
+// RGB565 or YUYV (BT.601, what the OV7670 uses), then camRoiCrop() keeps the whole frame or just
+// the Y bytes the way the PIO programs in cam.pio do.
+//
+// - on luma frames findLineRaw() is convertImage() + findLine() exactly, with sensor noise
+// - frameThreshold() on luma frames sets the same pixels findLine() turns white
+// - on clean scenes, luma and RGB565 find the line in the same place, and trackLine() agrees
+// - a luma frame is half the bytes of an RGB565 one
+//
+// Prints what it checked and exits with 1 if anything was wrong.
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "linefind.h"
+#include "camroi.h"
+#include "legacy.h"
+
+static int failed = 0;
+
+static void check(int ok, const char *what){
+    printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+    if (!ok){
+        failed = 1;
+    }
+}
+
+typedef struct scene{
+    float line[3]; // r, g, b of the tape
+    float floor[3];
+} scene_t;
+
+// tape that is brighter than the floor both as r+g+b and as Y
+static const scene_t scenes[] = {
+    {{230, 230, 230}, {90, 90, 90}}, // white on gray
+    {{220, 200, 40}, {50, 50, 50}}, // yellow on dark
+    {{200, 40, 40}, {70, 70, 70}}, // red on gray
+    {{40, 60, 200}, {30, 30, 30}}, // blue on dark
+    {{120, 120, 120}, {100, 100, 100}}, // dim gray on gray
+};
+#define SCENES 5
+
+static uint32_t noise = 1;
+
+static float jitter(float amount){
+    noise = noise * 1664525 + 1013904223;
+    return amount * ((int)(noise >> 24) - 128) / 128.0f;
+}
+
+static uint8_t clamp8(float v){
+    return v < 0 ? 0 : v > 255 ? 255 : (uint8_t)lrintf(v);
+}
+
+// what the sensor clocks out for frame n of the scene, 2 bytes per pixel: RGB565, or YUYV.
+// the tape stays in view, a sliver of it at the edge can't lift the row mean above the floor
+// in one format and not the other
+static void sense(uint8_t *full, const scene_t *s, int n, int sizeX, int sizeY, bool yuv, float amount){
+    float shift = 0.2f * sizeX * sinf(n * 0.7f);
+    float bend = 0.2f * sizeX * sinf(n * 0.3f) / (sizeY * sizeY);
+    float width = sizeX / 16.0f + 1;
+    int x, y, k;
+    for(y=0;y<sizeY;y++){
+        float up = sizeY - 1 - y;
+        float center = sizeX / 2.0f + shift + bend * up * up;
+        for(x=0;x<sizeX;x++){
+            const float *c = fabsf(x - center) < width ? s->line : s->floor;
+            float rgb[3];
+            for(k=0;k<3;k++){
+                rgb[k] = c[k] + jitter(amount);
+            }
+            uint8_t *p = full + (y*sizeX + x)*2;
+            if (yuv){
+                p[0] = clamp8(0.299f*rgb[0] + 0.587f*rgb[1] + 0.114f*rgb[2]);
+                // U on the even pixel, V on the odd one
+                p[1] = (x & 1) ? clamp8(0.5f*rgb[0] - 0.419f*rgb[1] - 0.081f*rgb[2] + 128)
+                               : clamp8(-0.169f*rgb[0] - 0.331f*rgb[1] + 0.5f*rgb[2] + 128);
+            }
+            else {
+                uint8_t r = clamp8(rgb[0]), g = clamp8(rgb[1]), b = clamp8(rgb[2]);
+                uint16_t px = ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
+                p[0] = px & 0xFF;
+                p[1] = px >> 8;
+            }
+        }
+    }
+}
+
+static uint8_t full[320*240*2];
+static uint8_t lumaData[BIN_MAX_X*BIN_MAX_Y];
+static uint8_t rgbData[BIN_MAX_X*BIN_MAX_Y*2];
+static legacyImage_t pic;
+static binImage_t img;
+
+int main(){
+    static const int sizes[][2] = {{80, 60}, {160, 120}, {320, 240}};
+    int s, z, n, row, x;
+    int sameOld = 1, sameBits = 1, sameRgb = 1, sameTrack = 1, bytes = 1;
+    int rowsCompared = 0, rowsOff = 0;
+
+    for(z=0;z<3;z++){
+        int fullX = sizes[z][0], fullY = sizes[z][1];
+        camRoi_t r;
+        camRoiDefault(&r, fullX, fullY, BIN_MAX_X, BIN_MAX_Y);
+        bytes = bytes && 2*camRoiFrameBytes(&r, 1) == camRoiFrameBytes(&r, 2);
+        camFrame_t luma = {lumaData, r.w, r.h, 1};
+        camFrame_t rgb = {rgbData, r.w, r.h, 2};
+        int rows[5] = {r.h/2, 5*r.h/8, 3*r.h/4, 7*r.h/8, r.h-1};
+
+        for(s=0;s<SCENES;s++){
+            for(n=0;n<20;n++){
+                // with noise: the luma path against the old path on the same bytes
+                sense(full, &scenes[s], n, fullX, fullY, true, 12);
+                camRoiCrop(&r, full, lumaData, true);
+                frameThreshold(&luma, &img);
+                legacyConvert(&pic, lumaData, r.w, r.h, 1);
+                for(row=0;row<r.h;row++){
+                    sameOld = sameOld && frameFindLine(&luma, row) == legacyFindLine(&pic, row);
+                    // findLine() left the row as 255 where it was white
+                    for(x=0;x<r.w;x++){
+                        int bit = (img.bits[row][x>>5] >> (x&31)) & 1;
+                        sameBits = sameBits && bit == (pic.r[row*r.w + x] == 255);
+                    }
+                }
+
+                // clean: luma and RGB565 captures of the same scene
+                lineTrack_t tl, tr;
+                sense(full, &scenes[s], n, fullX, fullY, true, 0);
+                camRoiCrop(&r, full, lumaData, true);
+                sense(full, &scenes[s], n, fullX, fullY, false, 0);
+                camRoiCrop(&r, full, rgbData, false);
+                for(row=0;row<r.h;row++){
+                    int d = frameFindLine(&luma, row) - frameFindLine(&rgb, row);
+                    sameRgb = sameRgb && d >= -1 && d <= 1;
+                    rowsOff += d != 0;
+                    rowsCompared++;
+                }
+                frameTrackLine(&luma, rows, 5, &tl);
+                frameTrackLine(&rgb, rows, 5, &tr);
+                sameTrack = sameTrack && tl.rows == tr.rows && fabsf(tl.offset - tr.offset) < 0.5f
+                    && fabsf(tl.heading - tr.heading) < 0.02f;
+            }
+        }
+    }
+    check(sameOld, "luma with noise: findLineRaw() is convertImage() + findLine() on every row");
+    check(sameBits, "luma with noise: frameThreshold() sets the pixels findLine() turns white");
+    printf("     %d of %d rows a pixel apart\n", rowsOff, rowsCompared);
+    check(sameRgb, "clean scenes: luma and RGB565 find the line within a pixel on every row");
+    check(sameTrack, "clean scenes: trackLine() on luma and RGB565 agree");
+    check(bytes, "a luma frame is half the bytes");
+    return failed;
+}
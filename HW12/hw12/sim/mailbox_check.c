@@ -0,0 +1,178 @@
+// Checks the core 1 to core 0 line mailbox in mailbox.c on the computer, with the two cores as threads.
+//
+//   mailbox_check
+//
+// The writer fills every field of a message from its number, so a message that is half one
+// and half another shows up on the reader side.
+//
+// - all zeros and not fresh before the first publish
+// - a message is fresh once, after that the same one comes back not fresh
+// - the reader gets the newest message, the ones it missed are overwritten
+// - the writer never gets the slot the reader is looking at
+// - the same with a writer and a reader thread: whole messages, in order, fresh exactly when new
+//
+// Prints what it checked and exits with 1 if anything was wrong.
+
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "mailbox.h"
+
+static int failed = 0;
+
+static void check(int ok, const char *what){
+    printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+    if (!ok){
+        failed = 1;
+    }
+}
+
+// message n as core 1 would write it
+static void fill(lineMsg_t *msg, uint32_t n){
+    msg->seq = n;
+    msg->dropped = n * 3;
+    msg->time = n * 7;
+    msg->com = n % 80;
+    msg->offset = n;
+    msg->heading = -(float)n;
+    msg->curvature = n * 0.5f;
+    msg->confidence = n * 0.25f;
+}
+
+// every field is from the same message
+static int whole(const lineMsg_t *msg){
+    uint32_t n = msg->seq;
+    return msg->dropped == n * 3 && msg->time == n * 7 && msg->com == (int)(n % 80) && msg->offset == (float)n
+        && msg->heading == -(float)n && msg->curvature == n * 0.5f && msg->confidence == n * 0.25f;
+}
+
+static void checkOrder(){
+    static lineMailbox_t m;
+    static const lineMsg_t zero;
+    bool fresh;
+    int ok = 1;
+    int i;
+
+    mailboxInit(&m);
+    const lineMsg_t *msg = mailboxLatest(&m, &fresh);
+    check(!fresh && !memcmp(msg, &zero, sizeof(zero)), "all zeros and not fresh before the first publish");
+
+    fill(mailboxWriteSlot(&m), 1);
+    mailboxPublish(&m);
+    msg = mailboxLatest(&m, &fresh);
+    ok = fresh && msg->seq == 1 && whole(msg);
+    msg = mailboxLatest(&m, &fresh);
+    ok = ok && !fresh && msg->seq == 1 && whole(msg);
+    check(ok, "a message is fresh once, then comes back not fresh");
+
+    ok = 1;
+    for(i=2;i<100;i++){
+        int k;
+        // i publishes without a read, the reader only sees the last
+        for(k=0;k<i%5;k++){
+            lineMsg_t *w = mailboxWriteSlot(&m);
+            ok = ok && w != msg;
+            fill(w, 1000*i + k);
+            mailboxPublish(&m);
+        }
+        uint32_t before = msg->seq;
+        msg = mailboxLatest(&m, &fresh);
+        if (i % 5){
+            ok = ok && fresh && msg->seq == (uint32_t)(1000*i + i%5 - 1) && whole(msg);
+        }
+        else {
+            ok = ok && !fresh && msg->seq == before;
+        }
+    }
+    check(ok, "the newest message wins, and the writer never gets the reader's slot");
+}
+
+// core 1 and core 0 on their own threads
+typedef struct threaded{
+    lineMailbox_t m;
+    atomic_int running;
+    uint32_t messages;
+    uint32_t read; // fresh messages the reader got
+    int bad;
+} threaded_t;
+
+static void *writerThread(void *arg){
+    threaded_t *t = arg;
+    uint32_t n;
+    for(n=1;n<=t->messages;n++){
+        fill(mailboxWriteSlot(&t->m), n);
+        mailboxPublish(&t->m);
+        if (n % 3 == 0){
+            sched_yield(); // lets the reader in on a single core too
+        }
+    }
+    atomic_store(&t->running, 0);
+    return NULL;
+}
+
+static void *readerThread(void *arg){
+    threaded_t *t = arg;
+    uint32_t last = 0;
+    bool fresh;
+    while (1){
+        int running = atomic_load(&t->running);
+        const lineMsg_t *msg = mailboxLatest(&t->m, &fresh);
+        // read it twice with the writer going meanwhile, it must not change
+        int i;
+        for(i=0;i<2;i++){
+            if (!whole(msg)){
+                t->bad = 1;
+            }
+        }
+        if (fresh){
+            if (msg->seq <= last){
+                t->bad = 1;
+            }
+            last = msg->seq;
+            t->read++;
+        }
+        else if (msg->seq != last){
+            t->bad = 1;
+        }
+        else if (!running){
+            // one more look for the last message
+            msg = mailboxLatest(&t->m, &fresh);
+            if (fresh){
+                last = msg->seq;
+                t->read++;
+            }
+            if (last != t->messages){
+                t->bad = 1;
+            }
+            break;
+        }
+        else {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void checkThreads(){
+    static threaded_t t;
+    pthread_t writer, reader;
+    mailboxInit(&t.m);
+    atomic_store(&t.running, 1);
+    t.messages = 300000;
+    t.read = 0;
+    t.bad = 0;
+    pthread_create(&reader, NULL, readerThread, &t);
+    pthread_create(&writer, NULL, writerThread, &t);
+    pthread_join(writer, NULL);
+    pthread_join(reader, NULL);
+    check(!t.bad && t.read > 0, "two threads: whole messages, in order, fresh only when new, the last one gets through");
+    printf("     %u messages, %u read fresh\n", t.messages, t.read);
+}
+
+int main(){
+    checkOrder();
+    checkThreads();
+    return failed;
+}
@@ -0,0 +1,466 @@
+// Runs the capture programs in cam.pio on the computer against a made up VS/HS/PCLK trace.
+//
+//   pio_check
+//
+// cam.pio is read and run by a small PIO model: one instruction per clock, wait stalls,
+// the ISR shifts right with autopush at 32 bits into the 8 deep joined RX FIFO, and a DMA
+// model drains it a word at a time like the channel set up in cam_arm_capture().
+// The trace is what the OV7670 sends: VS high between frames, HS high for each row,
+// a new byte on every falling PCLK, and PCLK running during the blanking too.
+//
+// - cam and cam_luma put together byte exact frames, the whole image and with a window
+// - a capture armed in the middle of a frame waits for the next one
+// - frames back to back, re-armed after each one like the DMA interrupt does
+// - a DMA that can't keep up stalls the state machine and sets RXSTALL
+// - the fastest PCLK the programs keep up with
+//
+// Prints what it checked and exits with 1 if anything was wrong.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "camroi.h"
+
+#ifndef CAM_PIO_FILE
+#define CAM_PIO_FILE "../cam.pio"
+#endif
+
+// IN pin offsets, the same as cam.h
+#define PIN_VS 8
+#define PIN_HS 9
+#define PIN_PCLK 11
+
+#define MAX_CODE 32
+#define FIFO_DEPTH 8 // RX joined
+
+enum { OP_WAIT, OP_JMP_NOTX, OP_JMP_XDEC, OP_MOV_X_Y, OP_MOV_X_OSR, OP_IN_PINS };
+
+typedef struct pioInstr{
+    int op;
+    int arg; // wait: pin, jmp: target, in: bits
+    int pol; // wait: level
+    char label[16]; // jmp target until it is resolved
+} pioInstr_t;
+
+typedef struct pioProgram{
+    pioInstr_t code[MAX_CODE];
+    int len;
+    int wrapTarget;
+    int wrap; // last instruction before wrapping
+} pioProgram_t;
+
+// state machine, FIFO and the DMA channel draining it
+typedef struct pioSim{
+    const pioProgram_t *prog;
+    int pc;
+    uint32_t x, y, osr, isr;
+    int isrCount;
+    uint32_t fifo[FIFO_DEPTH];
+    int fifoCount, fifoHead;
+    int enabled;
+    int rxStall;
+
+    uint8_t *dst; // DMA
+    int words; // transfers left
+    int dmaEvery; // clocks per DMA transfer
+    int dmaWait;
+} pioSim_t;
+
+static int failed = 0;
+
+static void check(int ok, const char *what){
+    printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+    if (!ok){
+        failed = 1;
+    }
+}
+
+// read one .program out of cam.pio. returns 0 if it isn't there or has something the model doesn't know
+static int loadProgram(const char *file, const char *name, pioProgram_t *p){
+    char line[200];
+    char labels[MAX_CODE][16];
+    int labelAt[MAX_CODE];
+    int nlabels = 0;
+    int in = 0;
+    int i, k;
+    FILE *f = fopen(file, "r");
+    if (!f){
+        perror(file);
+        return 0;
+    }
+    p->len = 0;
+    p->wrapTarget = 0;
+    p->wrap = -1;
+    while (fgets(line, sizeof(line), f)){
+        char *c = strchr(line, ';');
+        if (c){
+            *c = 0;
+        }
+        for(c=line;*c;c++){
+            if (*c == ','){
+                *c = ' ';
+            }
+        }
+        char w[4][16] = {"", "", "", ""};
+        int n = sscanf(line, "%15s %15s %15s %15s", w[0], w[1], w[2], w[3]);
+        if (n <= 0){
+            continue;
+        }
+        if (!strcmp(w[0], ".program") || !strcmp(w[0], "%")){
+            if (in){
+                break;
+            }
+            in = n > 1 && !strcmp(w[0], ".program") && !strcmp(w[1], name);
+            continue;
+        }
+        if (!in){
+            continue;
+        }
+        if (!strcmp(w[0], ".wrap_target")){
+            p->wrapTarget = p->len;
+            continue;
+        }
+        if (!strcmp(w[0], ".wrap")){
+            p->wrap = p->len - 1;
+            continue;
+        }
+        size_t l = strlen(w[0]);
+        if (w[0][l-1] == ':'){
+            w[0][l-1] = 0;
+            strcpy(labels[nlabels], w[0]);
+            labelAt[nlabels++] = p->len;
+            continue;
+        }
+        if (p->len == MAX_CODE){
+            fclose(f);
+            return 0;
+        }
+        pioInstr_t *ins = &p->code[p->len++];
+        ins->label[0] = 0;
+        if (!strcmp(w[0], "wait") && !strcmp(w[2], "pin") && n == 4){
+            ins->op = OP_WAIT;
+            ins->pol = atoi(w[1]);
+            ins->arg = atoi(w[3]);
+        }
+        else if (!strcmp(w[0], "jmp") && !strcmp(w[1], "!x") && n == 3){
+            ins->op = OP_JMP_NOTX;
+            strcpy(ins->label, w[2]);
+        }
+        else if (!strcmp(w[0], "jmp") && !strcmp(w[1], "x--") && n == 3){
+            ins->op = OP_JMP_XDEC;
+            strcpy(ins->label, w[2]);
+        }
+        else if (!strcmp(w[0], "mov") && !strcmp(w[1], "x") && !strcmp(w[2], "y")){
+            ins->op = OP_MOV_X_Y;
+        }
+        else if (!strcmp(w[0], "mov") && !strcmp(w[1], "x") && !strcmp(w[2], "osr")){
+            ins->op = OP_MOV_X_OSR;
+        }
+        else if (!strcmp(w[0], "in") && !strcmp(w[1], "pins") && n == 3){
+            ins->op = OP_IN_PINS;
+            ins->arg = atoi(w[2]);
+        }
+        else {
+            fprintf(stderr, "%s: can't run \"%s %s %s %s\"\n", name, w[0], w[1], w[2], w[3]);
+            fclose(f);
+            return 0;
+        }
+    }
+    fclose(f);
+    if (p->len == 0){
+        return 0;
+    }
+    if (p->wrap < 0){
+        p->wrap = p->len - 1;
+    }
+    for(i=0;i<p->len;i++){
+        if (!p->code[i].label[0]){
+            continue;
+        }
+        for(k=0;k<nlabels && strcmp(labels[k], p->code[i].label);k++){
+        }
+        if (k == nlabels){
+            return 0;
+        }
+        p->code[i].arg = labelAt[k];
+    }
+    return 1;
+}
+
+// what cam_arm_capture() does: clear the FIFO, load Y and the OSR, jump to the start and point the DMA at dst
+static void arm(pioSim_t *s, const pioProgram_t *prog, uint32_t skip, uint32_t keep, uint8_t *dst, int bytes){
+    s->prog = prog;
+    s->pc = 0;
+    s->x = 0;
+    s->y = skip;
+    s->osr = keep - 1;
+    s->isr = 0;
+    s->isrCount = 0;
+    s->fifoCount = 0;
+    s->fifoHead = 0;
+    s->rxStall = 0;
+    s->dst = dst;
+    s->words = bytes / 4;
+    s->dmaWait = 0;
+    s->enabled = 1;
+}
+
+// one clock: the state machine runs an instruction or stays stalled, then the DMA may move a word.
+// returns 1 when the DMA has done its last transfer
+static int step(pioSim_t *s, uint32_t pins){
+    if (s->enabled){
+        const pioInstr_t *ins = &s->prog->code[s->pc];
+        int next = s->pc == s->prog->wrap ? s->prog->wrapTarget : s->pc + 1;
+        switch (ins->op){
+        case OP_WAIT:
+            if (((pins >> ins->arg) & 1) != (uint32_t)ins->pol){
+                next = s->pc;
+            }
+            break;
+        case OP_JMP_NOTX:
+            if (s->x == 0){
+                next = ins->arg;
+            }
+            break;
+        case OP_JMP_XDEC:
+            if (s->x != 0){
+                next = ins->arg;
+            }
+            s->x--;
+            break;
+        case OP_MOV_X_Y:
+            s->x = s->y;
+            break;
+        case OP_MOV_X_OSR:
+            s->x = s->osr;
+            break;
+        case OP_IN_PINS:
+            // autopush with the FIFO full stalls the instruction until there is room
+            if (s->isrCount + ins->arg >= 32 && s->fifoCount == FIFO_DEPTH){
+                s->rxStall = 1;
+                next = s->pc;
+                break;
+            }
+            s->isr = (s->isr >> ins->arg) | ((pins & ((1u << ins->arg) - 1)) << (32 - ins->arg));
+            s->isrCount += ins->arg;
+            if (s->isrCount >= 32){
+                s->fifo[(s->fifoHead + s->fifoCount) % FIFO_DEPTH] = s->isr;
+                s->fifoCount++;
+                s->isr = 0;
+                s->isrCount = 0;
+            }
+            break;
+        }
+        s->pc = next;
+    }
+
+    if (s->words && s->fifoCount && ++s->dmaWait >= s->dmaEvery){
+        uint32_t w = s->fifo[s->fifoHead];
+        s->fifoHead = (s->fifoHead + 1) % FIFO_DEPTH;
+        s->fifoCount--;
+        s->dmaWait = 0;
+        // little endian, the first byte in the low byte
+        s->dst[0] = w & 0xFF;
+        s->dst[1] = (w >> 8) & 0xFF;
+        s->dst[2] = (w >> 16) & 0xFF;
+        s->dst[3] = w >> 24;
+        s->dst += 4;
+        s->words--;
+        if (s->words == 0){
+            // the DMA interrupt stops the state machine before it starts on the next frame
+            s->enabled = 0;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// made up sensor, feeding the state machine
+typedef struct sensor{
+    pioSim_t *sim;
+    int pclkHalf; // clocks per PCLK half period
+    int done; // frames the DMA finished
+    void (*onDone)(void *ctx);
+    void *ctx;
+} sensor_t;
+
+static void hold(sensor_t *t, uint32_t pins, int clocks){
+    while (clocks--){
+        if (step(t->sim, pins)){
+            t->done++;
+            if (t->onDone){
+                t->onDone(t->ctx);
+            }
+        }
+    }
+}
+
+// one byte on D0-D7: out on falling PCLK, read by the PIO on rising PCLK
+static void sendByte(sensor_t *t, uint32_t sync, uint8_t b){
+    hold(t, sync | b, t->pclkHalf);
+    hold(t, sync | b | (1u << PIN_PCLK), t->pclkHalf);
+}
+
+// PCLK keeps going during blanking, with junk on the data pins
+static void blank(sensor_t *t, uint32_t sync, int bytes){
+    int i;
+    for(i=0;i<bytes;i++){
+        sendByte(t, sync, 0xEE);
+    }
+}
+
+// rows first..last of a fullX*fullY*2 byte image, between two VS pulses
+static void sendFrame(sensor_t *t, const uint8_t *img, int fullX, int first, int last){
+    int row, i;
+    blank(t, 1u << PIN_VS, 8);
+    blank(t, 0, 12);
+    for(row=first;row<last;row++){
+        const uint8_t *p = img + row*fullX*2;
+        for(i=0;i<fullX*2;i++){
+            sendByte(t, 1u << PIN_HS, p[i]);
+        }
+        blank(t, 0, 10);
+    }
+    blank(t, 0, 6);
+}
+
+static uint32_t noise = 1;
+
+static void makeImage(uint8_t *img, int bytes){
+    int i;
+    for(i=0;i<bytes;i++){
+        noise = noise * 1664525 + 1013904223;
+        img[i] = noise >> 24;
+    }
+}
+
+static int pclkHalf = 3; // PIO clocks per PCLK half period
+
+static uint8_t image[160*120*2];
+static uint8_t want[160*120*2];
+static uint8_t got[160*120*2 + 4];
+
+// one capture through a window, checked against camRoiCrop()
+static int captureOne(const pioProgram_t *prog, bool luma, const camRoi_t *r, int dmaEvery, int startMid, int *stalled){
+    pioSim_t s;
+    sensor_t t = {&s, pclkHalf, 0, NULL, NULL};
+    int bytes = camRoiFrameBytes(r, luma ? 1 : 2);
+    makeImage(image, r->fullX*r->fullY*2);
+    camRoiCrop(r, image, want, luma);
+    memset(got, 0x55, sizeof(got));
+
+    s.dmaEvery = dmaEvery;
+    arm(&s, prog, camRoiSkipBytes(r), luma ? r->w : r->w*2, got, bytes);
+    if (startMid){
+        // armed while VS is low part way into a frame, these rows must not be stored
+        int row, i;
+        for(row=0;row<3;row++){
+            for(i=0;i<r->fullX*2;i++){
+                sendByte(&t, 1u << PIN_HS, 0xA5);
+            }
+            blank(&t, 0, 10);
+        }
+    }
+    // the sensor window only sends the rows in the ROI
+    sendFrame(&t, image, r->fullX, r->y, r->y + r->h);
+    *stalled = s.rxStall;
+    return t.done == 1 && !memcmp(got, want, bytes) && got[bytes] == 0x55;
+}
+
+// frames back to back, re-armed from the DMA interrupt
+typedef struct stream{
+    pioSim_t *sim;
+    const pioProgram_t *prog;
+    const camRoi_t *r;
+    bool luma;
+    uint8_t bufs[2][80*60*2];
+    int fill;
+} stream_t;
+
+static void rearm(void *ctx){
+    stream_t *st = ctx;
+    st->fill = !st->fill;
+    arm(st->sim, st->prog, camRoiSkipBytes(st->r), st->luma ? st->r->w : st->r->w*2, st->bufs[st->fill], camRoiFrameBytes(st->r, st->luma ? 1 : 2));
+}
+
+static int captureStream(const pioProgram_t *prog, bool luma, int frames){
+    static stream_t st;
+    pioSim_t s;
+    camRoi_t r;
+    int i;
+    int ok = 1;
+    int bytes;
+    camRoiSet(&r, 80, 60, 16, 10, 40, 30, 160, 120);
+    bytes = camRoiFrameBytes(&r, luma ? 1 : 2);
+    st.sim = &s;
+    st.prog = prog;
+    st.r = &r;
+    st.luma = luma;
+    st.fill = 0;
+    s.dmaEvery = 1;
+    sensor_t t = {&s, pclkHalf, 0, rearm, &st};
+    arm(&s, prog, camRoiSkipBytes(&r), luma ? r.w : r.w*2, st.bufs[0], bytes);
+    for(i=0;i<frames;i++){
+        makeImage(image, 80*60*2);
+        camRoiCrop(&r, image, want, luma);
+        int fill = st.fill;
+        sendFrame(&t, image, 80, r.y, r.y + r.h);
+        ok = ok && t.done == i+1 && !memcmp(st.bufs[fill], want, bytes) && !s.rxStall;
+    }
+    return ok;
+}
+
+int main(){
+    static pioProgram_t cam, camLuma;
+    camRoi_t r;
+    int stalled;
+    int ok, i;
+
+    check(loadProgram(CAM_PIO_FILE, "cam", &cam), "cam program read from cam.pio");
+    check(loadProgram(CAM_PIO_FILE, "cam_luma", &camLuma), "cam_luma program read from cam.pio");
+    if (failed){
+        return 1;
+    }
+
+    // the whole image at each size the buffers hold, then windows with a skip at the start of the row
+    static const uint16_t sizes[][2] = {{80, 60}, {160, 120}, {40, 30}};
+    ok = 1;
+    for(i=0;i<3;i++){
+        camRoiDefault(&r, sizes[i][0], sizes[i][1], 160, 120);
+        ok = ok && captureOne(&cam, false, &r, 1, 0, &stalled) && !stalled;
+        ok = ok && captureOne(&camLuma, true, &r, 1, 0, &stalled) && !stalled;
+    }
+    check(ok, "whole frames are byte exact, RGB565 and luma");
+
+    static const uint16_t windows[][4] = {{4, 0, 40, 60}, {0, 10, 80, 20}, {36, 29, 44, 31}, {76, 0, 4, 1}};
+    ok = 1;
+    for(i=0;i<4;i++){
+        ok = ok && camRoiSet(&r, 80, 60, windows[i][0], windows[i][1], windows[i][2], windows[i][3], 160, 120);
+        ok = ok && captureOne(&cam, false, &r, 1, 0, &stalled) && !stalled;
+        ok = ok && captureOne(&camLuma, true, &r, 1, 0, &stalled) && !stalled;
+    }
+    check(ok, "windows skip the right bytes and wait out the end of each row");
+
+    camRoiDefault(&r, 80, 60, 160, 120);
+    ok = captureOne(&cam, false, &r, 1, 1, &stalled) && captureOne(&camLuma, true, &r, 1, 1, &stalled);
+    check(ok, "armed part way into a frame, the capture starts at the next VS");
+
+    check(captureStream(&cam, false, 5) && captureStream(&camLuma, true, 5), "frames back to back, re-armed after each one");
+
+    // a PCLK is 6 clocks here so a word comes every 24, a DMA taking 40 falls behind and the FIFO fills
+    camRoiDefault(&r, 80, 60, 160, 120);
+    ok = captureOne(&cam, false, &r, 40, 0, &stalled);
+    check(!ok && stalled, "a DMA that falls behind stalls the state machine and sets RXSTALL");
+    ok = captureOne(&cam, false, &r, 6, 0, &stalled);
+    check(ok && !stalled, "a DMA slower than the PIO but faster than the bytes keeps up");
+
+    // going from the skip loop to the byte loop takes 4 instructions, PCLK must stay low that long
+    camRoiSet(&r, 80, 60, 8, 0, 40, 60, 160, 120);
+    pclkHalf = 2;
+    ok = captureOne(&cam, false, &r, 1, 0, &stalled);
+    pclkHalf = 3;
+    check(!ok && captureOne(&cam, false, &r, 1, 0, &stalled), "needs 6 PIO clocks per PCLK, 4 loses a byte after the skip");
+
+    return failed;
+}
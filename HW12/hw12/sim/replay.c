@@ -0,0 +1,234 @@
+// Runs the hw12 line finding on the computer, on recorded or made up frames, no camera needed.
+//
+//   replay trace.fr                    frames recorded with python/record_frames.py
+//   replay --synthetic 100             100 frames of a moving, curving line
+//   replay --synthetic 100 --luma      the same as YUV422 with only Y kept
+//   replay ... --roi x y w h           only use that window, like camera_set_roi()
+//   replay --synthetic 100 --record t.fr   also write the made up frames as a trace, like sendImage()
+//
+// A trace is the sendImage() frames back to back, as described in framelink.h.
+// Made up frames are built as the camera would send them, 2 bytes per pixel, and then cut
+// down with camRoiCrop() the way the sensor window and PIO do it.
+//
+// Prints one line per frame, the same numbers as the STREAM_MODE loop in hw12.c plus the
+// eroded blob and the exposure controller's mean, then the average processing time.
+// Every frame is also run through the old convertImage() + findLine() (legacy.c): each row's
+// center and the thresholded pixels have to be the same. Exits with 1 if any differ or there
+// were no frames to check, 2 if the trace had frames with a bad CRC.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "framelink.h"
+#include "linefind.h"
+#include "binimage.h"
+#include "camroi.h"
+#include "camexposure.h"
+#include "frames.h"
+#include "legacy.h"
+
+static uint8_t raw[FRAMES_MAX_X*FRAMES_MAX_Y*2]; // decoded payload, or a made up frame as the camera sends it
+static uint8_t frame[BIN_MAX_X*BIN_MAX_Y*2]; // what the capture stores, after the window
+static legacyImage_t pic;
+static binImage_t bin;
+
+static double nowUs(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// everything the firmware does with a finished frame
+static double processFrame(const camFrame_t *f, uint32_t seq, camAe_t *ae){
+    static binImage_t clean;
+    int y = f->sizeY;
+    int rows[5] = {y/2, 5*y/8, 3*y/4, 7*y/8, y-1};
+    lineTrack_t track;
+    float cx = 0, cy = 0;
+
+    double start = nowUs();
+    int com = frameFindLine(f, y/2);
+    frameTrackLine(f, rows, 5, &track);
+    frameThreshold(f, &bin);
+    binErode(&bin, &clean);
+    int count = binCentroid(&clean, &cx, &cy);
+    camAeMeasure(ae, f->data, f->sizeX, f->sizeY, f->bpp == 1);
+    double took = nowUs() - start;
+
+    printf("%u %d %.2f %.3f %.4f %.2f %d %.1f %.1f %d\n", seq, com,
+        track.offset, track.heading, track.curvature, track.confidence, count, cx, cy, ae->mean);
+    return took;
+}
+
+// the frame through convertImage() and findLine() on every row, against frameFindLine() and
+// the thresholded image processFrame() left in bin. returns the number of rows that differ
+static int compareLegacy(const camFrame_t *f, uint32_t seq){
+    int row, x;
+    int bad = 0;
+    legacyConvert(&pic, f->data, f->sizeX, f->sizeY, f->bpp);
+    for(row=0;row<f->sizeY;row++){
+        int want = legacyFindLine(&pic, row);
+        int got = frameFindLine(f, row);
+        // findLine() left the row as 255 where it was white
+        int same = want == got;
+        for(x=0;x<f->sizeX;x++){
+            same = same && ((bin.bits[row][x>>5] >> (x&31)) & 1) == (pic.r[row*f->sizeX + x] == 255);
+        }
+        if (!same){
+            fprintf(stderr, "frame %u row %d: findLine %d, findLineRaw %d%s\n", seq, row, want, got,
+                want == got ? ", thresholds differ" : "");
+            bad++;
+        }
+    }
+    return bad;
+}
+
+static FILE *record;
+
+static void fileSink(const uint8_t *data, int len){
+    fwrite(data, 1, len, record);
+}
+
+static void usage(){
+    fprintf(stderr, "replay trace.fr | --synthetic n [--luma] [--size w h] [--roi x y w h] [--record t.fr]\n");
+    exit(1);
+}
+
+int main(int argc, char **argv){
+    const char *trace = NULL;
+    int synthetic = 0;
+    int luma = 0;
+    int fullX = 80, fullY = 60;
+    int roi = 0, rx = 0, ry = 0, rw = 0, rh = 0;
+    int i;
+
+    for(i=1;i<argc;i++){
+        if (!strcmp(argv[i], "--synthetic") && i+1 < argc){
+            synthetic = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--luma")){
+            luma = 1;
+        }
+        else if (!strcmp(argv[i], "--size") && i+2 < argc){
+            fullX = atoi(argv[++i]);
+            fullY = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--roi") && i+4 < argc){
+            roi = 1;
+            rx = atoi(argv[++i]);
+            ry = atoi(argv[++i]);
+            rw = atoi(argv[++i]);
+            rh = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--record") && i+1 < argc){
+            record = fopen(argv[++i], "wb");
+            if (!record){
+                perror(argv[i]);
+                return 1;
+            }
+        }
+        else if (argv[i][0] != '-'){
+            trace = argv[i];
+        }
+        else {
+            usage();
+        }
+    }
+    if (!trace && !synthetic){
+        usage();
+    }
+
+    camAe_t ae;
+    camAeInit(&ae, 100, 16);
+    camRoi_t window;
+    double total = 0;
+    int frames = 0;
+    int bad = 0;
+    int differ = 0;
+
+    if (synthetic){
+        if (fullX > FRAMES_MAX_X || fullY > FRAMES_MAX_Y){
+            usage();
+        }
+        if (roi){
+            if (!camRoiSet(&window, fullX, fullY, rx, ry, rw, rh, BIN_MAX_X, BIN_MAX_Y)){
+                fprintf(stderr, "window does not fit\n");
+                return 1;
+            }
+        }
+        else {
+            camRoiDefault(&window, fullX, fullY, BIN_MAX_X, BIN_MAX_Y);
+        }
+        for(i=0;i<synthetic;i++){
+            makeFrame(raw, i, fullX, fullY, luma);
+            camRoiCrop(&window, raw, frame, luma);
+            camFrame_t f = {frame, window.w, window.h, luma ? 1 : 2};
+            if (record){
+                frameTx_t tx;
+                frameTxBegin(&tx, fileSink, luma ? FRAME_LUMA : FRAME_RGB565, FRAME_RLE, f.sizeX, f.sizeY, i);
+                frameTxWrite(&tx, frame, f.sizeX*f.sizeY*f.bpp);
+                frameTxEnd(&tx);
+            }
+            total += processFrame(&f, i, &ae);
+            differ += compareLegacy(&f, i);
+            frames++;
+        }
+    }
+    else {
+        FILE *in = fopen(trace, "rb");
+        if (!in){
+            perror(trace);
+            return 1;
+        }
+        while (1){
+            uint8_t format;
+            int sizeX, sizeY;
+            uint32_t seq;
+            int r = readFrame(in, raw, sizeof(raw), &format, &sizeX, &sizeY, &seq);
+            if (r == 0){
+                break;
+            }
+            if (r < 0){
+                bad++;
+                continue;
+            }
+            if (format == FRAME_BINARY){
+                continue; // already thresholded, nothing to find the line in
+            }
+            int bpp = (format == FRAME_LUMA) ? 1 : 2;
+            camFrame_t f = {raw, sizeX, sizeY, bpp};
+            if (roi){
+                // the window is cut from the recorded frame, only RGB565 has the camera's 2 bytes per pixel
+                if (bpp != 2 || !camRoiSet(&window, sizeX, sizeY, rx, ry, rw, rh, BIN_MAX_X, BIN_MAX_Y)){
+                    fprintf(stderr, "window does not fit frame %u\n", seq);
+                    continue;
+                }
+                camRoiCrop(&window, raw, frame, false);
+                f.data = frame;
+                f.sizeX = rw;
+                f.sizeY = rh;
+            }
+            else if (sizeX > BIN_MAX_X || sizeY > BIN_MAX_Y){
+                fprintf(stderr, "frame %u is bigger than the capture buffers, use --roi\n", seq);
+                continue;
+            }
+            total += processFrame(&f, seq, &ae);
+            differ += compareLegacy(&f, seq);
+            frames++;
+        }
+        fclose(in);
+    }
+
+    fprintf(stderr, "%d frames, %d bad, %d rows differ from findLine(), %.1f us per frame\n", frames, bad, differ,
+        frames ? total / frames : 0);
+    if (record){
+        fclose(record);
+    }
+    if (differ || frames == 0){
+        return 1;
+    }
+    return bad ? 2 : 0;
+}
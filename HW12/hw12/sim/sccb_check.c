@@ -0,0 +1,124 @@
+// Checks the I2C commands OV7670_write_table() hands to the DMA, on the computer.
+//
+//   sccb_check
+//
+// The words from camRegsSccb() are fed to a model of the RP2040 I2C master's data_cmd
+// register: the low 8 bits go out after the address, and bit 9 ends the write with a stop.
+// The writes that come out are compared with the tables in ov7670.h.
+//
+// - one write per register to the camera, register then value, a stop after each
+// - in the order of the table, the {0xff, 0xff} end marker never sent
+// - a table longer than the command buffer is refused instead of overrunning it
+// - how long the tables take on the bus at 400kHz
+//
+// Prints what it checked and exits with 1 if anything was wrong.
+
+#include <stdio.h>
+#include <string.h>
+
+#include "camregs.h"
+
+static int failed = 0;
+
+static void check(int ok, const char *what){
+    printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+    if (!ok){
+        failed = 1;
+    }
+}
+
+// the writes that made it onto the bus
+typedef struct busLog{
+    uint8_t addr[OV7670_MAX_TABLE*2];
+    uint8_t bytes[OV7670_MAX_TABLE*2][4];
+    int len[OV7670_MAX_TABLE*2];
+    int writes;
+    int bits; // clock cycles, for the time
+} busLog_t;
+
+// the I2C master sending data_cmd words to the target address tar
+static void sendWords(busLog_t *b, uint8_t tar, const uint16_t *cmds, int n){
+    int open = 0;
+    int i;
+    b->writes = 0;
+    b->bits = 0;
+    for(i=0;i<n;i++){
+        if (!open){
+            // start and address byte with its ack
+            b->addr[b->writes] = tar;
+            b->len[b->writes] = 0;
+            b->bits += 1 + 9;
+            open = 1;
+        }
+        int k = b->len[b->writes];
+        if (k < 4){
+            b->bytes[b->writes][k] = cmds[i] & 0xFF;
+        }
+        b->len[b->writes]++;
+        b->bits += 9;
+        if (cmds[i] & CAMREGS_SCCB_STOP){
+            b->bits += 1;
+            b->writes++;
+            open = 0;
+        }
+    }
+    if (open){
+        b->writes = -1; // left the bus hanging without a stop
+    }
+}
+
+// the table as writes of {reg, value}, in order
+static int matchesTable(const busLog_t *b, const uint8_t table[][2]){
+    int i;
+    for(i=0;table[i][0] != 0xff;i++){
+        if (i >= b->writes || b->addr[i] != OV7670_ADDR || b->len[i] != 2){
+            return 0;
+        }
+        if (b->bytes[i][0] != table[i][0] || b->bytes[i][1] != table[i][1]){
+            return 0;
+        }
+    }
+    return i == b->writes;
+}
+
+int main(){
+    static uint16_t cmds[2*OV7670_MAX_TABLE];
+    static busLog_t bus;
+    struct { const char *name; const uint8_t (*table)[2]; } tables[] = {
+        {"OV7670_init", OV7670_init},
+        {"OV7670_rgb", OV7670_rgb},
+        {"OV7670_yuv", OV7670_yuv},
+    };
+    int i;
+    int ok = 1;
+    int bits = 0;
+
+    for(i=0;i<3;i++){
+        int n = camRegsSccb(tables[i].table, cmds, OV7670_MAX_TABLE);
+        sendWords(&bus, OV7670_ADDR, cmds, 2*n);
+        if (n <= 0 || !matchesTable(&bus, tables[i].table)){
+            printf("     %s differs\n", tables[i].name);
+            ok = 0;
+        }
+        printf("     %s: %d registers, %.2f ms at 400kHz\n", tables[i].name, n, bus.bits / 400.0);
+        if (i < 2){
+            bits += bus.bits;
+        }
+    }
+    check(ok, "the ov7670.h tables go out as one write per register, in order, a stop after each");
+
+    static uint8_t tooLong[OV7670_MAX_TABLE + 2][2];
+    memset(tooLong, 0x11, sizeof(tooLong));
+    tooLong[OV7670_MAX_TABLE + 1][0] = 0xff;
+    cmds[2*OV7670_MAX_TABLE - 1] = 0;
+    check(camRegsSccb((const uint8_t (*)[2])tooLong, cmds, OV7670_MAX_TABLE) < 0, "a table longer than the command buffer is refused");
+    tooLong[OV7670_MAX_TABLE][0] = 0xff;
+    check(camRegsSccb((const uint8_t (*)[2])tooLong, cmds, OV7670_MAX_TABLE) == OV7670_MAX_TABLE, "a table that just fits is taken");
+
+    static const uint8_t empty[1][2] = {{0xff, 0xff}};
+    check(camRegsSccb(empty, cmds, OV7670_MAX_TABLE) == 0, "an empty table sends nothing");
+
+    printf("     init + rgb: %.2f ms on the bus, the old writes slept 1 ms each (%d ms)\n", bits / 400.0,
+        camRegsSccb(OV7670_init, cmds, OV7670_MAX_TABLE) + camRegsSccb(OV7670_rgb, cmds, OV7670_MAX_TABLE));
+    return failed;
+}
@@ -0,0 +1,204 @@
+// Checks trackLine() (frameTrackLine() in linefind.c) on frames dumped by printImage(), on the computer.
+//
+//   track_check                     made up frames, written out and read back as printImage() dumps
+//   track_check dump.txt ...        dumps saved from the serial port as well
+//
+// A dump is the "i r g b" lines printImage() prints after convertImage(), one per pixel.
+// r, g and b keep all the RGB565 bits, so the frame the camera sent is rebuilt from them.
+// The made up frames have a line of known offset, heading and curvature.
+//
+// - the fit gives back the offset, heading and curvature it was drawn with
+// - each row's center is the same as findLine() on the dump
+// - rows with no line are left out and lower the confidence, a frame with no line has none
+//
+// Prints what it checked and exits with 1 if anything was wrong.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "linefind.h"
+#include "legacy.h"
+
+static int failed = 0;
+
+static void check(int ok, const char *what){
+    printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+    if (!ok){
+        failed = 1;
+    }
+}
+
+static legacyImage_t pic;
+static uint8_t frame[BIN_MAX_X*BIN_MAX_Y*2];
+
+// what printImage() prints
+static void writeDump(FILE *out, const legacyImage_t *p){
+    int i;
+    for(i=0;i<p->sizeX*p->sizeY;i++){
+        fprintf(out, "%d %d %d %d\r\n", i, p->r[i], p->g[i], p->b[i]);
+    }
+}
+
+// a printImage() dump back into the planes, the size from the number of pixels.
+// returns 0 if it isn't one of the sizes or a line doesn't parse
+static int readDump(FILE *in, legacyImage_t *p){
+    static const int sizes[][2] = {{80, 60}, {160, 120}, {40, 30}};
+    int i, r, g, b;
+    int n = 0;
+    while (fscanf(in, "%d %d %d %d", &i, &r, &g, &b) == 4){
+        if (i != n || n >= BIN_MAX_X*BIN_MAX_Y){
+            return 0;
+        }
+        p->r[n] = r;
+        p->g[n] = g;
+        p->b[n] = b;
+        n++;
+    }
+    for(i=0;i<3;i++){
+        if (sizes[i][0]*sizes[i][1] == n){
+            p->sizeX = sizes[i][0];
+            p->sizeY = sizes[i][1];
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// the RGB565 bytes convertImage() was given
+static void toRgb565(const legacyImage_t *p, uint8_t *data){
+    int i;
+    for(i=0;i<p->sizeX*p->sizeY;i++){
+        uint16_t px = ((p->r[i] >> 3) << 11) | ((p->g[i] >> 2) << 5) | (p->b[i] >> 3);
+        data[2*i] = px & 0xFF;
+        data[2*i+1] = px >> 8;
+    }
+}
+
+// a line x = a + b*y + c*y*y (y up from the bottom row) on a darker floor, straight into the planes.
+// it starts at row top, the rows above it are flat
+static void drawLine(legacyImage_t *p, int sizeX, int sizeY, float a, float b, float c, int top){
+    int x, y;
+    p->sizeX = sizeX;
+    p->sizeY = sizeY;
+    for(y=0;y<sizeY;y++){
+        float up = sizeY - 1 - y;
+        float center = a + b*up + c*up*up;
+        for(x=0;x<sizeX;x++){
+            int v = (fabsf(x - center) <= 2.5f && y >= top) ? 200 : 48;
+            p->r[y*sizeX + x] = (v >> 3) << 3;
+            p->g[y*sizeX + x] = (v >> 2) << 2;
+            p->b[y*sizeX + x] = (v >> 3) << 3;
+        }
+    }
+}
+
+// dump the planes, read them back and rebuild the frame, as if it came from the serial port
+static int roundTrip(legacyImage_t *p, camFrame_t *f){
+    FILE *tmp = tmpfile();
+    int ok;
+    writeDump(tmp, p);
+    rewind(tmp);
+    memset(p, 0, sizeof(*p));
+    ok = readDump(tmp, p);
+    fclose(tmp);
+    toRgb565(p, frame);
+    f->data = frame;
+    f->sizeX = p->sizeX;
+    f->sizeY = p->sizeY;
+    f->bpp = 2;
+    return ok;
+}
+
+// each row's center against findLine() on the dump, findLine() thresholds the planes so it goes last
+static int sameCenters(legacyImage_t *p, const camFrame_t *f){
+    int row;
+    int same = 1;
+    for(row=0;row<f->sizeY;row++){
+        same = same && frameFindLine(f, row) == legacyFindLine(p, row);
+    }
+    return same;
+}
+
+int main(int argc, char **argv){
+    // offset from center, heading, curvature in 1/pixels
+    static const float lines[][3] = {
+        {0, 0, 0}, {10, 0, 0}, {-15, 0.3f, 0}, {5, -0.5f, 0}, {0, 0, 0.004f}, {-8, 0.2f, -0.006f}, {12, -0.1f, 0.003f},
+    };
+    static const int sizes[][2] = {{80, 60}, {160, 120}};
+    lineTrack_t t;
+    camFrame_t f;
+    int i, s;
+    int fitOk = 1, rowsOk = 1, dumpOk = 1;
+
+    for(s=0;s<2;s++){
+        int x = sizes[s][0], y = sizes[s][1];
+        int rows[5] = {y/2, 5*y/8, 3*y/4, 7*y/8, y-1};
+        // the centers are whole pixels, so what the fit can get back shrinks with the rows it spans
+        float span = y - 1 - y/2;
+        float allowed[3] = {0.5f, 1.5f / span, 4 / (span*span)};
+        float worst[3] = {0, 0, 0};
+        for(i=0;i<7;i++){
+            // scale the shape with the image so it looks the same at both sizes
+            float k = x / 80.0f;
+            float a = (x - 1) / 2.0f + lines[i][0]*k;
+            float c = lines[i][2] / k;
+            drawLine(&pic, x, y, a, lines[i][1], c, 0);
+            dumpOk = dumpOk && roundTrip(&pic, &f);
+            frameTrackLine(&f, rows, 5, &t);
+            rowsOk = rowsOk && sameCenters(&pic, &f);
+
+            float want[3] = {lines[i][0]*k, atanf(lines[i][1]), 2*c / powf(1 + lines[i][1]*lines[i][1], 1.5f)};
+            float got[3] = {t.offset, t.heading, t.curvature};
+            int m;
+            for(m=0;m<3;m++){
+                float e = fabsf(got[m] - want[m]);
+                worst[m] = e > worst[m] ? e : worst[m];
+            }
+            fitOk = fitOk && t.rows == 5 && t.confidence > 0.6f;
+        }
+        printf("     %dx%d worst: offset %.2f px, heading %.3f rad, curvature %.4f 1/px (allowed %.2f, %.3f, %.4f)\n",
+            x, y, worst[0], worst[1], worst[2], allowed[0], allowed[1], allowed[2]);
+        fitOk = fitOk && worst[0] < allowed[0] && worst[1] < allowed[1] && worst[2] < allowed[2];
+    }
+    check(dumpOk, "made up frames round trip through printImage() dumps");
+    check(rowsOk, "every row's center is the same as findLine() on the dump");
+    check(fitOk, "the fit gives back the line it was drawn with");
+
+    // the line stops part way up, the top rows looked at are flat
+    drawLine(&pic, 80, 60, 39.5f, 0, 0, 40);
+    roundTrip(&pic, &f);
+    int rows[5] = {30, 37, 45, 52, 59};
+    frameTrackLine(&f, rows, 5, &t);
+    float full = t.confidence;
+    check(t.rows == 3 && fabsf(t.offset) < 0.6f && full < 0.7f && full > 0.4f, "flat rows are left out and lower the confidence");
+
+    drawLine(&pic, 80, 60, 39.5f, 0, 0, 60);
+    roundTrip(&pic, &f);
+    frameTrackLine(&f, rows, 5, &t);
+    check(t.rows == 0 && t.confidence == 0, "no line, no confidence");
+
+    for(i=1;i<argc;i++){
+        FILE *in = fopen(argv[i], "r");
+        if (!in){
+            perror(argv[i]);
+            return 2;
+        }
+        int ok = readDump(in, &pic);
+        fclose(in);
+        if (!ok){
+            check(0, argv[i]);
+            continue;
+        }
+        toRgb565(&pic, frame);
+        camFrame_t d = {frame, pic.sizeX, pic.sizeY, 2};
+        int y = pic.sizeY;
+        int dumpRows[5] = {y/2, 5*y/8, 3*y/4, 7*y/8, y-1};
+        frameTrackLine(&d, dumpRows, 5, &t);
+        printf("     %s: rows %d offset %.2f heading %.3f curvature %.4f confidence %.2f\n", argv[i],
+            t.rows, t.offset, t.heading, t.curvature, t.confidence);
+        check(sameCenters(&pic, &d), "dump: every row's center is the same as findLine()");
+    }
+    return failed;
+}
@@ -0,0 +1,157 @@
+#include <math.h>
+#include "attitude.h"
+
+#define GYRO_LSB_PER_DPS 16.4 // +-2000 degrees/s
+#define DEG_TO_RAD 0.017453292519943295
+#define PI_F 3.14159265f
+
+// keep an angle in -pi to pi
+static int32_t wrap(int32_t a) {
+    if (a > ATT_PI) {
+        a -= 2 * ATT_PI;
+    } else if (a <= -ATT_PI) {
+        a += 2 * ATT_PI;
+    }
+    return a;
+}
+
+// atan2 in Q24 radians, within about 0.01 degree. y and x are up to 16 bits or so, like sensor counts.
+// atan(z) for z in 0-1 is z(a1 + a3 z^2 + a5 z^4 + a7 z^6 + a9 z^8) (Abramowitz and Stegun 4.4.47), worked in Q15
+int32_t att_atan2(int32_t y, int32_t x) {
+    int32_t ax = x < 0 ? -x : x;
+    int32_t ay = y < 0 ? -y : y;
+    int32_t z, z2, a;
+    if (ax == 0 && ay == 0) {
+        return 0;
+    }
+    // the smaller over the bigger, so z is 0-1
+    z = ax >= ay ? (ay << 15) / ax : (ax << 15) / ay;
+    z2 = (z * z) >> 15;
+    a = 683;
+    a = -2790 + ((a * z2) >> 15);
+    a = 5903 + ((a * z2) >> 15);
+    a = -10823 + ((a * z2) >> 15);
+    a = 32764 + ((a * z2) >> 15);
+    a = (a * z) >> 15;
+    a = a << (ATT_Q - 15);
+    if (ay > ax) {
+        a = ATT_PI / 2 - a;
+    }
+    if (x < 0) {
+        a = ATT_PI - a;
+    }
+    return y < 0 ? -a : a;
+}
+
+// integer square root, a bit at a time
+uint32_t att_sqrt(uint32_t v) {
+    uint32_t r = 0;
+    uint32_t bit = 1u << 30;
+    while (bit > v) {
+        bit >>= 2;
+    }
+    while (bit) {
+        if (v >= r + bit) {
+            v -= r + bit;
+            r = (r >> 1) + bit;
+        } else {
+            r >>= 1;
+        }
+        bit >>= 2;
+    }
+    return r;
+}
+
+// period_us is the time between samples, up to 10ms. the angles follow the accelerometer
+// with a time constant of about period_us << shift, 9 at 1kHz is half a second
+void attitude_init(attitude_t *a, uint32_t period_us, int shift) {
+    if (period_us > 10000) {
+        period_us = 10000; // any longer and gyro counts * gyro_k doesn't fit in 32 bits
+    }
+    a->gyro_k = (int32_t)(DEG_TO_RAD / GYRO_LSB_PER_DPS * period_us * 1e-6 * ATT_ONE * (1 << ATT_K_BITS) + 0.5);
+    a->shift = shift;
+    a->accel_scale[0] = 1 << 14;
+    a->accel_scale[1] = 1 << 14;
+    a->accel_scale[2] = 1 << 14;
+    a->roll = 0;
+    a->pitch = 0;
+    a->yaw_rate = 0;
+    a->primed = 0;
+}
+
+// accelerometer scale factors in Q14, the biases are taken off by the sensor (mpu6050_set_offsets())
+void attitude_set_accel_scale(attitude_t *a, const int32_t scale[3]) {
+    a->accel_scale[0] = scale[0];
+    a->accel_scale[1] = scale[1];
+    a->accel_scale[2] = scale[2];
+}
+
+void attitude_update(attitude_t *a, const imu_data_t *d) {
+    // what the accelerometer says, from the direction of gravity
+    int32_t ax = (d->accel_x * a->accel_scale[0]) >> 14;
+    int32_t ay = (d->accel_y * a->accel_scale[1]) >> 14;
+    int32_t az = (d->accel_z * a->accel_scale[2]) >> 14;
+    int32_t roll_acc = att_atan2(ay, az);
+    uint32_t yz = att_sqrt((uint32_t)(ay * ay) + (uint32_t)(az * az));
+    int32_t pitch_acc = att_atan2(-ax, yz);
+    if (!a->primed) {
+        a->roll = roll_acc;
+        a->pitch = pitch_acc;
+        a->primed = 1;
+    }
+
+    // what the gyro says
+    a->roll = wrap(a->roll + ((d->gyro_x * a->gyro_k) >> ATT_K_BITS));
+    a->pitch = a->pitch + ((d->gyro_y * a->gyro_k) >> ATT_K_BITS);
+    // 17855 is radians/s per count in Q24
+    a->yaw_rate = d->gyro_z * 17855;
+
+    // a little of the way to the accelerometer, the short way round
+    a->roll = wrap(a->roll + (wrap(roll_acc - a->roll) >> a->shift));
+    a->pitch = a->pitch + ((pitch_acc - a->pitch) >> a->shift);
+}
+
+void attitude_float_init(attitude_float_t *a, uint32_t period_us, int shift) {
+    a->gyro_k = DEG_TO_RAD / GYRO_LSB_PER_DPS * period_us * 1e-6;
+    a->alpha = 1.0f / (1 << shift);
+    a->accel_scale[0] = 1;
+    a->accel_scale[1] = 1;
+    a->accel_scale[2] = 1;
+    a->roll = 0;
+    a->pitch = 0;
+    a->yaw_rate = 0;
+    a->primed = 0;
+}
+
+static float wrapf(float a) {
+    if (a > PI_F) {
+        a -= 2 * PI_F;
+    } else if (a <= -PI_F) {
+        a += 2 * PI_F;
+    }
+    return a;
+}
+
+void attitude_float_set_accel_scale(attitude_float_t *a, const int32_t scale[3]) {
+    a->accel_scale[0] = scale[0] / 16384.0f;
+    a->accel_scale[1] = scale[1] / 16384.0f;
+    a->accel_scale[2] = scale[2] / 16384.0f;
+}
+
+void attitude_float_update(attitude_float_t *a, const imu_data_t *d) {
+    float ax = d->accel_x * a->accel_scale[0];
+    float ay = d->accel_y * a->accel_scale[1];
+    float az = d->accel_z * a->accel_scale[2];
+    float roll_acc = atan2f(ay, az);
+    float pitch_acc = atan2f(-ax, sqrtf(ay * ay + az * az));
+    if (!a->primed) {
+        a->roll = roll_acc;
+        a->pitch = pitch_acc;
+        a->primed = 1;
+    }
+    a->roll = wrapf(a->roll + d->gyro_x * a->gyro_k);
+    a->pitch = a->pitch + d->gyro_y * a->gyro_k;
+    a->yaw_rate = d->gyro_z * (float)(DEG_TO_RAD / GYRO_LSB_PER_DPS);
+    a->roll = wrapf(a->roll + wrapf(roll_acc - a->roll) * a->alpha);
+    a->pitch = a->pitch + (pitch_acc - a->pitch) * a->alpha;
+}
@@ -0,0 +1,54 @@
+#ifndef ATTITUDE_H__
+#define ATTITUDE_H__
+
+#include <stdint.h>
+#include "imu.h"
+
+// Roll and pitch from the MPU6050, a complementary filter: the gyro rates are added up every
+// sample and the angles are pulled a little towards what the accelerometer says each time,
+// so the gyro drift can't build up and the accelerometer noise is smoothed out.
+// Yaw can only be given as a rate, nothing measures the heading.
+//
+// attitude_t is fixed point, radians in Q24 (1 << 24 is 1 radian), for the RP2040 which has no FPU.
+// Each sample is integer adds, shifts and 32 bit multiplies, one divide per angle in att_atan2(),
+// and an integer square root (att_sqrt(), 16 rounds of compare, subtract and shift) for pitch.
+// attitude_float_t is the same filter in float, to check it against.
+// No pico calls in here, so it builds on the computer too (see sim/).
+// Expects the settings in mpu6050_init(), +-2g and +-2000 degrees/s.
+
+#define ATT_Q 24
+#define ATT_ONE (1 << ATT_Q)
+#define ATT_PI 52707179 // pi in Q24
+#define ATT_K_BITS 8 // extra fraction bits in the per sample gyro scale
+
+typedef struct {
+    int32_t roll; // Q24 radians, right side down is positive
+    int32_t pitch; // Q24 radians, nose up is positive
+    int32_t yaw_rate; // Q24 radians/s
+    int32_t gyro_k; // radians turned per gyro count per sample, Q(24+ATT_K_BITS)
+    int32_t accel_scale[3]; // Q14, from the calibration, see imucal.h
+    int shift; // each sample the angles move 1/2^shift of the way to the accelerometer's
+    int primed; // 0 until the first sample, which starts the angles at the accelerometer's
+} attitude_t;
+
+typedef struct {
+    float roll; // radians
+    float pitch;
+    float yaw_rate; // radians/s
+    float gyro_k; // radians turned per gyro count per sample
+    float accel_scale[3];
+    float alpha; // 1/2^shift
+    int primed;
+} attitude_float_t;
+
+void attitude_init(attitude_t *a, uint32_t period_us, int shift);
+void attitude_set_accel_scale(attitude_t *a, const int32_t scale[3]);
+void attitude_update(attitude_t *a, const imu_data_t *d);
+void attitude_float_init(attitude_float_t *a, uint32_t period_us, int shift);
+void attitude_float_set_accel_scale(attitude_float_t *a, const int32_t scale[3]);
+void attitude_float_update(attitude_float_t *a, const imu_data_t *d);
+
+int32_t att_atan2(int32_t y, int32_t x);
+uint32_t att_sqrt(uint32_t v);
+
+#endif
@@ -0,0 +1,31 @@
+#include <string.h>
+#include "calstore.h"
+#include "pico/stdlib.h"
+#include "pico/flash.h"
+#include "hardware/flash.h"
+
+#define CAL_FLASH_OFFSET (PICO_FLASH_SIZE_BYTES - FLASH_SECTOR_SIZE)
+
+// read the record through XIP. returns IMU_CAL_OK and fills in cal, or what was wrong with it
+int cal_store_load(imu_cal_t *cal) {
+    return imu_cal_unpack((const uint8_t *)(XIP_BASE + CAL_FLASH_OFFSET), cal);
+}
+
+// runs with nothing else using flash, see flash_safe_execute()
+static void cal_store_write(void *page) {
+    flash_range_erase(CAL_FLASH_OFFSET, FLASH_SECTOR_SIZE);
+    flash_range_program(CAL_FLASH_OFFSET, page, FLASH_PAGE_SIZE);
+}
+
+// erase the sector and write the record, then read it back. false if it didn't take
+bool cal_store_save(const imu_cal_t *cal) {
+    uint8_t page[FLASH_PAGE_SIZE];
+    imu_cal_t check;
+    memset(page, 0xFF, sizeof(page));
+    imu_cal_pack(cal, page);
+    // the other core and interrupts are kept off the flash while it is written, about 50ms
+    if (flash_safe_execute(cal_store_write, page, 1000) != PICO_OK) {
+        return false;
+    }
+    return cal_store_load(&check) == IMU_CAL_OK && memcmp(&check, cal, sizeof(check)) == 0;
+}
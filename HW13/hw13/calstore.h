@@ -0,0 +1,12 @@
+#ifndef CALSTORE_H__
+#define CALSTORE_H__
+
+#include "imucal.h"
+
+// The IMU calibration in the last 4k sector of flash, well past the end of the program.
+// The record format and its checks are in imucal.c.
+
+int cal_store_load(imu_cal_t *cal);
+bool cal_store_save(const imu_cal_t *cal);
+
+#endif
@@ -5,150 +5,306 @@
 #include "hardware/i2c.h"
 #include "hardware/adc.h"
 #include "ssd1306.h"
-#include "font.h"
-
-// MPU6050 I2C address
-#define MPU6050_ADDRESS 0x68
-
-// MPU6050 config registers
-#define CONFIG 0x1A
-#define GYRO_CONFIG 0x1B
-#define ACCEL_CONFIG 0x1C
-#define PWR_MGMT_1 0x6B
-#define PWR_MGMT_2 0x6C
-
-// MPU6050 sensor data registers
-#define ACCEL_XOUT_H 0x3B
-#define ACCEL_XOUT_L 0x3C
-#define ACCEL_YOUT_H 0x3D
-#define ACCEL_YOUT_L 0x3E
-#define ACCEL_ZOUT_H 0x3F
-#define ACCEL_ZOUT_L 0x40
-#define TEMP_OUT_H   0x41
-#define TEMP_OUT_L   0x42
-#define GYRO_XOUT_H  0x43
-#define GYRO_XOUT_L  0x44
-#define GYRO_YOUT_H  0x45
-#define GYRO_YOUT_L  0x46
-#define GYRO_ZOUT_H  0x47
-#define GYRO_ZOUT_L  0x48
-#define WHO_AM_I     0x75
+#include "draw.h"
+#include "text.h"
+#include "mpu6050.h"
+#include "attitude.h"
+#include "imucal.h"
+#include "calstore.h"
+#include "sched.h"
+#include "logbuf.h"
+#include "telemetry.h"
+#include "tusb.h"
+#include "hardware/structs/systick.h"
+
+// I2C defines
+#define I2C_PORT i2c0
+#define I2C_SDA 8
+#define I2C_SCL 9
+
 #define DISPLAY_WIDTH 128
 #define DISPLAY_HEIGHT 32
 #define CENTER_X (DISPLAY_WIDTH / 2)
 #define CENTER_Y (DISPLAY_HEIGHT / 2)
 
+// 1 to let the MPU6050 take samples on its own clock into its FIFO, 0 to read one each time round the loop
+#define IMU_FIFO 1
+#define IMU_RATE_HZ 1000
+#define MPU6050_INT_PIN 16 // the MPU6050's INT pin
+#define RAD_TO_DEG 57.29578f
+#define CAL_SAMPLES 1000 // per pose, 1 a ms
+
+// how often each job runs. the IMU job has to come round well inside the 73ms the FIFO holds,
+// the display and the log only need to be as quick as anyone can read them
+#define IMU_TASK_US 5000 // empty the FIFO and filter, about 5 samples each time at 1kHz
+#define DISPLAY_HZ 30
+#define LOG_HZ 10
+#define SERIAL_TASK_US 2000 // send queued log bytes and look for typed commands
+#define TELEMETRY 0 // 1 to start with every sample sent in binary instead of the text log, t and l switch
+#define ATT_BENCH 0 // 1 to log the cycles each filter update takes on this chip at start, see attitude_bench()
+
+// the newest filter output, what the display and the log show
 typedef struct {
-    int16_t accel_x, accel_y, accel_z;
-    int16_t temp;
-    int16_t gyro_x, gyro_y, gyro_z;
-} imu_data_t;
-
-void writeReg(uint8_t address, uint8_t reg, uint8_t value) {
-    uint8_t buf[2] = {reg, value};
-    i2c_write_blocking(I2C_PORT, address, buf, 2, false);
+    int32_t roll, pitch, yaw_rate; // Q24, from attitude_t
+    imu_data_t data; // newest sample
+    uint32_t t; // when the sensor took it
+    uint32_t samples; // through the filter since boot
+    uint32_t filter_us; // longest time filtering one batch since the last log line
+} imu_state_t;
+
+ssd1306_t display;
+imu_ring_t imu_ring; // samples from the FIFO, oldest first
+attitude_t attitude; // roll and pitch, updated with every sample
+imu_state_t imu_state;
+sched_t sched;
+logbuf_t log_out; // everything for the serial port goes through here
+uint32_t display_age_max = 0; // oldest sample shown since the last log line, us
+bool recalibrate = false;
+bool telemetry = TELEMETRY; // every sample goes out as a telemetry.h record, no text log
+
+float accel_to_g(int16_t raw_accel) {
+    return raw_accel * 0.000061;
 }
 
-uint8_t readReg(uint8_t address, uint8_t reg) {
-    uint8_t value = 0;
-    i2c_write_blocking(I2C_PORT, address, &reg, 1, true);  // true to keep master control of bus
-    i2c_read_blocking(I2C_PORT, address, &value, 1, false); // false - finished with bus
-    return value;
+// the sensor takes the biases off, the filter does the scale
+void use_calibration(const imu_cal_t *cal) {
+    mpu6050_set_offsets(cal);
+    attitude_set_accel_scale(&attitude, cal->accel_scale);
+    attitude.primed = 0; // start again from the corrected accelerometer
 }
 
-bool mpu6050_init() {
-    uint8_t who_am_i = readReg(MPU6050_ADDRESS, WHO_AM_I);
-    if (who_am_i != 0x68 && who_am_i != 0x98) {
-        return false;
-    }
-    writeReg(MPU6050_ADDRESS, PWR_MGMT_1, 0x00);
-    writeReg(MPU6050_ADDRESS, ACCEL_CONFIG, 0x00);
-    writeReg(MPU6050_ADDRESS, GYRO_CONFIG, 0x18);
-    
-    return true;
+#if ATT_BENCH
+// cycles for attitude_update() and the float one, counted with SysTick and averaged over
+// ATT_BENCH_RUNS updates of a real sample. sim/attitude_replay only times them on the computer.
+// a pico2's RP2350 has an FPU, so the float one isn't the software float it is on an RP2040
+#define ATT_BENCH_RUNS 1000
+uint32_t systick_cycles(uint32_t start) {
+    return (start - systick_hw->cvr) & 0xffffff; // 24 bits counting down
 }
-void mpu6050_read_data(imu_data_t *data) {
-    uint8_t buffer[14];
-    uint8_t reg = ACCEL_XOUT_H;
-    
-    i2c_write_blocking(I2C_PORT, MPU6050_ADDRESS, &reg, 1, true);
-    i2c_read_blocking(I2C_PORT, MPU6050_ADDRESS, buffer, 14, false);
-    data->accel_x = (int16_t)((buffer[0] << 8) | buffer[1]);
-    data->accel_y = (int16_t)((buffer[2] << 8) | buffer[3]);
-    data->accel_z = (int16_t)((buffer[4] << 8) | buffer[5]);
-    data->temp = (int16_t)((buffer[6] << 8) | buffer[7]);
-    data->gyro_x = (int16_t)((buffer[8] << 8) | buffer[9]);
-    data->gyro_y = (int16_t)((buffer[10] << 8) | buffer[11]);
-    data->gyro_z = (int16_t)((buffer[12] << 8) | buffer[13]);
+
+void attitude_bench(void) {
+    attitude_t fx = attitude;
+    attitude_float_t fl;
+    imu_data_t data;
+    uint32_t fixed = 0, flt = 0, empty = 0;
+    int i;
+    attitude_float_init(&fl, 1000000 / IMU_RATE_HZ, fx.shift);
+    mpu6050_read_data(&data);
+    systick_hw->rvr = 0xffffff;
+    systick_hw->cvr = 0;
+    systick_hw->csr = 5; // on, counting processor clocks, no interrupt
+    for (i = 0; i < ATT_BENCH_RUNS; i++) {
+        data.accel_x += (i & 7) - 4; // not quite the same sample every time
+        uint32_t start = systick_hw->cvr;
+        empty += systick_cycles(start);
+        start = systick_hw->cvr;
+        attitude_update(&fx, &data);
+        fixed += systick_cycles(start);
+        start = systick_hw->cvr;
+        attitude_float_update(&fl, &data);
+        flt += systick_cycles(start);
+    }
+    logbuf_printf(&log_out, "cycles per update: fixed %lu, float %lu\n", (unsigned long)((fixed - empty) / ATT_BENCH_RUNS),
+        (unsigned long)((flt - empty) / ATT_BENCH_RUNS));
 }
+#endif
 
-float accel_to_g(int16_t raw_accel) {
-    return raw_accel * 0.000061;
+// show msg and collect one pose of samples, up to 3 goes if the board gets moved
+bool calibration_pose(imu_cal_run_t *run, const char *msg) {
+    imu_data_t d;
+    int tries, i;
+    for (tries = 0; tries < 3; tries++) {
+        ssd1306_clear(&display);
+        drawString(&display, 0, 0, msg);
+        ssd1306_update(&display);
+        sleep_ms(500); // time to let go of it
+        for (i = 0; i < CAL_SAMPLES; i++) {
+            mpu6050_read_data(&d);
+            imu_cal_add(run, &d);
+            sleep_ms(1);
+        }
+        if (imu_cal_end_pose(run)) {
+            return true;
+        }
+    }
+    return false;
 }
 
-void draw_line_vertical(int x0, int y0, int y1) {
-    
-    while(y0 < y1){
-        ssd1306_drawPixel(x0, y0, 1);
-        y0 += 1;
+// measure the biases with the board flat, and upside down too if it is turned over
+// within 10s, which also gives the z scale. then use them and save them in flash
+void calibrate_imu(void) {
+    imu_cal_run_t run;
+    imu_cal_t cal;
+    imu_data_t d;
+    int i;
+    ssd1306_wait(&display);
+    mpu6050_clear_offsets();
+    imu_cal_begin(&run);
+    calibration_pose(&run, "Calibrating, keep it\nflat and still");
+
+    ssd1306_clear(&display);
+    drawString(&display, 0, 0, "Now turn it upside\ndown, or wait 10s");
+    ssd1306_update(&display);
+    for (i = 0; i < 200; i++) {
+        mpu6050_read_data(&d);
+        if (d.accel_z < -IMU_CAL_ONE_G / 2) {
+            calibration_pose(&run, "Keep it upside down\nand still");
+            break;
+        }
+        sleep_ms(50);
     }
-    while(y0 > y1){
-        ssd1306_drawPixel(x0, y0, 1);
-        y0 -= 1;
+
+    ssd1306_clear(&display);
+    if (!imu_cal_solve(&run, &cal)) {
+        drawString(&display, 0, 0, "Calibration failed");
+    } else if (!cal_store_save(&cal)) {
+        drawString(&display, 0, 0, "Calibrated, but not\nsaved");
+    } else {
+        drawString(&display, 0, 0, "Calibrated");
     }
+    ssd1306_update(&display);
+    logbuf_printf(&log_out, "accel bias %d %d %d scale %ld %ld %ld, gyro bias %d %d %d\n", cal.accel_bias[0], cal.accel_bias[1],
+        cal.accel_bias[2], (long)cal.accel_scale[0], (long)cal.accel_scale[1], (long)cal.accel_scale[2],
+        cal.gyro_bias[0], cal.gyro_bias[1], cal.gyro_bias[2]);
+    use_calibration(&cal);
+    sleep_ms(1000);
 }
 
-void draw_line_horizontal(int x0, int y0, int x1) {
-    
-    while(x0 < x1){
-        ssd1306_drawPixel(x0, y0, 1);
-        x0 += 1;
+void pico_adc_init(void) {
+    adc_init();
+    adc_gpio_init(26);
+    adc_select_input(0);
+}
+
+// empty the FIFO and put every sample through the filter, then update imu_state
+void imu_task(void *arg) {
+    (void)arg;
+    ssd1306_wait(&display); // the MPU6050 shares the bus with the display
+#if IMU_FIFO
+    imu_sample_t sample;
+    mpu6050_drain_fifo(&imu_ring);
+    uint32_t start = time_us_32();
+    int n = 0;
+    while (imu_ring_pop(&imu_ring, &sample)) {
+        attitude_update(&attitude, &sample.data);
+        if (telemetry) {
+            uint8_t frame[TELEM_FRAME_BYTES];
+            logbuf_write(&log_out, frame, telem_encode(&sample, frame));
+        }
+        n++;
+    }
+    if (n == 0) {
+        return;
     }
-    while(x0 > x1){
-        ssd1306_drawPixel(x0, y0, 1);
-        x0 -= 1;
+    uint32_t took = time_us_32() - start;
+    if (took > imu_state.filter_us) {
+        imu_state.filter_us = took;
     }
+    imu_state.data = sample.data;
+    imu_state.t = sample.t;
+    imu_state.samples += n;
+#else
+    mpu6050_read_data(&imu_state.data);
+    imu_state.t = time_us_32();
+    attitude_update(&attitude, &imu_state.data);
+    if (telemetry) {
+        imu_sample_t sample = {imu_state.samples, imu_state.t, imu_state.data};
+        uint8_t frame[TELEM_FRAME_BYTES];
+        logbuf_write(&log_out, frame, telem_encode(&sample, frame));
+    }
+    imu_state.samples++;
+#endif
+    imu_state.roll = attitude.roll;
+    imu_state.pitch = attitude.pitch;
+    imu_state.yaw_rate = attitude.yaw_rate;
 }
 
-void drawLetterColumn(int x_offset, int y_offset, char c){
-    ssd1306_drawPixel(x_offset, y_offset+0, (c >> 0)%2);
-    ssd1306_drawPixel(x_offset, y_offset+1, (c >> 1)%2);
-    ssd1306_drawPixel(x_offset, y_offset+2, (c >> 2)%2);
-    ssd1306_drawPixel(x_offset, y_offset+3, (c >> 3)%2);
-    ssd1306_drawPixel(x_offset, y_offset+4, (c >> 4)%2);
-    ssd1306_drawPixel(x_offset, y_offset+5, (c >> 5)%2);
-    ssd1306_drawPixel(x_offset, y_offset+6, (c >> 6)%2);
-    ssd1306_drawPixel(x_offset, y_offset+7, (c >> 7)%2);
-}
+// draw the newest state and start sending it, it goes out while the other jobs run.
+// if the last frame is still going this one waits for the next turn
+void display_task(void *arg) {
+    (void)arg;
+    uint32_t age = time_us_32() - imu_state.t;
+    if (age > display_age_max) {
+        display_age_max = age;
+    }
+    ssd1306_clear(&display);
+
+    // 20 pixels a radian, about the same as the 20 pixels a g this used to draw from the accelerometer
+    int line_x = CENTER_X + ((imu_state.pitch * 20) >> ATT_Q);
+    int line_y = CENTER_Y + ((imu_state.roll * 20) >> ATT_Q);
+    if (line_x < 0) line_x = 0;
+    if (line_x >= DISPLAY_WIDTH) line_x = DISPLAY_WIDTH - 1;
+    if (line_y < 0) line_y = 0;
+    if (line_y >= DISPLAY_HEIGHT) line_y = DISPLAY_HEIGHT - 1;
 
-void drawLetter(int x_offset, int y_offset, char c){
-    c = c-32;
-    drawLetterColumn(x_offset+0, y_offset, ASCII[c][0]);
-    drawLetterColumn(x_offset+1, y_offset, ASCII[c][1]);
-    drawLetterColumn(x_offset+2, y_offset, ASCII[c][2]);
-    drawLetterColumn(x_offset+3, y_offset, ASCII[c][3]);
-    drawLetterColumn(x_offset+4, y_offset, ASCII[c][4]);
+    ssd1306_vline(&display, CENTER_X, CENTER_Y, line_y, 1);
+    ssd1306_hline(&display, CENTER_X, line_x, CENTER_Y, 1);
+    ssd1306_update_async(&display, NULL);
 }
 
-void drawMessage(int x_offset, int y_offset, char* message){
-    for(int i = 0; i < 20 && message[i] != 0; i++){
-        int x_pos = x_offset + (5 * i) % 125;
-        int y_pos = y_offset + ((5 * i) / 125) * 8;
-        if (y_pos < DISPLAY_HEIGHT - 8) {
-            drawLetter(x_pos, y_pos, message[i]);
-        }
+// the state, and how each job kept up since the last line. nothing while the telemetry is on
+void log_task(void *arg) {
+    (void)arg;
+    if (telemetry) {
+        sched_reset_stats(&sched);
+        return;
+    }
+    logbuf_printf(&log_out, "Accel: X=%.3f Y=%.3f Z=%.3f g\n", accel_to_g(imu_state.data.accel_x),
+        accel_to_g(imu_state.data.accel_y), accel_to_g(imu_state.data.accel_z));
+    logbuf_printf(&log_out, "Roll=%.2f Pitch=%.2f deg, yaw rate %.1f deg/s\n", imu_state.roll * RAD_TO_DEG / ATT_ONE,
+        imu_state.pitch * RAD_TO_DEG / ATT_ONE, imu_state.yaw_rate * RAD_TO_DEG / ATT_ONE);
+#if IMU_FIFO
+    const mpu6050_fifo_stats_t *st = mpu6050_fifo_stats();
+    logbuf_printf(&log_out, "%lu samples, filter %lu us, %lu lost, %lu dropped\n", (unsigned long)imu_state.samples,
+        (unsigned long)imu_state.filter_us, (unsigned long)st->lost, (unsigned long)imu_ring.dropped);
+#endif
+    char line[LOGBUF_LINE];
+    int len = 0;
+    int i;
+    for (i = 0; i < sched.count && len < (int)sizeof(line); i++) {
+        sched_task_t *t = &sched.tasks[i];
+        len += snprintf(line + len, sizeof(line) - len, "%s %lu/s late %lu took %lu, ", t->name,
+            (unsigned long)(t->runs * LOG_HZ), (unsigned long)t->late_max, (unsigned long)t->took_max);
     }
+    logbuf_printf(&log_out, "%sshown %lu us old, log %lu dropped\n", line, (unsigned long)display_age_max,
+        (unsigned long)log_out.dropped);
+    sched_reset_stats(&sched);
+    imu_state.filter_us = 0;
+    display_age_max = 0;
 }
 
-void pico_adc_init(void) {
-    adc_init();
-    adc_gpio_init(26);
-    adc_select_input(0);
+// send what USB can take now without waiting, and look for commands:
+// c calibrate again, t binary telemetry, l back to the text log
+void serial_task(void *arg) {
+    (void)arg;
+    int c = getchar_timeout_us(0);
+    if (c == 'c') {
+        recalibrate = true;
+    } else if (c == 't') {
+        telemetry = true;
+    } else if (c == 'l') {
+        telemetry = false;
+    }
+    const char *p;
+    int n = logbuf_peek(&log_out, &p);
+    if (!stdio_usb_connected()) {
+        logbuf_consume(&log_out, n); // nobody listening, same as printf
+        return;
+    }
+    int room = tud_cdc_write_available();
+    if (n > room) {
+        n = room;
+    }
+    if (n > 0) {
+        stdio_put_string(p, n, false, false);
+        logbuf_consume(&log_out, n);
+    }
 }
 
 int main() {
     stdio_init_all();
     pico_adc_init();
+    logbuf_init(&log_out);
     
     // Initialize I2C
     i2c_init(I2C_PORT, 400 * 1000);
@@ -158,38 +314,48 @@ int main() {
     gpio_pull_up(I2C_SCL);
     
     // Initialize OLED
-    ssd1306_setup();
-    mpu6050_init()
-    
-    imu_data_t imu_data;
-    char message[25];
+    ssd1306_setup(&display, I2C_PORT, SSD1306_ADDRESS, DISPLAY_WIDTH, DISPLAY_HEIGHT);
+    mpu6050_init(I2C_PORT);
     
-    
-    while (true) {
-        mpu6050_read_data(&imu_data);
-        float accel_x_g = accel_to_g(imu_data.accel_x);
-        float accel_y_g = accel_to_g(imu_data.accel_y);
-        float accel_z_g = accel_to_g(imu_data.accel_z);
+#if IMU_FIFO
+    attitude_init(&attitude, 1000000 / IMU_RATE_HZ, 9); // follows the accelerometer over about 0.5s at 1kHz
+#else
+    attitude_init(&attitude, IMU_TASK_US, 7); // one sample per IMU job, about 0.6s
+#endif
 
-        ssd1306_clear();
-    
-        int line_x = CENTER_X - (int)(accel_x_g * 20);
-        int line_y = CENTER_Y + (int)(accel_y_g * 20);
-        if (line_x < 0) line_x = 0;
-        if (line_x >= DISPLAY_WIDTH) line_x = DISPLAY_WIDTH - 1;
-        if (line_y < 0) line_y = 0;
-        if (line_y >= DISPLAY_HEIGHT) line_y = DISPLAY_HEIGHT - 1;
-        
-
-        draw_line_vertical(CENTER_X, CENTER_Y, line_y);
-        draw_line_horizontal(CENTER_X, CENTER_Y, line_x);
-        ssd1306_drawPixel(CENTER_X, CENTER_Y, 1);
-        ssd1306_update();
-        
-        // Print to console for debugging
-        printf("Accel: X=%.3f Y=%.3f Z=%.3f g\n", accel_x_g, accel_y_g, accel_z_g);
-        
-        // Run at approximately 100Hz
-        sleep_ms(10);
-    }
-}
\ No newline at end of file
+    // the calibration saved last time, or a new one. type c to do it again
+    imu_cal_t cal;
+    int cal_status = cal_store_load(&cal);
+    if (cal_status == IMU_CAL_OK) {
+        use_calibration(&cal);
+    } else {
+        logbuf_printf(&log_out, "no calibration saved (%d)\n", cal_status);
+        calibrate_imu();
+    }
+#if ATT_BENCH
+    attitude_bench();
+#endif
+
+#if IMU_FIFO
+    imu_ring_init(&imu_ring);
+    mpu6050_start_fifo(IMU_RATE_HZ, MPU6050_INT_PIN);
+#endif
+
+    // offsets so the slower jobs don't all land on the same IMU period
+    sched_init(&sched, time_us_32);
+    sched_add(&sched, "imu", IMU_TASK_US, 0, imu_task, NULL);
+    sched_add(&sched, "display", 1000000 / DISPLAY_HZ, IMU_TASK_US / 2, display_task, NULL);
+    sched_add(&sched, "log", 1000000 / LOG_HZ, IMU_TASK_US / 4, log_task, NULL);
+    sched_add(&sched, "serial", SERIAL_TASK_US, IMU_TASK_US * 3 / 4, serial_task, NULL);
+
+    while (true) {
+        if (sched_poll(&sched) < 0) {
+            sleep_us(sched_idle_us(&sched));
+        }
+        if (recalibrate) {
+            recalibrate = false;
+            calibrate_imu(); // stops everything for a few seconds, the jobs skip what they missed
+            sched_reset_stats(&sched);
+        }
+    }
+}
@@ -0,0 +1,78 @@
+#include "imu.h"
+
+// 14 bytes as they come from ACCEL_XOUT_H on, by a burst read or from the FIFO
+void imu_unpack(const uint8_t *p, imu_data_t *data) {
+    data->accel_x = (int16_t)((p[0] << 8) | p[1]);
+    data->accel_y = (int16_t)((p[2] << 8) | p[3]);
+    data->accel_z = (int16_t)((p[4] << 8) | p[5]);
+    data->temp = (int16_t)((p[6] << 8) | p[7]);
+    data->gyro_x = (int16_t)((p[8] << 8) | p[9]);
+    data->gyro_y = (int16_t)((p[10] << 8) | p[11]);
+    data->gyro_z = (int16_t)((p[12] << 8) | p[13]);
+}
+
+void imu_ring_init(imu_ring_t *r) {
+    atomic_store_explicit(&r->head, 0, memory_order_relaxed);
+    atomic_store_explicit(&r->tail, 0, memory_order_relaxed);
+    r->seq = 0;
+    r->dropped = 0;
+}
+
+// samples waiting to be read
+int imu_ring_count(imu_ring_t *r) {
+    unsigned head = atomic_load_explicit(&r->head, memory_order_acquire);
+    unsigned tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+    return head - tail;
+}
+
+// writer: add one sample taken at time t. false if the ring was full and it was dropped
+bool imu_ring_push(imu_ring_t *r, uint32_t t, const imu_data_t *data) {
+    unsigned head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    // acquire so the slot isn't written before the reader is done copying it
+    unsigned tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+    uint32_t seq = r->seq++;
+    if (head - tail >= IMU_RING_SIZE) {
+        r->dropped++;
+        return false;
+    }
+    imu_sample_t *s = &r->samples[head & (IMU_RING_SIZE - 1)];
+    s->seq = seq;
+    s->t = t;
+    s->data = *data;
+    // release so the reader sees the whole sample
+    atomic_store_explicit(&r->head, head + 1, memory_order_release);
+    return true;
+}
+
+// writer: add packets FIFO packets back to back in bytes, oldest first. the sensor takes one every
+// period_us, so only the time of the newest is needed. returns how many fitted in the ring
+int imu_ring_push_packets(imu_ring_t *r, const uint8_t *bytes, int packets, uint32_t newest_t, uint32_t period_us) {
+    int i;
+    int pushed = 0;
+    imu_data_t data;
+    for (i = 0; i < packets; i++) {
+        imu_unpack(bytes + i * IMU_PACKET_BYTES, &data);
+        if (imu_ring_push(r, newest_t - (packets - 1 - i) * period_us, &data)) {
+            pushed++;
+        }
+    }
+    return pushed;
+}
+
+// writer: lost samples never reach the ring, move seq on so the reader sees the gap
+void imu_ring_skip(imu_ring_t *r, uint32_t lost) {
+    r->seq = r->seq + lost;
+}
+
+// reader: take the oldest sample, false if there isn't one
+bool imu_ring_pop(imu_ring_t *r, imu_sample_t *s) {
+    unsigned tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&r->head, memory_order_acquire);
+    if (head == tail) {
+        return false;
+    }
+    *s = r->samples[tail & (IMU_RING_SIZE - 1)];
+    // release so the writer doesn't reuse the slot before it is copied
+    atomic_store_explicit(&r->tail, tail + 1, memory_order_release);
+    return true;
+}
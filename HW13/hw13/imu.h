@@ -0,0 +1,44 @@
+#ifndef IMU_H__
+#define IMU_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+// MPU6050 samples and the ring buffer they are queued in.
+// No pico calls in here, so it builds on the computer too (see sim/).
+
+#define IMU_PACKET_BYTES 14 // accel xyz, temp, gyro xyz, 16 bits each, high byte first
+#define IMU_RING_SIZE 256 // samples, a power of 2
+
+typedef struct {
+    int16_t accel_x, accel_y, accel_z;
+    int16_t temp;
+    int16_t gyro_x, gyro_y, gyro_z;
+} imu_data_t;
+
+typedef struct {
+    uint32_t seq; // counts every sample the sensor took, gaps are samples that were lost
+    uint32_t t; // us since boot when the sensor took it
+    imu_data_t data;
+} imu_sample_t;
+
+// one writer and one reader, which can be on different cores or in an interrupt.
+// when it is full new samples are dropped, the reader's samples are never overwritten
+typedef struct {
+    imu_sample_t samples[IMU_RING_SIZE];
+    atomic_uint head; // next slot to write, only moved by the writer
+    atomic_uint tail; // next slot to read, only moved by the reader
+    uint32_t seq; // seq of the next sample pushed
+    uint32_t dropped; // samples thrown away because the ring was full
+} imu_ring_t;
+
+void imu_unpack(const uint8_t *p, imu_data_t *data);
+void imu_ring_init(imu_ring_t *r);
+int imu_ring_count(imu_ring_t *r);
+bool imu_ring_push(imu_ring_t *r, uint32_t t, const imu_data_t *data);
+int imu_ring_push_packets(imu_ring_t *r, const uint8_t *bytes, int packets, uint32_t newest_t, uint32_t period_us);
+void imu_ring_skip(imu_ring_t *r, uint32_t lost);
+bool imu_ring_pop(imu_ring_t *r, imu_sample_t *s);
+
+#endif
@@ -0,0 +1,196 @@
+#include "imucal.h"
+
+// no correction at all
+void imu_cal_identity(imu_cal_t *cal) {
+    int i;
+    for (i = 0; i < 3; i++) {
+        cal->accel_bias[i] = 0;
+        cal->gyro_bias[i] = 0;
+        cal->accel_scale[i] = IMU_CAL_SCALE_ONE;
+    }
+}
+
+static void pose_reset(imu_cal_pose_t *p) {
+    int i;
+    for (i = 0; i < 6; i++) {
+        p->sum[i] = 0;
+    }
+    for (i = 0; i < 3; i++) {
+        p->min[i] = INT16_MAX;
+        p->max[i] = INT16_MIN;
+    }
+    p->count = 0;
+}
+
+void imu_cal_begin(imu_cal_run_t *run) {
+    run->poses = 0;
+    pose_reset(&run->pose);
+}
+
+// one sample of the pose being collected, a second or so of them is plenty
+void imu_cal_add(imu_cal_run_t *run, const imu_data_t *d) {
+    imu_cal_pose_t *p = &run->pose;
+    int16_t g[3] = {d->gyro_x, d->gyro_y, d->gyro_z};
+    int i;
+    p->sum[0] += d->accel_x;
+    p->sum[1] += d->accel_y;
+    p->sum[2] += d->accel_z;
+    for (i = 0; i < 3; i++) {
+        p->sum[3 + i] += g[i];
+        if (g[i] < p->min[i]) {
+            p->min[i] = g[i];
+        }
+        if (g[i] > p->max[i]) {
+            p->max[i] = g[i];
+        }
+    }
+    p->count++;
+}
+
+// finish the pose and start the next one. false if it was thrown away because
+// there were no samples, the board moved, or there are already IMU_CAL_MAX_POSES
+bool imu_cal_end_pose(imu_cal_run_t *run) {
+    imu_cal_pose_t *p = &run->pose;
+    bool ok = p->count > 0 && run->poses < IMU_CAL_MAX_POSES;
+    int i;
+    for (i = 0; i < 3 && ok; i++) {
+        if (p->max[i] - p->min[i] > IMU_CAL_MAX_SPREAD) {
+            ok = false;
+        }
+    }
+    if (ok) {
+        for (i = 0; i < 6; i++) {
+            run->mean[run->poses][i] = p->sum[i] / p->count;
+        }
+        run->poses++;
+    }
+    pose_reset(p);
+    return ok;
+}
+
+// work out the calibration from the poses, false if there weren't any or they don't make sense
+bool imu_cal_solve(const imu_cal_run_t *run, imu_cal_t *cal) {
+    int axis, i;
+    imu_cal_identity(cal);
+    if (run->poses == 0) {
+        return false;
+    }
+    for (axis = 0; axis < 3; axis++) {
+        // the gyro reads 0 in every pose
+        int32_t sum = 0;
+        for (i = 0; i < run->poses; i++) {
+            sum += run->mean[i][3 + axis];
+        }
+        cal->gyro_bias[axis] = sum / run->poses;
+
+        // the accelerometer reads +1g, -1g or 0 depending on which way the axis points
+        int32_t hi = run->mean[0][axis];
+        int32_t lo = hi;
+        for (i = 1; i < run->poses; i++) {
+            if (run->mean[i][axis] > hi) {
+                hi = run->mean[i][axis];
+            }
+            if (run->mean[i][axis] < lo) {
+                lo = run->mean[i][axis];
+            }
+        }
+        if (hi > IMU_CAL_ONE_G / 2 && lo < -IMU_CAL_ONE_G / 2) {
+            // seen both ways up, the middle is the bias and the distance between them is 2g
+            cal->accel_bias[axis] = (hi + lo) / 2;
+            cal->accel_scale[axis] = ((int32_t)2 * IMU_CAL_ONE_G * IMU_CAL_SCALE_ONE) / (hi - lo);
+            if (cal->accel_scale[axis] < IMU_CAL_SCALE_ONE * 9 / 10 || cal->accel_scale[axis] > IMU_CAL_SCALE_ONE * 11 / 10) {
+                // the part is good to a few percent, this much means the poses were wrong
+                imu_cal_identity(cal);
+                return false;
+            }
+        } else {
+            // only one way, or level: take the reading it should have given off and assume the scale is right
+            sum = 0;
+            for (i = 0; i < run->poses; i++) {
+                int32_t m = run->mean[i][axis];
+                int32_t expect = m > IMU_CAL_ONE_G / 2 ? IMU_CAL_ONE_G : (m < -IMU_CAL_ONE_G / 2 ? -IMU_CAL_ONE_G : 0);
+                sum += m - expect;
+            }
+            cal->accel_bias[axis] = sum / run->poses;
+        }
+    }
+    return true;
+}
+
+// CRC-32 as in zlib, a bit at a time, it only ever sees one small record
+uint32_t imu_cal_crc32(const uint8_t *p, int n) {
+    uint32_t crc = 0xFFFFFFFF;
+    int i, k;
+    for (i = 0; i < n; i++) {
+        crc ^= p[i];
+        for (k = 0; k < 8; k++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
+
+static uint8_t *put16(uint8_t *p, uint16_t v) {
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+    return p + 2;
+}
+
+static uint8_t *put32(uint8_t *p, uint32_t v) {
+    p = put16(p, v & 0xFFFF);
+    return put16(p, v >> 16);
+}
+
+static uint16_t get16(const uint8_t *p) {
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t get32(const uint8_t *p) {
+    return get16(p) | ((uint32_t)get16(p + 2) << 16);
+}
+
+// IMU_CAL_RECORD_BYTES of record, ready for flash
+void imu_cal_pack(const imu_cal_t *cal, uint8_t *record) {
+    uint8_t *p = record;
+    int i;
+    p = put32(p, IMU_CAL_MAGIC);
+    p = put16(p, IMU_CAL_VERSION);
+    p = put16(p, IMU_CAL_RECORD_BYTES);
+    for (i = 0; i < 3; i++) {
+        p = put16(p, cal->accel_bias[i]);
+    }
+    for (i = 0; i < 3; i++) {
+        p = put16(p, cal->gyro_bias[i]);
+    }
+    for (i = 0; i < 3; i++) {
+        p = put32(p, cal->accel_scale[i]);
+    }
+    put32(p, imu_cal_crc32(record, IMU_CAL_RECORD_BYTES - 4));
+}
+
+// check a record read back from flash and fill in cal if it is good, returns IMU_CAL_OK or what is wrong.
+// cal is left alone if it isn't
+int imu_cal_unpack(const uint8_t *record, imu_cal_t *cal) {
+    const uint8_t *p = record + 8;
+    int i;
+    for (i = 0; i < IMU_CAL_RECORD_BYTES && record[i] == 0xFF; i++) {
+    }
+    if (i == IMU_CAL_RECORD_BYTES) {
+        return IMU_CAL_EMPTY;
+    }
+    if (get32(record) != IMU_CAL_MAGIC) {
+        return IMU_CAL_BAD_MAGIC;
+    }
+    if (get16(record + 4) != IMU_CAL_VERSION || get16(record + 6) != IMU_CAL_RECORD_BYTES) {
+        return IMU_CAL_BAD_VERSION;
+    }
+    if (get32(record + IMU_CAL_RECORD_BYTES - 4) != imu_cal_crc32(record, IMU_CAL_RECORD_BYTES - 4)) {
+        return IMU_CAL_BAD_CRC;
+    }
+    for (i = 0; i < 3; i++) {
+        cal->accel_bias[i] = (int16_t)get16(p + i * 2);
+        cal->gyro_bias[i] = (int16_t)get16(p + 6 + i * 2);
+        cal->accel_scale[i] = (int32_t)get32(p + 12 + i * 4);
+    }
+    return IMU_CAL_OK;
+}
@@ -0,0 +1,64 @@
+#ifndef IMUCAL_H__
+#define IMUCAL_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "imu.h"
+
+// MPU6050 calibration: biases and accelerometer scale factors worked out from the board
+// held still in one or more poses, and the record they are kept in in flash.
+// No pico calls in here, so it builds on the computer too (see sim/).
+//
+// Lying flat is enough for the gyro biases and the x and y accelerometer biases, z then
+// has to be assumed to read exactly 1g. Each axis that is also seen pointing the other
+// way, like the board turned upside down for z, gets its own bias and scale.
+
+#define IMU_CAL_ONE_G 16384 // accelerometer counts at +-2g
+#define IMU_CAL_SCALE_ONE (1 << 14) // scale factors are Q14
+#define IMU_CAL_MAX_POSES 6
+#define IMU_CAL_MAX_SPREAD 200 // counts a gyro axis may wander by while still, about 12 degrees/s
+
+// flash record: magic, version, size, the calibration, then a CRC-32 of everything before it.
+// all little endian, packed by imu_cal_pack() so it doesn't depend on the compiler's layout
+#define IMU_CAL_MAGIC 0x4C414349 // "ICAL"
+#define IMU_CAL_VERSION 1
+#define IMU_CAL_RECORD_BYTES 36
+
+// what imu_cal_unpack() found
+#define IMU_CAL_OK 0
+#define IMU_CAL_EMPTY 1 // erased flash, never saved
+#define IMU_CAL_BAD_MAGIC 2
+#define IMU_CAL_BAD_VERSION 3
+#define IMU_CAL_BAD_CRC 4
+
+typedef struct {
+    int16_t accel_bias[3]; // counts to take off x y z, at +-2g
+    int16_t gyro_bias[3]; // counts to take off x y z, at +-2000 degrees/s
+    int32_t accel_scale[3]; // Q14, multiply after taking off the bias to get 16384 counts a g
+} imu_cal_t;
+
+// samples of one pose, added up
+typedef struct {
+    int32_t sum[6]; // accel x y z, gyro x y z
+    int16_t min[3]; // gyro, to check the board stayed still
+    int16_t max[3];
+    int count;
+} imu_cal_pose_t;
+
+typedef struct {
+    imu_cal_pose_t pose; // the one being collected
+    int32_t mean[IMU_CAL_MAX_POSES][6]; // finished ones
+    int poses;
+} imu_cal_run_t;
+
+void imu_cal_identity(imu_cal_t *cal);
+void imu_cal_begin(imu_cal_run_t *run);
+void imu_cal_add(imu_cal_run_t *run, const imu_data_t *d);
+bool imu_cal_end_pose(imu_cal_run_t *run);
+bool imu_cal_solve(const imu_cal_run_t *run, imu_cal_t *cal);
+
+uint32_t imu_cal_crc32(const uint8_t *p, int n);
+void imu_cal_pack(const imu_cal_t *cal, uint8_t *record);
+int imu_cal_unpack(const uint8_t *record, imu_cal_t *cal);
+
+#endif
@@ -0,0 +1,66 @@
+#include "logbuf.h"
+#include <stdio.h>
+#include <stdarg.h>
+
+void logbuf_init(logbuf_t *l) {
+    l->head = 0;
+    l->tail = 0;
+    l->dropped = 0;
+    l->most = 0;
+}
+
+// bytes waiting to be sent
+int logbuf_count(logbuf_t *l) {
+    return l->head - l->tail;
+}
+
+// add a line, or count it as dropped if it doesn't all fit
+bool logbuf_printf(logbuf_t *l, const char *fmt, ...) {
+    char line[LOGBUF_LINE];
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+    if (n < 0) {
+        return false;
+    }
+    if (n >= (int)sizeof(line)) {
+        n = sizeof(line) - 1;
+        line[n - 1] = '\n'; // cut, but still a line
+    }
+    return logbuf_write(l, line, n);
+}
+
+// add n bytes, or count them as a dropped line if they don't all fit. for binary records too
+bool logbuf_write(logbuf_t *l, const void *data, int n) {
+    const char *p = data;
+    if (n > LOGBUF_SIZE - logbuf_count(l)) {
+        l->dropped++;
+        return false;
+    }
+    int i;
+    for (i = 0; i < n; i++) {
+        l->buf[(l->head + i) & (LOGBUF_SIZE - 1)] = p[i];
+    }
+    l->head += n;
+    if ((uint32_t)logbuf_count(l) > l->most) {
+        l->most = logbuf_count(l);
+    }
+    return true;
+}
+
+// the oldest bytes waiting, as many as are in one piece before the buffer wraps
+int logbuf_peek(logbuf_t *l, const char **p) {
+    uint32_t start = l->tail & (LOGBUF_SIZE - 1);
+    int n = logbuf_count(l);
+    if (n > LOGBUF_SIZE - (int)start) {
+        n = LOGBUF_SIZE - start;
+    }
+    *p = &l->buf[start];
+    return n;
+}
+
+// the first n bytes from logbuf_peek() have been sent
+void logbuf_consume(logbuf_t *l, int n) {
+    l->tail += n;
+}
@@ -0,0 +1,32 @@
+#ifndef LOGBUF_H__
+#define LOGBUF_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Lines for the serial log, queued so printing never waits on USB. logbuf_printf() formats
+// a line into the buffer, and the bytes are sent later with logbuf_peek() and logbuf_consume(),
+// only as many as USB can take right then. A line that doesn't fit is dropped whole, never cut.
+// logbuf_write() queues binary records the same way.
+// One writer and one reader on the same core. No pico calls in here, so it builds on the
+// computer too (see sim/).
+
+#define LOGBUF_SIZE 2048 // bytes, a power of 2
+#define LOGBUF_LINE 200 // longest line
+
+typedef struct {
+    char buf[LOGBUF_SIZE];
+    uint32_t head; // bytes written, wraps
+    uint32_t tail; // bytes sent
+    uint32_t dropped; // lines that didn't fit
+    uint32_t most; // most bytes ever waiting
+} logbuf_t;
+
+void logbuf_init(logbuf_t *l);
+int logbuf_count(logbuf_t *l);
+bool logbuf_printf(logbuf_t *l, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+bool logbuf_write(logbuf_t *l, const void *data, int n);
+int logbuf_peek(logbuf_t *l, const char **p);
+void logbuf_consume(logbuf_t *l, int n);
+
+#endif
@@ -0,0 +1,180 @@
+#include "mpu6050.h"
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+
+static i2c_inst_t *mpu6050_i2c;
+static int16_t mpu6050_accel_trim[3]; // factory accelerometer offsets, read at power up
+
+// FIFO mode: the data ready pulses are counted and timed, so each sample read out of the FIFO
+// gets the time the sensor took it, not the time it happened to be read
+static uint mpu6050_int_pin;
+static uint32_t mpu6050_period_us;
+static volatile uint32_t mpu6050_edges = 0; // data ready pulses since the FIFO was started or reset
+static volatile uint32_t mpu6050_edge_t = 0; // time_us_32() of the last one
+static uint32_t mpu6050_taken = 0; // samples read out of the FIFO, plus the ones lost to resets
+static uint8_t mpu6050_fifo[MPU6050_FIFO_SIZE];
+static mpu6050_fifo_stats_t mpu6050_stats;
+
+static void writeReg(uint8_t reg, uint8_t value) {
+    uint8_t buf[2] = {reg, value};
+    i2c_write_blocking(mpu6050_i2c, MPU6050_ADDRESS, buf, 2, false);
+}
+
+static void readRegs(uint8_t reg, uint8_t *buf, int len) {
+    i2c_write_blocking(mpu6050_i2c, MPU6050_ADDRESS, &reg, 1, true);  // true to keep master control of bus
+    i2c_read_blocking(mpu6050_i2c, MPU6050_ADDRESS, buf, len, false); // false - finished with bus
+}
+
+bool mpu6050_init(i2c_inst_t *i2c) {
+    uint8_t who_am_i = 0;
+    mpu6050_i2c = i2c;
+    readRegs(WHO_AM_I, &who_am_i, 1);
+    if (who_am_i != 0x68 && who_am_i != 0x98) {
+        return false;
+    }
+    // reset, so the offsets are the factory ones even if the pico restarted without the sensor
+    writeReg(PWR_MGMT_1, 0x80);
+    sleep_ms(100);
+    writeReg(PWR_MGMT_1, 0x00);
+    writeReg(ACCEL_CONFIG, 0x00);
+    writeReg(GYRO_CONFIG, 0x18);
+
+    uint8_t trim[6];
+    readRegs(XA_OFFS_H, trim, 6);
+    int i;
+    for (i = 0; i < 3; i++) {
+        mpu6050_accel_trim[i] = (int16_t)((trim[i * 2] << 8) | trim[i * 2 + 1]);
+    }
+    return true;
+}
+
+// the sensor takes the offsets off every sample itself, so a calibration costs nothing per sample.
+// accelerometer offsets are 2048 counts a g on top of the factory trim, bit 0 has to be left as it was.
+// gyro offsets are 32.8 counts a degree/s, twice the +-2000 degrees/s counts
+void mpu6050_set_offsets(const imu_cal_t *cal) {
+    uint8_t buf[7];
+    int i;
+    buf[0] = XA_OFFS_H;
+    for (i = 0; i < 3; i++) {
+        int16_t b = cal->accel_bias[i];
+        int16_t v = mpu6050_accel_trim[i] - (b >= 0 ? b + 4 : b - 4) / 8;
+        v = (v & ~1) | (mpu6050_accel_trim[i] & 1);
+        buf[1 + i * 2] = (uint16_t)v >> 8;
+        buf[2 + i * 2] = v & 0xFF;
+    }
+    i2c_write_blocking(mpu6050_i2c, MPU6050_ADDRESS, buf, 7, false);
+    buf[0] = XG_OFFS_USRH;
+    for (i = 0; i < 3; i++) {
+        int16_t v = -2 * cal->gyro_bias[i];
+        buf[1 + i * 2] = (uint16_t)v >> 8;
+        buf[2 + i * 2] = v & 0xFF;
+    }
+    i2c_write_blocking(mpu6050_i2c, MPU6050_ADDRESS, buf, 7, false);
+}
+
+// back to the factory offsets, to measure the biases again
+void mpu6050_clear_offsets() {
+    imu_cal_t none;
+    imu_cal_identity(&none);
+    mpu6050_set_offsets(&none);
+}
+
+// one sample straight from the data registers, whenever it is called
+void mpu6050_read_data(imu_data_t *data) {
+    uint8_t buffer[IMU_PACKET_BYTES];
+    readRegs(ACCEL_XOUT_H, buffer, IMU_PACKET_BYTES);
+    imu_unpack(buffer, data);
+}
+
+// data ready, a new sample just went into the FIFO
+static void mpu6050_irq(uint gpio, uint32_t events) {
+    if (gpio == mpu6050_int_pin) {
+        mpu6050_edge_t = time_us_32();
+        mpu6050_edges++;
+    }
+}
+
+// empty the FIFO and start counting samples from 0 again. lost is added to the count
+static void mpu6050_reset_fifo(uint32_t lost) {
+    writeReg(USER_CTRL, 0x04); // FIFO_RESET, FIFO off
+    writeReg(USER_CTRL, 0x40); // FIFO_EN
+    uint32_t save = save_and_disable_interrupts();
+    mpu6050_edges = 0;
+    restore_interrupts(save);
+    mpu6050_taken = 0;
+    mpu6050_stats.lost += lost;
+}
+
+// let the sensor take samples on its own clock at rate_hz (1000 down to 4) into its FIFO,
+// with the INT pin wired to int_pin. after this read them with mpu6050_drain_fifo(), often
+// enough that the 73 sample FIFO doesn't fill up, 73ms at 1kHz
+void mpu6050_start_fifo(int rate_hz, uint int_pin) {
+    if (rate_hz > 1000) {
+        rate_hz = 1000;
+    }
+    if (rate_hz < 4) {
+        rate_hz = 4;
+    }
+    int div = 1000 / rate_hz - 1;
+    mpu6050_period_us = 1000 * (div + 1);
+    mpu6050_int_pin = int_pin;
+
+    writeReg(CONFIG, 0x01); // 184Hz low pass, which makes the gyro rate 1kHz instead of 8kHz
+    writeReg(SMPLRT_DIV, div);
+    writeReg(INT_PIN_CFG, 0x00); // active high, push-pull, 50us pulse
+    writeReg(FIFO_EN, 0xF8); // temp, gyro xyz and accel, 14 bytes per sample in register order
+    writeReg(INT_ENABLE, 0x01); // DATA_RDY_EN
+
+    gpio_init(int_pin);
+    gpio_set_dir(int_pin, GPIO_IN);
+    gpio_set_irq_enabled_with_callback(int_pin, GPIO_IRQ_EDGE_RISE, true, &mpu6050_irq);
+
+    mpu6050_stats = (mpu6050_fifo_stats_t){0};
+    mpu6050_reset_fifo(0);
+}
+
+// read every whole sample in the FIFO in one transaction and add them to ring, with the
+// time each was taken. returns the samples read. the bus has to be free, ssd1306_wait() first
+int mpu6050_drain_fifo(imu_ring_t *ring) {
+    // take the pulse count before the FIFO count, any sample that lands in between
+    // is newer than the last pulse and gets counted forward from it
+    uint32_t save = save_and_disable_interrupts();
+    uint32_t edges = mpu6050_edges;
+    uint32_t edge_t = mpu6050_edge_t;
+    restore_interrupts(save);
+
+    uint8_t c[2];
+    readRegs(FIFO_COUNTH, c, 2);
+    int count = (c[0] << 8) | c[1];
+    mpu6050_stats.drains++;
+    if (count >= MPU6050_FIFO_SIZE) {
+        // full, the sensor may have written over the oldest bytes and the packets are out of line.
+        // everything it took since the last drain is gone
+        uint32_t lost = edges - mpu6050_taken;
+        mpu6050_stats.overflows++;
+        imu_ring_skip(ring, lost);
+        mpu6050_reset_fifo(lost);
+        return 0;
+    }
+
+    int packets = count / IMU_PACKET_BYTES; // a sample still being written is left for next time
+    if (packets == 0) {
+        return 0;
+    }
+    if (packets > (int)mpu6050_stats.most) {
+        mpu6050_stats.most = packets;
+    }
+    readRegs(FIFO_R_W, mpu6050_fifo, packets * IMU_PACKET_BYTES);
+
+    // sample number edges-1 was taken at edge_t, the newest one read is number taken+packets-1
+    int32_t ahead = (int32_t)(mpu6050_taken + packets - edges);
+    uint32_t newest_t = edge_t + ahead * (int32_t)mpu6050_period_us;
+    mpu6050_taken += packets;
+    mpu6050_stats.samples += packets;
+    imu_ring_push_packets(ring, mpu6050_fifo, packets, newest_t, mpu6050_period_us);
+    return packets;
+}
+
+const mpu6050_fifo_stats_t *mpu6050_fifo_stats() {
+    return &mpu6050_stats;
+}
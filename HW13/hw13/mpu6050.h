@@ -0,0 +1,65 @@
+#ifndef MPU6050_H__
+#define MPU6050_H__
+
+#include "hardware/i2c.h"
+#include "imu.h"
+#include "imucal.h"
+
+// MPU6050 I2C address
+#define MPU6050_ADDRESS 0x68
+
+// MPU6050 config registers
+#define XA_OFFS_H 0x06 // accelerometer offsets, 3 x 16 bits, not in the register map document
+#define XG_OFFS_USRH 0x13 // gyro offsets, 3 x 16 bits
+#define SMPLRT_DIV 0x19
+#define CONFIG 0x1A
+#define GYRO_CONFIG 0x1B
+#define ACCEL_CONFIG 0x1C
+#define FIFO_EN 0x23
+#define INT_PIN_CFG 0x37
+#define INT_ENABLE 0x38
+#define INT_STATUS 0x3A
+#define USER_CTRL 0x6A
+#define PWR_MGMT_1 0x6B
+#define PWR_MGMT_2 0x6C
+#define FIFO_COUNTH 0x72
+#define FIFO_COUNTL 0x73
+#define FIFO_R_W 0x74
+
+// MPU6050 sensor data registers
+#define ACCEL_XOUT_H 0x3B
+#define ACCEL_XOUT_L 0x3C
+#define ACCEL_YOUT_H 0x3D
+#define ACCEL_YOUT_L 0x3E
+#define ACCEL_ZOUT_H 0x3F
+#define ACCEL_ZOUT_L 0x40
+#define TEMP_OUT_H   0x41
+#define TEMP_OUT_L   0x42
+#define GYRO_XOUT_H  0x43
+#define GYRO_XOUT_L  0x44
+#define GYRO_YOUT_H  0x45
+#define GYRO_YOUT_L  0x46
+#define GYRO_ZOUT_H  0x47
+#define GYRO_ZOUT_L  0x48
+#define WHO_AM_I     0x75
+
+#define MPU6050_FIFO_SIZE 1024 // bytes, 73 samples
+
+// what mpu6050_drain_fifo() has seen since mpu6050_start_fifo()
+typedef struct {
+    uint32_t drains; // times the FIFO was read
+    uint32_t samples; // samples read out of the FIFO
+    uint32_t overflows; // times the FIFO filled up and had to be reset
+    uint32_t lost; // samples thrown away by those resets
+    uint32_t most; // most samples waiting at one drain
+} mpu6050_fifo_stats_t;
+
+bool mpu6050_init(i2c_inst_t *i2c);
+void mpu6050_read_data(imu_data_t *data);
+void mpu6050_set_offsets(const imu_cal_t *cal);
+void mpu6050_clear_offsets(void);
+void mpu6050_start_fifo(int rate_hz, uint int_pin);
+int mpu6050_drain_fifo(imu_ring_t *ring);
+const mpu6050_fifo_stats_t *mpu6050_fifo_stats(void);
+
+#endif
@@ -0,0 +1,94 @@
+# reads the binary IMU telemetry hw13 sends after a t, see telemetry.h, and writes it as CSV
+# the same columns as sim/fifo_replay, so sim/attitude_replay can run the filter on it
+#
+# python3 read_telemetry.py COM4 samples.csv 10     10 seconds from the board
+# python3 read_telemetry.py stream.bin > samples.csv  bytes saved earlier, or from sim/telem_check --write
+#
+# python3 -m pip install pyserial
+
+import binascii
+import os
+import struct
+import sys
+import time
+
+RECORD = struct.Struct('<II7hH')
+
+def cobs_decode(data):
+    # None if it isn't COBS
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        i += 1
+        if code == 0 or i + code - 1 > len(data):
+            return None
+        out += data[i:i+code-1]
+        i += code - 1
+        if code != 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+def decode(frame):
+    # (seq, t, ax, ay, az, temp, gx, gy, gz) or None if the frame is bad
+    record = cobs_decode(frame)
+    if record is None or len(record) != RECORD.size:
+        return None
+    fields = RECORD.unpack(record)
+    if binascii.crc_hqx(record[:-2], 0xFFFF) != fields[-1]:
+        return None
+    return fields[:-1]
+
+class Reader:
+    # collects bytes into frames on the 0s, counts what was thrown away and the gaps in seq
+    def __init__(self):
+        self.pending = bytearray()
+        self.bad = 0
+        self.lost = 0
+        self.next_seq = None
+
+    def feed(self, data):
+        self.pending += data
+        *frames, self.pending = self.pending.split(b'\0')
+        samples = []
+        for frame in frames:
+            sample = decode(bytes(frame))
+            if sample is None:
+                self.bad += 1
+                continue
+            if self.next_seq is not None and sample[0] != self.next_seq:
+                self.lost += (sample[0] - self.next_seq) & 0xFFFFFFFF
+            self.next_seq = (sample[0] + 1) & 0xFFFFFFFF
+            samples.append(sample)
+        return samples
+
+def write_csv(out, samples):
+    for s in samples:
+        out.write('%d,%d,%d,%d,%d,%d,%d,%d,%d\n' % s)
+
+if __name__ == '__main__':
+    source = sys.argv[1] if len(sys.argv) > 1 else 'COM4' # a port, or a file of saved bytes
+    out = open(sys.argv[2], 'w') if len(sys.argv) > 2 else sys.stdout
+    seconds = float(sys.argv[3]) if len(sys.argv) > 3 else 10
+    reader = Reader()
+    count = 0
+    out.write('seq,t,ax,ay,az,temp,gx,gy,gz\n')
+    if os.path.isfile(source):
+        with open(source, 'rb') as f:
+            samples = reader.feed(f.read())
+            write_csv(out, samples)
+            count += len(samples)
+    else:
+        import serial
+        ser = serial.Serial(source, timeout=0.1)
+        ser.reset_input_buffer()
+        ser.write(b't')
+        # whatever was on its way before the t is thrown away at the first 0
+        end = time.time() + seconds
+        while time.time() < end:
+            samples = reader.feed(ser.read(4096))
+            write_csv(out, samples)
+            count += len(samples)
+        ser.write(b'l')
+        ser.close()
+    sys.stderr.write('%d samples, %d lost, %d bad frames\n' % (count, reader.lost, reader.bad))
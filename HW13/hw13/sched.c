@@ -0,0 +1,88 @@
+#include "sched.h"
+
+void sched_init(sched_t *s, uint32_t (*clock)(void)) {
+    s->count = 0;
+    s->clock = clock;
+}
+
+// run every period_us, first offset_us from now. offsets keep jobs with the same period from
+// always landing together. returns the job's number, or -1 if there are already SCHED_MAX_TASKS
+int sched_add(sched_t *s, const char *name, uint32_t period_us, uint32_t offset_us, void (*run)(void *arg), void *arg) {
+    if (s->count == SCHED_MAX_TASKS) {
+        return -1;
+    }
+    sched_task_t *t = &s->tasks[s->count];
+    t->name = name;
+    t->run = run;
+    t->arg = arg;
+    t->period_us = period_us;
+    t->due = s->clock() + offset_us;
+    t->runs = 0;
+    t->skipped = 0;
+    t->late_max = 0;
+    t->took_max = 0;
+    return s->count++;
+}
+
+// run the job that has been due longest, if any are. returns its number, or -1 if nothing was due
+int sched_poll(sched_t *s) {
+    uint32_t now = s->clock();
+    int best = -1;
+    int32_t most = -1;
+    int i;
+    for (i = 0; i < s->count; i++) {
+        int32_t late = (int32_t)(now - s->tasks[i].due);
+        if (late > most) {
+            most = late;
+            best = i;
+        }
+    }
+    if (best < 0) {
+        return -1;
+    }
+
+    sched_task_t *t = &s->tasks[best];
+    if ((uint32_t)most > t->late_max) {
+        t->late_max = most;
+    }
+    t->run(t->arg);
+    uint32_t end = s->clock();
+    if (end - now > t->took_max) {
+        t->took_max = end - now;
+    }
+    t->runs++;
+
+    // next period, or later if it has fallen a whole period or more behind
+    t->due += t->period_us;
+    int32_t behind = (int32_t)(end - t->due);
+    if (behind >= 0) {
+        uint32_t missed = behind / t->period_us + 1;
+        t->skipped += missed;
+        t->due += missed * t->period_us;
+    }
+    return best;
+}
+
+// us until the next job is due, 0 if one already is
+uint32_t sched_idle_us(sched_t *s) {
+    uint32_t now = s->clock();
+    int32_t idle = INT32_MAX;
+    int i;
+    for (i = 0; i < s->count; i++) {
+        int32_t until = (int32_t)(s->tasks[i].due - now);
+        if (until < idle) {
+            idle = until;
+        }
+    }
+    return idle > 0 ? idle : 0;
+}
+
+void sched_reset_stats(sched_t *s) {
+    int i;
+    for (i = 0; i < s->count; i++) {
+        s->tasks[i].runs = 0;
+        s->tasks[i].skipped = 0;
+        s->tasks[i].late_max = 0;
+        s->tasks[i].took_max = 0;
+    }
+}
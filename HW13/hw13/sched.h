@@ -0,0 +1,38 @@
+#ifndef SCHED_H__
+#define SCHED_H__
+
+#include <stdint.h>
+
+// A few jobs that each need doing every so often, run one at a time from the main loop.
+// Each job is due at a fixed period from when it was added, not from when it last ran,
+// so a late run doesn't push the rest back. When more than one is due the one that was
+// due first goes first. A job that gets a whole period behind skips the runs it missed.
+// No pico calls in here, the clock is passed in, so it builds on the computer too (see sim/).
+
+#define SCHED_MAX_TASKS 8
+
+typedef struct {
+    const char *name;
+    void (*run)(void *arg);
+    void *arg;
+    uint32_t period_us;
+    uint32_t due; // clock time it should next start
+    uint32_t runs;
+    uint32_t skipped; // runs missed because it was a whole period late
+    uint32_t late_max; // longest from due to starting, us
+    uint32_t took_max; // longest run, us
+} sched_task_t;
+
+typedef struct {
+    sched_task_t tasks[SCHED_MAX_TASKS];
+    int count;
+    uint32_t (*clock)(void); // us, time_us_32() on the pico
+} sched_t;
+
+void sched_init(sched_t *s, uint32_t (*clock)(void));
+int sched_add(sched_t *s, const char *name, uint32_t period_us, uint32_t offset_us, void (*run)(void *arg), void *arg);
+int sched_poll(sched_t *s);
+uint32_t sched_idle_us(sched_t *s);
+void sched_reset_stats(sched_t *s);
+
+#endif
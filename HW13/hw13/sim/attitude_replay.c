@@ -0,0 +1,262 @@
+// Runs the fixed point attitude filter and the float one side by side on an IMU log,
+// and says how far apart they get and how long each update takes on this computer.
+//
+//   attitude_replay --synthetic 20000
+//   fifo_replay --synthetic 20000 | attitude_replay
+//   attitude_replay samples.csv --shift 9 --print
+//
+// The log is the CSV from fifo_replay: seq,t,ax,ay,az,temp,gx,gy,gz, raw counts.
+// It can have two more columns, the true roll and pitch in degrees, and then both filters are
+// checked against those too. --synthetic n makes n samples at 1kHz with the true angles known.
+// The sample period comes from the first two timestamps.
+// --print writes seq, then roll and pitch in degrees from both filters, for every sample.
+//
+// Checks that the fixed point filter stays within --max-deg (0.05) of the float one on every
+// sample and within --rms-deg (0.02) over the log, and with true angles, that neither filter
+// is more than --truth-deg (0.2) off and the fixed one is no more than --max-deg worse.
+// The times are this computer's, only the ratio says much about the RP2040 (see ATT_BENCH in hw13.c).
+// Exits with 1 if anything was wrong.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "attitude.h"
+
+#define MAX_SAMPLES 1000000
+#define RAD_TO_DEG 57.29577951308232
+
+static imu_data_t samples[MAX_SAMPLES];
+static uint32_t seqs[MAX_SAMPLES];
+static double trueRoll[MAX_SAMPLES]; // degrees
+static double truePitch[MAX_SAMPLES];
+static volatile int32_t sink; // so the compiler can't drop the timed work
+static volatile float sinkf;
+
+static double nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int failed = 0;
+
+static void check(int ok, const char *what) {
+    fprintf(stderr, "%s %s\n", ok ? "ok  " : "FAIL", what);
+    if (!ok) {
+        failed = 1;
+    }
+}
+
+// the board rocking in roll and pitch at 1kHz, 16384 counts per g and 16.4 per degree/s,
+// the gyro giving the angles' own rates, with a few counts of noise on everything
+static int makeSamples(int n) {
+    uint32_t noise = 1;
+    int i, k;
+    for (i = 0; i < n; i++) {
+        double roll = 0.3 * sin(i * 0.003);
+        double pitch = 0.5 * sin(i * 0.002);
+        int v[7];
+        v[0] = (int)(-16384 * sin(pitch));
+        v[1] = (int)(16384 * sin(roll) * cos(pitch));
+        v[2] = (int)(16384 * cos(roll) * cos(pitch));
+        v[3] = -3920; // 25C
+        v[4] = (int)(16.4 * RAD_TO_DEG * 0.9 * cos(i * 0.003));
+        v[5] = (int)(16.4 * RAD_TO_DEG * 1.0 * cos(i * 0.002));
+        v[6] = 20;
+        for (k = 0; k < 7; k++) {
+            noise = noise * 1664525 + 1013904223;
+            v[k] += (int)(noise >> 29) - 4;
+        }
+        seqs[i] = i;
+        samples[i].accel_x = v[0];
+        samples[i].accel_y = v[1];
+        samples[i].accel_z = v[2];
+        samples[i].temp = v[3];
+        samples[i].gyro_x = v[4];
+        samples[i].gyro_y = v[5];
+        samples[i].gyro_z = v[6];
+        trueRoll[i] = roll * RAD_TO_DEG;
+        truePitch[i] = pitch * RAD_TO_DEG;
+    }
+    return n;
+}
+
+// the CSV from fifo_replay, maybe with the true angles on the end. 0 if it's no good
+static int readSamples(FILE *in, int *truth, uint32_t *period) {
+    char line[256];
+    int n = 0;
+    uint32_t t0 = 0, t1 = 0;
+    while (n < MAX_SAMPLES && fgets(line, sizeof(line), in)) {
+        unsigned seq, t;
+        int v[7];
+        int got = sscanf(line, "%u,%u,%d,%d,%d,%d,%d,%d,%d,%lf,%lf", &seq, &t, &v[0], &v[1], &v[2], &v[3], &v[4],
+            &v[5], &v[6], &trueRoll[n], &truePitch[n]);
+        if (got != 9 && got != 11) {
+            continue; // the header
+        }
+        if (n == 0) {
+            *truth = got == 11;
+            t0 = t;
+        } else if (*truth != (got == 11)) {
+            fprintf(stderr, "sample %d has the true angles and the first one didn't, or the other way round\n", n);
+            return 0;
+        }
+        if (n == 1) {
+            t1 = t;
+        }
+        seqs[n] = seq;
+        samples[n].accel_x = v[0];
+        samples[n].accel_y = v[1];
+        samples[n].accel_z = v[2];
+        samples[n].temp = v[3];
+        samples[n].gyro_x = v[4];
+        samples[n].gyro_y = v[5];
+        samples[n].gyro_z = v[6];
+        n++;
+    }
+    if (n < 2 || t1 == t0) {
+        fprintf(stderr, "need at least 2 samples with different times\n");
+        return 0;
+    }
+    *period = (t1 - t0) / (seqs[1] - seqs[0]);
+    return n;
+}
+
+// keeps the biggest and the sum of squares
+static void track(double *max, double *sum, double d) {
+    d = fabs(d);
+    *max = d > *max ? d : *max;
+    *sum += d * d;
+}
+
+static void usage() {
+    fprintf(stderr, "attitude_replay [samples.csv | --synthetic n] [--shift n] [--print] [--repeat n]\n"
+        "    [--max-deg x] [--rms-deg x] [--truth-deg x]\n");
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    const char *file = NULL;
+    int shift = 9;
+    int print = 0;
+    int repeat = 20;
+    int synthetic = 0;
+    double maxDeg = 0.05, rmsDeg = 0.02, truthDeg = 0.2;
+    int i, r;
+
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--shift") && i + 1 < argc) {
+            shift = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--repeat") && i + 1 < argc) {
+            repeat = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--synthetic") && i + 1 < argc) {
+            synthetic = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--max-deg") && i + 1 < argc) {
+            maxDeg = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--rms-deg") && i + 1 < argc) {
+            rmsDeg = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--truth-deg") && i + 1 < argc) {
+            truthDeg = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--print")) {
+            print = 1;
+        } else if (argv[i][0] != '-') {
+            file = argv[i];
+        } else {
+            usage();
+        }
+    }
+    if (shift < 0 || shift > 16 || repeat < 1 || synthetic < 0 || synthetic > MAX_SAMPLES || (synthetic && file)) {
+        usage();
+    }
+
+    int n;
+    int truth = 0; // the log has the true angles
+    uint32_t period = 1000;
+    if (synthetic) {
+        n = makeSamples(synthetic);
+        truth = 1;
+    } else {
+        FILE *in = file ? fopen(file, "r") : stdin;
+        if (!in) {
+            perror(file);
+            return 1;
+        }
+        n = readSamples(in, &truth, &period);
+        if (file) {
+            fclose(in);
+        }
+        if (!n) {
+            return 1;
+        }
+    }
+
+    // how far apart the two filters are, and from the true angles
+    attitude_t fx;
+    attitude_float_t fl;
+    attitude_init(&fx, period, shift);
+    attitude_float_init(&fl, period, shift);
+    double maxRoll = 0, maxPitch = 0, sumRoll = 0, sumPitch = 0;
+    double maxFixed = 0, maxFloat = 0, sumFixed = 0, sumFloat = 0;
+    for (i = 0; i < n; i++) {
+        attitude_update(&fx, &samples[i]);
+        attitude_float_update(&fl, &samples[i]);
+        double roll = (double)fx.roll / ATT_ONE * RAD_TO_DEG;
+        double pitch = (double)fx.pitch / ATT_ONE * RAD_TO_DEG;
+        double flRoll = fl.roll * RAD_TO_DEG;
+        double flPitch = fl.pitch * RAD_TO_DEG;
+        track(&maxRoll, &sumRoll, remainder(roll - flRoll, 360));
+        track(&maxPitch, &sumPitch, pitch - flPitch);
+        if (truth) {
+            track(&maxFixed, &sumFixed, remainder(roll - trueRoll[i], 360));
+            track(&maxFixed, &sumFixed, pitch - truePitch[i]);
+            track(&maxFloat, &sumFloat, remainder(flRoll - trueRoll[i], 360));
+            track(&maxFloat, &sumFloat, flPitch - truePitch[i]);
+        }
+        if (print) {
+            printf("%u,%.3f,%.3f,%.3f,%.3f\n", seqs[i], roll, pitch, flRoll, flPitch);
+        }
+    }
+
+    // time each one over the whole log a few times
+    double start = nowNs();
+    for (r = 0; r < repeat; r++) {
+        attitude_init(&fx, period, shift);
+        for (i = 0; i < n; i++) {
+            attitude_update(&fx, &samples[i]);
+            sink = fx.roll;
+        }
+    }
+    double fixedNs = (nowNs() - start) / ((double)n * repeat);
+    start = nowNs();
+    for (r = 0; r < repeat; r++) {
+        attitude_float_init(&fl, period, shift);
+        for (i = 0; i < n; i++) {
+            attitude_float_update(&fl, &samples[i]);
+            sinkf = fl.roll;
+        }
+    }
+    double floatNs = (nowNs() - start) / ((double)n * repeat);
+
+    char what[128];
+    fprintf(stderr, "     %d samples at %u us, shift %d%s\n", n, period, shift, truth ? ", true angles known" : "");
+    fprintf(stderr, "     fixed - float, degrees: roll max %.4f rms %.4f, pitch max %.4f rms %.4f\n",
+        maxRoll, sqrt(sumRoll / n), maxPitch, sqrt(sumPitch / n));
+    snprintf(what, sizeof(what), "fixed point within %.3f degrees of float on every sample", maxDeg);
+    check(maxRoll <= maxDeg && maxPitch <= maxDeg, what);
+    snprintf(what, sizeof(what), "fixed point within %.3f degrees of float rms", rmsDeg);
+    check(sqrt(sumRoll / n) <= rmsDeg && sqrt(sumPitch / n) <= rmsDeg, what);
+    if (truth) {
+        fprintf(stderr, "     off the true angles, degrees: fixed max %.4f rms %.4f, float max %.4f rms %.4f\n",
+            maxFixed, sqrt(sumFixed / (2 * n)), maxFloat, sqrt(sumFloat / (2 * n)));
+        snprintf(what, sizeof(what), "both filters within %.3f degrees of the true angles", truthDeg);
+        check(maxFixed <= truthDeg && maxFloat <= truthDeg, what);
+        snprintf(what, sizeof(what), "fixed point no more than %.3f degrees further off than float", maxDeg);
+        check(maxFixed <= maxFloat + maxDeg, what);
+    }
+    fprintf(stderr, "     host timing, not the RP2040's: fixed point takes %.2f times as long as float "
+        "(%.1f and %.1f ns per update)\n", fixedNs / floatNs, fixedNs, floatNs);
+    return failed;
+}
@@ -0,0 +1,147 @@
+// Checks the IMU calibration code on the computer: the flash record and the pose solver.
+//
+//   cal_check
+//
+// - records round trip, and erased flash, a changed version or any one flipped bit is caught
+// - made up poses from a sensor with known biases and scales give them back
+// - a pose where the board moved is thrown away
+//
+// Prints what it checked and exits with 1 if anything was wrong.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "imucal.h"
+
+static int failed = 0;
+
+static void check(int ok, const char *what) {
+    printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+    if (!ok) {
+        failed = 1;
+    }
+}
+
+static uint32_t noise = 1;
+
+static int16_t jitter(int v, int amount) {
+    noise = noise * 1664525 + 1013904223;
+    return v + (int)((noise >> 16) % (2 * amount + 1)) - amount;
+}
+
+// a second of samples from a still sensor with gravity g (counts, along x y z),
+// these biases and scales, and shake added to the gyro
+static void addPose(imu_cal_run_t *run, const int g[3], const int bias[6], const float scale[3], int shake) {
+    int i;
+    for (i = 0; i < 1000; i++) {
+        imu_data_t d;
+        d.accel_x = jitter(g[0] * scale[0] + bias[0], 30);
+        d.accel_y = jitter(g[1] * scale[1] + bias[1], 30);
+        d.accel_z = jitter(g[2] * scale[2] + bias[2], 30);
+        d.temp = 0;
+        d.gyro_x = jitter(bias[3], 3 + shake);
+        d.gyro_y = jitter(bias[4], 3);
+        d.gyro_z = jitter(bias[5], 3);
+        imu_cal_add(run, &d);
+    }
+}
+
+static int near(int a, int b, int slack) {
+    return abs(a - b) <= slack;
+}
+
+static void checkRecords() {
+    imu_cal_t cal, back;
+    uint8_t rec[IMU_CAL_RECORD_BYTES];
+    int i, bit, r;
+
+    for (r = 0; r < 100; r++) {
+        for (i = 0; i < 3; i++) {
+            cal.accel_bias[i] = jitter(0, 2000);
+            cal.gyro_bias[i] = jitter(0, 200);
+            cal.accel_scale[i] = jitter(IMU_CAL_SCALE_ONE, 800);
+        }
+        imu_cal_pack(&cal, rec);
+        if (imu_cal_unpack(rec, &back) != IMU_CAL_OK || memcmp(&cal, &back, sizeof(cal))) {
+            break;
+        }
+    }
+    check(r == 100, "records round trip");
+
+    int caught = 1;
+    for (bit = 0; bit < IMU_CAL_RECORD_BYTES * 8; bit++) {
+        imu_cal_pack(&cal, rec);
+        rec[bit / 8] ^= 1 << (bit % 8);
+        back = cal;
+        if (imu_cal_unpack(rec, &back) == IMU_CAL_OK || memcmp(&cal, &back, sizeof(cal))) {
+            caught = 0;
+        }
+    }
+    check(caught, "every single bit flip is caught and leaves cal alone");
+
+    memset(rec, 0xFF, sizeof(rec));
+    check(imu_cal_unpack(rec, &back) == IMU_CAL_EMPTY, "erased flash is empty");
+
+    imu_cal_pack(&cal, rec);
+    rec[4]++;
+    check(imu_cal_unpack(rec, &back) == IMU_CAL_BAD_VERSION, "another version is refused");
+
+    imu_cal_pack(&cal, rec);
+    printf("     record:");
+    for (i = 0; i < IMU_CAL_RECORD_BYTES; i++) {
+        printf(" %02x", rec[i]);
+    }
+    printf("\n");
+}
+
+static void checkSolver() {
+    const int bias[6] = {-320, 410, 700, 25, -40, 12};
+    const float scale[3] = {1.02f, 0.98f, 1.03f};
+    const int flat[3] = {0, 0, IMU_CAL_ONE_G};
+    const int over[3] = {0, 0, -IMU_CAL_ONE_G};
+    const int faces[4][3] = {{IMU_CAL_ONE_G, 0, 0}, {-IMU_CAL_ONE_G, 0, 0}, {0, IMU_CAL_ONE_G, 0}, {0, -IMU_CAL_ONE_G, 0}};
+    imu_cal_run_t run;
+    imu_cal_t cal;
+    int i, ok;
+
+    // flat only: z has to be taken as exactly 1g
+    imu_cal_begin(&run);
+    addPose(&run, flat, bias, scale, 0);
+    ok = imu_cal_end_pose(&run) && imu_cal_solve(&run, &cal);
+    ok = ok && near(cal.accel_bias[0], bias[0], 5) && near(cal.accel_bias[1], bias[1], 5);
+    ok = ok && near(cal.accel_bias[2], bias[2] + (scale[2] - 1) * IMU_CAL_ONE_G, 5);
+    for (i = 0; i < 3; i++) {
+        ok = ok && near(cal.gyro_bias[i], bias[3 + i], 1) && cal.accel_scale[i] == IMU_CAL_SCALE_ONE;
+    }
+    check(ok, "flat: gyro and x y biases");
+
+    // and upside down: z bias and scale
+    addPose(&run, over, bias, scale, 0);
+    ok = imu_cal_end_pose(&run) && imu_cal_solve(&run, &cal);
+    ok = ok && near(cal.accel_bias[2], bias[2], 5) && near(cal.accel_scale[2], IMU_CAL_SCALE_ONE / scale[2], 5);
+    check(ok, "flat and upside down: z bias and scale");
+
+    // all six faces: every bias and scale
+    for (i = 0; i < 4; i++) {
+        addPose(&run, faces[i], bias, scale, 0);
+        imu_cal_end_pose(&run);
+    }
+    ok = run.poses == 6 && imu_cal_solve(&run, &cal);
+    for (i = 0; i < 3; i++) {
+        ok = ok && near(cal.accel_bias[i], bias[i], 5) && near(cal.accel_scale[i], IMU_CAL_SCALE_ONE / scale[i], 5);
+        ok = ok && near(cal.gyro_bias[i], bias[3 + i], 1);
+    }
+    check(ok, "six faces: every bias and scale");
+
+    // moved
+    imu_cal_begin(&run);
+    addPose(&run, flat, bias, scale, IMU_CAL_MAX_SPREAD);
+    check(!imu_cal_end_pose(&run) && run.poses == 0 && !imu_cal_solve(&run, &cal), "a pose that moved is thrown away");
+}
+
+int main() {
+    checkRecords();
+    checkSolver();
+    return failed;
+}
@@ -0,0 +1,178 @@
+// Runs the MPU6050 FIFO parsing and the sample ring on the computer, no sensor needed.
+//
+//   fifo_replay fifo.bin               bytes read from FIFO_R_W, back to back
+//   fifo_replay --synthetic 5000       5 seconds of made up 1kHz samples
+//   ... --burst n                      at most n samples per drain, like FIFO_COUNT would give (default 10)
+//   ... --read n                       samples the reader takes per drain, less than burst fills the ring
+//
+// Prints one CSV line per sample the reader got, then the samples dropped by the ring
+// and any gaps or timestamps that don't follow on. Every sample read is checked against
+// the one that went in with its seq, made up or read from the file with its own decoding.
+// Exits with 2 if a sample was lost other than by the ring, a time is wrong or a value differs.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "imu.h"
+
+#define PERIOD_US 1000
+#define MAX_SAMPLES 1000000
+
+static uint8_t bytes[MAX_SAMPLES * IMU_PACKET_BYTES];
+static imu_data_t sent[MAX_SAMPLES]; // what sample seq should come out as
+static imu_ring_t ring;
+
+// high byte first, like the sensor
+static void put16(uint8_t *p, int16_t v) {
+    p[0] = (uint16_t)v >> 8;
+    p[1] = v & 0xFF;
+}
+
+// a board being tilted back and forth, turning slowly, with a little noise
+static void makeSamples(int n) {
+    static uint32_t noise = 1;
+    int i, k;
+    for (i = 0; i < n; i++) {
+        float pitch = 0.5f * sinf(i * 0.002f);
+        float roll = 0.3f * sinf(i * 0.003f);
+        int16_t v[7];
+        // gravity seen by the board, 16384 counts per g
+        v[0] = (int16_t)(-16384 * sinf(pitch));
+        v[1] = (int16_t)(16384 * sinf(roll) * cosf(pitch));
+        v[2] = (int16_t)(16384 * cosf(roll) * cosf(pitch));
+        v[3] = -3920; // 25C
+        // the turn rates in rad/s, as 16.4 counts per degree/s
+        v[4] = (int16_t)(16.4f * 57.3f * 0.9f * cosf(i * 0.003f));
+        v[5] = (int16_t)(16.4f * 57.3f * cosf(i * 0.002f));
+        v[6] = 20;
+        for (k = 0; k < 7; k++) {
+            noise = noise * 1664525 + 1013904223;
+            v[k] = v[k] + (int)(noise >> 29) - 4;
+            put16(bytes + i * IMU_PACKET_BYTES + k * 2, v[k]);
+        }
+        sent[i].accel_x = v[0];
+        sent[i].accel_y = v[1];
+        sent[i].accel_z = v[2];
+        sent[i].temp = v[3];
+        sent[i].gyro_x = v[4];
+        sent[i].gyro_y = v[5];
+        sent[i].gyro_z = v[6];
+    }
+}
+
+// the samples in a file, a field at a time by offset rather than with imu_unpack()
+static void fileSamples(int n) {
+    int i;
+    for (i = 0; i < n; i++) {
+        const uint8_t *p = bytes + i * IMU_PACKET_BYTES;
+        int16_t *field[7] = {&sent[i].accel_x, &sent[i].accel_y, &sent[i].accel_z, &sent[i].temp,
+            &sent[i].gyro_x, &sent[i].gyro_y, &sent[i].gyro_z};
+        int k;
+        for (k = 0; k < 7; k++) {
+            *field[k] = (int16_t)(p[2 * k] * 256 + p[2 * k + 1]);
+        }
+    }
+}
+
+static int sameData(const imu_data_t *a, const imu_data_t *b) {
+    return a->accel_x == b->accel_x && a->accel_y == b->accel_y && a->accel_z == b->accel_z && a->temp == b->temp
+        && a->gyro_x == b->gyro_x && a->gyro_y == b->gyro_y && a->gyro_z == b->gyro_z;
+}
+
+static void usage() {
+    fprintf(stderr, "fifo_replay fifo.bin | --synthetic n [--burst n] [--read n]\n");
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    const char *file = NULL;
+    int synthetic = 0;
+    int burst = 10;
+    int perRead = 1 << 30;
+    int total = 0;
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--synthetic") && i + 1 < argc) {
+            synthetic = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--burst") && i + 1 < argc) {
+            burst = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--read") && i + 1 < argc) {
+            perRead = atoi(argv[++i]);
+        } else if (argv[i][0] != '-') {
+            file = argv[i];
+        } else {
+            usage();
+        }
+    }
+    if ((!file && !synthetic) || burst < 1 || perRead < 1) {
+        usage();
+    }
+
+    if (synthetic) {
+        total = synthetic < MAX_SAMPLES ? synthetic : MAX_SAMPLES;
+        makeSamples(total);
+    } else {
+        FILE *in = fopen(file, "rb");
+        if (!in) {
+            perror(file);
+            return 1;
+        }
+        size_t n = fread(bytes, 1, sizeof(bytes), in);
+        fclose(in);
+        total = n / IMU_PACKET_BYTES;
+        if (n % IMU_PACKET_BYTES) {
+            fprintf(stderr, "%d bytes left over after the last whole sample\n", (int)(n % IMU_PACKET_BYTES));
+        }
+        fileSamples(total);
+    }
+
+    imu_ring_init(&ring);
+    printf("seq,t,ax,ay,az,temp,gx,gy,gz\n");
+    uint32_t t = 0; // time of the newest sample the sensor has taken
+    uint32_t nextSeq = 0;
+    uint32_t lastT = 0;
+    int gaps = 0, badTimes = 0, badValues = 0, got = 0;
+    int done = 0;
+    uint32_t noise = 7;
+    while (done < total || imu_ring_count(&ring)) {
+        // a drain: however many whole samples the FIFO had
+        noise = noise * 1664525 + 1013904223;
+        int n = 1 + (noise >> 16) % burst;
+        if (n > total - done) {
+            n = total - done;
+        }
+        if (n > 0) {
+            t = t + n * PERIOD_US;
+            imu_ring_push_packets(&ring, bytes + done * IMU_PACKET_BYTES, n, t, PERIOD_US);
+            done = done + n;
+        }
+
+        // the reader
+        imu_sample_t s;
+        int k = 0;
+        while (k < perRead && imu_ring_pop(&ring, &s)) {
+            if (s.seq != nextSeq) {
+                gaps++;
+            }
+            if (got && s.t - lastT != (s.seq - (nextSeq - 1)) * PERIOD_US) {
+                badTimes++;
+            }
+            if (s.seq >= (uint32_t)total || !sameData(&s.data, &sent[s.seq])) {
+                badValues++;
+            }
+            nextSeq = s.seq + 1;
+            lastT = s.t;
+            got++;
+            k++;
+            printf("%u,%u,%d,%d,%d,%d,%d,%d,%d\n", s.seq, s.t, s.data.accel_x, s.data.accel_y, s.data.accel_z,
+                s.data.temp, s.data.gyro_x, s.data.gyro_y, s.data.gyro_z);
+        }
+    }
+
+    fprintf(stderr, "%d samples, %d read, %u dropped by the ring, %d gaps, %d bad times, %d bad values\n",
+        total, got, ring.dropped, gaps, badTimes, badValues);
+    return (got + (int)ring.dropped != total || badTimes || badValues) ? 2 : 0;
+}
@@ -0,0 +1,330 @@
+// Runs the hw13 jobs through sched.c on a made up clock, to see they keep their rates and
+// how old the data gets, without a pico. The jobs don't do the real work, they take as long
+// as it would take: the I2C bytes at the bus speed, the filter a fixed time per sample.
+//
+//   sched_sim                          10 seconds with the rates in hw13.c
+//   ... --seconds n
+//   ... --imu-us n                     how often the FIFO is emptied (default 5000)
+//   ... --display-hz n --log-hz n      (default 30 and 10)
+//   ... --filter-us n                  filter time per sample (default 5)
+//   ... --render-us n --log-us n       drawing a frame and formatting the log lines (default 300 and 400)
+//   ... --i2c-hz n                     bus speed (default 400000)
+//   ... --full                         send the whole screen every frame, the worst the display can do
+//   ... --telemetry                    every sample out as a binary record instead of the text log
+//
+// With --full a frame holds the bus for 12ms at 400kHz, longer than the IMU period, so the IMU
+// job slips runs. The FIFO still keeps every sample, it is the update the display needs to avoid.
+//
+// Like on the pico, the display's DMA holds the bus while the other jobs run, and the IMU job
+// waits for it. The sensor takes a sample every 1ms into a 1024 byte FIFO. The clock starts
+// just before it wraps, to check that is handled.
+//
+// Prints each job's rate and lateness and the latencies, and exits with 1 if a job missed
+// runs, the FIFO overflowed, a sample was lost, or a sample took more than half the
+// FIFO's time to get through the filter.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "sched.h"
+#include "logbuf.h"
+#include "telemetry.h"
+
+#define SAMPLE_US 1000
+#define FIFO_BYTES 1024
+#define PACKET_BYTES 14
+#define WIDTH 128
+#define PAGES 4
+#define ADDR_CMDS 7 // bytes before each window's pixels, as ssd1306.c sends them
+#define USB_FIFO 256 // tinyusb's CDC transmit buffer
+#define USB_BYTES_PER_MS 64 // one full speed packet a frame
+
+static uint32_t now; // the made up clock
+static uint32_t start;
+static uint32_t busFree; // when the display's DMA lets go of the bus
+static uint32_t byteNs; // one I2C byte, 9 clocks
+
+static uint32_t simClock(void) {
+    return now;
+}
+
+// settings
+static uint32_t imuUs = 5000;
+static int displayHz = 30;
+static int logHz = 10;
+static uint32_t filterUs = 5;
+static uint32_t renderUs = 300;
+static uint32_t logUs = 400;
+static int full = 0;
+static int telemetry = 0;
+
+// the sensor and what the IMU job got from it
+static uint32_t firstSample; // when sample 0 was taken
+static uint32_t taken = 0;
+static uint32_t overflows = 0;
+static uint32_t mostQueued = 0; // samples
+static uint32_t latencyMax = 0; // sample taken to through the filter
+static uint32_t stateT; // when the newest filtered sample was taken
+static int haveState = 0;
+
+// what the display job did
+static unsigned char shown[PAGES][WIDTH];
+static uint32_t frameBytesMax = 0;
+static uint32_t ageMax = 0; // newest sample when a frame is drawn
+static uint32_t glassMax = 0; // and when it has finished going out
+
+static logbuf_t logOut;
+static uint32_t usbLevel = 0; // bytes in the USB buffer
+static uint32_t usbT; // last time it was emptied out
+
+static void i2c(int bytes) {
+    now += (uint32_t)((uint64_t)bytes * byteNs / 1000);
+}
+
+static void waitBus(void) {
+    if ((int32_t)(busFree - now) > 0) {
+        now = busFree;
+    }
+}
+
+// samples the sensor has taken by now
+static uint32_t produced(void) {
+    int32_t since = (int32_t)(now - firstSample);
+    return since < 0 ? 0 : since / SAMPLE_US + 1;
+}
+
+static uint32_t sampleTime(uint32_t n) {
+    return firstSample + n * SAMPLE_US;
+}
+
+static void imuTask(void *arg) {
+    (void)arg;
+    waitBus();
+    i2c(5); // FIFO_COUNT
+    uint32_t n = produced() - taken;
+    if (n * PACKET_BYTES >= FIFO_BYTES) {
+        overflows++;
+        taken += n;
+        i2c(6); // reset it
+        return;
+    }
+    if (n == 0) {
+        return;
+    }
+    if (n > mostQueued) {
+        mostQueued = n;
+    }
+    i2c(3 + n * PACKET_BYTES);
+    now += n * filterUs;
+    uint32_t k;
+    for (k = 0; telemetry && k < n; k++) {
+        imu_sample_t sample = {taken + k, sampleTime(taken + k), {0}};
+        uint8_t frame[TELEM_FRAME_BYTES];
+        logbuf_write(&logOut, frame, telem_encode(&sample, frame));
+        now += 2;
+    }
+    uint32_t latency = now - sampleTime(taken); // the oldest one waited longest
+    if (latency > latencyMax) {
+        latencyMax = latency;
+    }
+    taken += n;
+    stateT = sampleTime(taken - 1);
+    haveState = 1;
+}
+
+// the crosshair hw13.c draws, from the board tilting back and forth
+static void drawFrame(unsigned char frame[PAGES][WIDTH]) {
+    float t = (stateT - firstSample) / 1e6f;
+    float pitch = 0.5f * sinf(t * 2.0f);
+    float roll = 0.3f * sinf(t * 3.0f);
+    int lineX = WIDTH / 2 + (int)(pitch * 20);
+    int lineY = PAGES * 4 + (int)(roll * 20);
+    int x, y;
+    memset(frame, 0, PAGES * WIDTH);
+    for (y = PAGES * 4; y != lineY; y += lineY > y ? 1 : -1) {
+        frame[y / 8][WIDTH / 2] |= 1 << (y % 8);
+    }
+    frame[lineY / 8][WIDTH / 2] |= 1 << (lineY % 8);
+    for (x = WIDTH / 2; x != lineX; x += lineX > x ? 1 : -1) {
+        frame[PAGES / 2][x] |= 1;
+    }
+    frame[PAGES / 2][lineX] |= 1;
+}
+
+// bytes ssd1306_update_async() would send, changed spans only unless the whole screen is cheaper
+static int frameBytes(unsigned char frame[PAGES][WIDTH]) {
+    int bytes = 0;
+    int page;
+    for (page = 0; page < PAGES; page++) {
+        int lo = 0;
+        int hi = WIDTH - 1;
+        while (lo < WIDTH && frame[page][lo] == shown[page][lo]) {
+            lo++;
+        }
+        if (lo == WIDTH) {
+            continue;
+        }
+        while (frame[page][hi] == shown[page][hi]) {
+            hi--;
+        }
+        bytes += ADDR_CMDS + 1 + hi - lo + 1;
+    }
+    if (full || bytes > ADDR_CMDS + 1 + WIDTH * PAGES) {
+        bytes = ADDR_CMDS + 1 + WIDTH * PAGES;
+    }
+    memcpy(shown, frame, sizeof(shown));
+    return bytes;
+}
+
+static void displayTask(void *arg) {
+    (void)arg;
+    unsigned char frame[PAGES][WIDTH];
+    if (haveState && now - stateT > ageMax) {
+        ageMax = now - stateT;
+    }
+    drawFrame(frame);
+    now += renderUs;
+    waitBus(); // the last frame has to be out first
+    int bytes = frameBytes(frame);
+    if ((uint32_t)bytes > frameBytesMax) {
+        frameBytesMax = bytes;
+    }
+    busFree = now + (uint32_t)((uint64_t)bytes * byteNs / 1000);
+    if (haveState && busFree - stateT > glassMax) {
+        glassMax = busFree - stateT;
+    }
+}
+
+// the same lines hw13.c prints, near enough the same lengths
+static void logTask(void *arg) {
+    (void)arg;
+    if (telemetry) {
+        return;
+    }
+    now += logUs;
+    logbuf_printf(&logOut, "Accel: X=%.3f Y=%.3f Z=%.3f g\n", 0.012, -0.034, 0.998);
+    logbuf_printf(&logOut, "Roll=%.2f Pitch=%.2f deg, yaw rate %.1f deg/s\n", -12.34, 5.67, 0.1);
+    logbuf_printf(&logOut, "%lu samples, filter %lu us, %lu lost, %lu dropped\n", (unsigned long)taken, 25ul, 0ul, 0ul);
+    logbuf_printf(&logOut, "imu 200/s late 1234 took 567, display 30/s late 123 took 456, log 10/s late 12 took 345, "
+        "serial 500/s late 123 took 12, shown 12345 us old, log 0 dropped\n");
+}
+
+static void serialTask(void *arg) {
+    (void)arg;
+    uint32_t drained = (now - usbT) / 1000 * USB_BYTES_PER_MS;
+    usbT += (now - usbT) / 1000 * 1000;
+    usbLevel = drained > usbLevel ? 0 : usbLevel - drained;
+
+    const char *p;
+    int n = logbuf_peek(&logOut, &p);
+    int room = USB_FIFO - usbLevel;
+    if (n > room) {
+        n = room;
+    }
+    now += 5 + n / 16;
+    usbLevel += n;
+    logbuf_consume(&logOut, n);
+}
+
+int main(int argc, char **argv) {
+    int seconds = 10;
+    int i2cHz = 400000;
+    int i;
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--seconds") && i + 1 < argc) {
+            seconds = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--imu-us") && i + 1 < argc) {
+            imuUs = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--display-hz") && i + 1 < argc) {
+            displayHz = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--log-hz") && i + 1 < argc) {
+            logHz = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--filter-us") && i + 1 < argc) {
+            filterUs = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--render-us") && i + 1 < argc) {
+            renderUs = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--log-us") && i + 1 < argc) {
+            logUs = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--i2c-hz") && i + 1 < argc) {
+            i2cHz = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--full")) {
+            full = 1;
+        } else if (!strcmp(argv[i], "--telemetry")) {
+            telemetry = 1;
+        } else {
+            fprintf(stderr, "usage: sched_sim [--seconds n] [--imu-us n] [--display-hz n] [--log-hz n] "
+                "[--filter-us n] [--render-us n] [--log-us n] [--i2c-hz n] [--full] [--telemetry]\n");
+            return 2;
+        }
+    }
+    if (seconds < 1 || seconds > 3600 || imuUs < 100 || displayHz < 1 || logHz < 1 || i2cHz < 10000) {
+        fprintf(stderr, "sched_sim: settings out of range\n");
+        return 2;
+    }
+    byteNs = (uint32_t)(9000000000ull / i2cHz);
+
+    start = 0xFFFFFFFFu - 2000000; // wraps 2s in
+    now = start;
+    firstSample = start + 137;
+    usbT = start;
+    busFree = start;
+    stateT = firstSample;
+    logbuf_init(&logOut);
+
+    // as hw13.c adds them
+    sched_t s;
+    sched_init(&s, simClock);
+    sched_add(&s, "imu", imuUs, 0, imuTask, NULL);
+    sched_add(&s, "display", 1000000 / displayHz, imuUs / 2, displayTask, NULL);
+    sched_add(&s, "log", 1000000 / logHz, imuUs / 4, logTask, NULL);
+    sched_add(&s, "serial", 2000, imuUs * 3 / 4, serialTask, NULL);
+
+    uint32_t length = seconds * 1000000u;
+    while (now - start < length) {
+        if (sched_poll(&s) < 0) {
+            now += sched_idle_us(&s);
+        }
+    }
+
+    int failed = 0;
+    printf("job       period  runs  expected  skipped  late max  took max (us)\n");
+    for (i = 0; i < s.count; i++) {
+        sched_task_t *t = &s.tasks[i];
+        uint32_t expected = length / t->period_us;
+        int ok = t->skipped == 0 && t->runs + 1 >= expected;
+        printf("%-8s %7lu %5lu %9lu %8lu %9lu %9lu %s\n", t->name, (unsigned long)t->period_us,
+            (unsigned long)t->runs, (unsigned long)expected, (unsigned long)t->skipped,
+            (unsigned long)t->late_max, (unsigned long)t->took_max, ok ? "" : " MISSED RUNS");
+        if (!ok) {
+            failed = 1;
+        }
+    }
+
+    uint32_t fifoUs = FIFO_BYTES / PACKET_BYTES * SAMPLE_US;
+    uint32_t lost = produced() - taken; // still in the FIFO at the end is fine, at most a period's worth
+    printf("samples %lu taken, most at once %lu, %lu overflows\n", (unsigned long)taken,
+        (unsigned long)mostQueued, (unsigned long)overflows);
+    printf("sample to filtered: worst %lu us (FIFO holds %lu us)\n", (unsigned long)latencyMax, (unsigned long)fifoUs);
+    printf("newest sample when a frame is drawn: worst %lu us, when it is on the screen %lu us, biggest frame %lu bytes\n",
+        (unsigned long)ageMax, (unsigned long)glassMax, (unsigned long)frameBytesMax);
+    printf("log: %lu lines or records dropped, most waiting %lu bytes\n", (unsigned long)logOut.dropped, (unsigned long)logOut.most);
+
+    if (overflows || lost > imuUs / SAMPLE_US + 1) {
+        printf("FAIL samples lost\n");
+        failed = 1;
+    }
+    if (latencyMax > fifoUs / 2) {
+        printf("FAIL samples wait more than half the FIFO\n");
+        failed = 1;
+    }
+    if (logOut.dropped) {
+        printf("FAIL log lines or records dropped\n");
+        failed = 1;
+    }
+    if (!failed) {
+        printf("ok\n");
+    }
+    return failed;
+}
@@ -0,0 +1,209 @@
+// Checks the binary IMU telemetry on the computer, and how much smaller it is than the text log.
+//
+//   telem_check
+//   telem_check --write stream.bin     also save the stream it made up, to try read_telemetry.py on
+//   ... --csv samples.csv              and what read_telemetry.py should make of it
+//
+// - COBS round trips any bytes, 0s and runs of 254 and more included
+// - samples round trip through telem_encode() and telem_decode(), the extreme values too
+// - any one flipped bit in a frame is caught
+// - a reader that starts part way into the stream, or loses bytes, gets back in step
+// - bytes a sample on the wire, against the text hw13.c prints
+//
+// Prints what it checked and exits with 1 if anything was wrong.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "telemetry.h"
+
+#define SAMPLES 10000
+
+static int failed = 0;
+
+static void check(int ok, const char *what) {
+    printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+    if (!ok) {
+        failed = 1;
+    }
+}
+
+static uint32_t noise = 1;
+
+static uint32_t random32() {
+    noise = noise * 1664525 + 1013904223;
+    return noise;
+}
+
+// a sample with every field random, or now and then all 0 or at the ends of their ranges
+static void makeSample(imu_sample_t *s, uint32_t seq) {
+    int16_t v[7];
+    int i;
+    int kind = random32() >> 28;
+    for (i = 0; i < 7; i++) {
+        v[i] = kind == 0 ? 0 : kind == 1 ? -32768 : kind == 2 ? 32767 : (int16_t)(random32() >> 16);
+    }
+    s->seq = seq;
+    s->t = kind == 0 ? 0 : kind == 1 ? 0xFFFFFFFF : seq * 1000 + 137;
+    s->data = (imu_data_t){v[0], v[1], v[2], v[3], v[4], v[5], v[6]};
+}
+
+static int same(const imu_sample_t *a, const imu_sample_t *b) {
+    return a->seq == b->seq && a->t == b->t && !memcmp(&a->data, &b->data, sizeof(imu_data_t));
+}
+
+static void checkCobs() {
+    static uint8_t in[1000], enc[1010], dec[1010];
+    int ok = 1;
+    int r, i;
+    for (r = 0; r < 2000 && ok; r++) {
+        int len = random32() % sizeof(in);
+        int zeros = random32() % 4; // none, few, half, or all 0
+        for (i = 0; i < len; i++) {
+            uint32_t x = random32();
+            in[i] = zeros == 3 || (zeros && (x >> 24) % (zeros == 1 ? 50 : 2) == 0) ? 0 : (x >> 8) % 255 + 1;
+        }
+        int n = cobs_encode(in, len, enc);
+        ok = n <= len + len / 254 + 1 && !memchr(enc, 0, n);
+        ok = ok && cobs_decode(enc, n, dec) == len && !memcmp(in, dec, len);
+    }
+    check(ok, "COBS round trips, no 0s in what it sends");
+
+    check(cobs_decode((const uint8_t *)"\x05\x01\x02", 3, dec) < 0, "COBS that runs off the end is refused");
+}
+
+static void checkRecords(FILE *save, FILE *csv) {
+    static uint8_t stream[SAMPLES * TELEM_FRAME_BYTES];
+    int len = 0;
+    imu_sample_t s, back;
+    int i, bit;
+
+    int ok = 1;
+    for (i = 0; i < SAMPLES; i++) {
+        makeSample(&s, i);
+        int n = telem_encode(&s, stream + len);
+        // the frame, without its ending 0, is what the reader passes back
+        ok = ok && n == TELEM_FRAME_BYTES && stream[len + n - 1] == 0 && !memchr(stream + len, 0, n - 1);
+        ok = ok && telem_decode(stream + len, n - 1, &back) == TELEM_OK && same(&s, &back);
+        len += n;
+        if (csv) {
+            fprintf(csv, "%lu,%lu,%d,%d,%d,%d,%d,%d,%d\n", (unsigned long)s.seq, (unsigned long)s.t, s.data.accel_x,
+                s.data.accel_y, s.data.accel_z, s.data.temp, s.data.gyro_x, s.data.gyro_y, s.data.gyro_z);
+        }
+    }
+    check(ok, "samples round trip, each frame one 0 at the end");
+    if (save) {
+        fwrite(stream, 1, len, save);
+    }
+
+    int caught = 1;
+    uint8_t frame[TELEM_FRAME_BYTES];
+    for (i = 0; i < 200; i++) {
+        makeSample(&s, i);
+        for (bit = 0; bit < (TELEM_FRAME_BYTES - 1) * 8; bit++) {
+            telem_encode(&s, frame);
+            frame[bit / 8] ^= 1 << (bit % 8);
+            // a flip to 0 splits the frame, the reader gets two short ones
+            int from = 0, to;
+            for (to = 0; to < TELEM_FRAME_BYTES; to++) {
+                if (frame[to] != 0) {
+                    continue;
+                }
+                back = s;
+                back.seq++;
+                imu_sample_t kept = back;
+                if (telem_decode(frame + from, to - from, &back) == TELEM_OK || !same(&back, &kept)) {
+                    caught = 0;
+                }
+                from = to + 1;
+            }
+        }
+    }
+    check(caught, "every single bit flip is caught and leaves the sample alone");
+
+    // start 7 bytes in, and knock a byte out every 1000, like a reader joining late on a bad link.
+    // that loses the first frame and every one a byte is knocked out of, or two if it was the 0
+    int got = 0, bad = 0, start = 0, touched = 1, last = 0;
+    uint32_t expect = 1;
+    ok = 1;
+    for (i = 7; i < len; i++) {
+        if (i % 1000 == 500) {
+            int f = i / TELEM_FRAME_BYTES;
+            touched += (f != last) + (stream[i] == 0);
+            last = f;
+            continue;
+        }
+        if (stream[i] != 0) {
+            frame[start < TELEM_FRAME_BYTES ? start : TELEM_FRAME_BYTES - 1] = stream[i];
+            start++;
+            continue;
+        }
+        if (start <= TELEM_FRAME_BYTES && telem_decode(frame, start, &back) == TELEM_OK) {
+            ok = ok && back.seq >= expect;
+            expect = back.seq + 1;
+            got++;
+        } else {
+            bad++;
+        }
+        start = 0;
+    }
+    check(ok && got == SAMPLES - touched, "a reader joining late and losing bytes gets back in step");
+    printf("     %d frames decoded, %d thrown away\n", got, bad);
+}
+
+// the text hw13.c sends for the same samples
+static void compareText() {
+    char line[200];
+    long text = 0, csv = 0;
+    imu_sample_t s;
+    int i;
+    for (i = 0; i < SAMPLES; i++) {
+        makeSample(&s, 1000000 + i);
+        s.data.accel_x = (int16_t)(random32() >> 16) / 16;
+        s.data.accel_y = (int16_t)(random32() >> 16) / 16;
+        s.data.accel_z = 16384 + (int16_t)(random32() >> 16) / 16;
+        // the two lines the text log prints every time: accelerometer in g and the angles
+        text += snprintf(line, sizeof(line), "Accel: X=%.3f Y=%.3f Z=%.3f g\n", s.data.accel_x * 0.000061,
+            s.data.accel_y * 0.000061, s.data.accel_z * 0.000061);
+        text += snprintf(line, sizeof(line), "Roll=%.2f Pitch=%.2f deg, yaw rate %.1f deg/s\n",
+            (int)(random32() % 18000) / 100.0 - 90, (int)(random32() % 18000) / 100.0 - 90, (int)(random32() % 2000) / 10.0 - 100);
+        // and everything in the record as text, the least a text log with the same data could send
+        csv += snprintf(line, sizeof(line), "%lu,%lu,%d,%d,%d,%d,%d,%d,%d\n", (unsigned long)s.seq, (unsigned long)s.t,
+            s.data.accel_x, s.data.accel_y, s.data.accel_z, s.data.temp, s.data.gyro_x, s.data.gyro_y, s.data.gyro_z);
+    }
+    printf("     bytes a sample: binary %d, text log %.1f (accel and angles only), everything as CSV text %.1f\n",
+        TELEM_FRAME_BYTES, (double)text / SAMPLES, (double)csv / SAMPLES);
+    printf("     at 1kHz: binary %d bytes/s, text log %.0f bytes/s\n", TELEM_FRAME_BYTES * 1000, (double)text / SAMPLES * 1000);
+}
+
+int main(int argc, char **argv) {
+    FILE *save = NULL;
+    FILE *csv = NULL;
+    int i;
+    for (i = 1; i < argc; i++) {
+        FILE **f = !strcmp(argv[i], "--write") ? &save : !strcmp(argv[i], "--csv") ? &csv : NULL;
+        if (!f || i + 1 == argc) {
+            fprintf(stderr, "usage: telem_check [--write stream.bin] [--csv samples.csv]\n");
+            return 2;
+        }
+        *f = fopen(argv[++i], f == &save ? "wb" : "w");
+        if (!*f) {
+            perror(argv[i]);
+            return 2;
+        }
+    }
+    if (csv) {
+        fprintf(csv, "seq,t,ax,ay,az,temp,gx,gy,gz\n");
+    }
+    checkCobs();
+    checkRecords(save, csv);
+    compareText();
+    if (save) {
+        fclose(save);
+    }
+    if (csv) {
+        fclose(csv);
+    }
+    return failed;
+}
@@ -0,0 +1,133 @@
+#include "telemetry.h"
+
+// len bytes into out with every 0 taken out: each run of non-zero bytes gets a byte in front
+// with its length + 1, standing for the 0 after it. out needs len + len / 254 + 1 bytes.
+// returns the bytes written, the 0 that ends the frame is not added
+int cobs_encode(const uint8_t *in, int len, uint8_t *out) {
+    int code_at = 0; // where the current run's length byte goes
+    int n = 1;
+    uint8_t code = 1;
+    int i;
+    for (i = 0; i < len; i++) {
+        if (in[i] == 0) {
+            out[code_at] = code;
+            code_at = n++;
+            code = 1;
+        } else {
+            out[n++] = in[i];
+            code++;
+            if (code == 0xFF) {
+                // a full run of 254, the next one starts without a 0 in between
+                out[code_at] = code;
+                code_at = n++;
+                code = 1;
+            }
+        }
+    }
+    out[code_at] = code;
+    return n;
+}
+
+// a frame without its ending 0 back into out, which needs len bytes.
+// returns the bytes written, or -1 if it isn't a COBS frame
+int cobs_decode(const uint8_t *in, int len, uint8_t *out) {
+    int n = 0;
+    int i = 0;
+    while (i < len) {
+        uint8_t code = in[i++];
+        int k;
+        if (code == 0 || i + code - 1 > len) {
+            return -1;
+        }
+        for (k = 1; k < code; k++) {
+            if (in[i] == 0) {
+                return -1;
+            }
+            out[n++] = in[i++];
+        }
+        if (code != 0xFF && i < len) {
+            out[n++] = 0;
+        }
+    }
+    return n;
+}
+
+// CRC-16/CCITT-FALSE, the same as python's binascii.crc_hqx(data, 0xFFFF)
+uint16_t telem_crc16(const uint8_t *p, int n) {
+    uint16_t crc = 0xFFFF;
+    int i, k;
+    for (i = 0; i < n; i++) {
+        crc ^= p[i] << 8;
+        for (k = 0; k < 8; k++) {
+            crc = (crc << 1) ^ (0x1021 & -(crc >> 15));
+        }
+    }
+    return crc;
+}
+
+static uint8_t *put16(uint8_t *p, uint16_t v) {
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+    return p + 2;
+}
+
+static uint8_t *put32(uint8_t *p, uint32_t v) {
+    put16(p, v & 0xFFFF);
+    return put16(p + 2, v >> 16);
+}
+
+static uint16_t get16(const uint8_t *p) {
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t get32(const uint8_t *p) {
+    return get16(p) | ((uint32_t)get16(p + 2) << 16);
+}
+
+// one sample as a frame ready to send, 0 on the end. frame needs TELEM_FRAME_BYTES, returns how many it used
+int telem_encode(const imu_sample_t *s, uint8_t *frame) {
+    uint8_t record[TELEM_RECORD_BYTES];
+    uint8_t *p = record;
+    p = put32(p, s->seq);
+    p = put32(p, s->t);
+    p = put16(p, s->data.accel_x);
+    p = put16(p, s->data.accel_y);
+    p = put16(p, s->data.accel_z);
+    p = put16(p, s->data.temp);
+    p = put16(p, s->data.gyro_x);
+    p = put16(p, s->data.gyro_y);
+    p = put16(p, s->data.gyro_z);
+    put16(p, telem_crc16(record, TELEM_RECORD_BYTES - 2));
+    int n = cobs_encode(record, TELEM_RECORD_BYTES, frame);
+    frame[n++] = 0;
+    return n;
+}
+
+// a frame as read, without its ending 0, back into s. returns TELEM_OK or what is wrong,
+// s is left alone if it isn't OK
+int telem_decode(const uint8_t *frame, int len, imu_sample_t *s) {
+    uint8_t record[TELEM_FRAME_BYTES];
+    if (len > TELEM_FRAME_BYTES) {
+        return TELEM_BAD_LENGTH;
+    }
+    int n = cobs_decode(frame, len, record);
+    if (n < 0) {
+        return TELEM_BAD_COBS;
+    }
+    if (n != TELEM_RECORD_BYTES) {
+        return TELEM_BAD_LENGTH;
+    }
+    if (get16(record + TELEM_RECORD_BYTES - 2) != telem_crc16(record, TELEM_RECORD_BYTES - 2)) {
+        return TELEM_BAD_CRC;
+    }
+    s->seq = get32(record);
+    s->t = get32(record + 4);
+    s->data.accel_x = (int16_t)get16(record + 8);
+    s->data.accel_y = (int16_t)get16(record + 10);
+    s->data.accel_z = (int16_t)get16(record + 12);
+    s->data.temp = (int16_t)get16(record + 14);
+    s->data.gyro_x = (int16_t)get16(record + 16);
+    s->data.gyro_y = (int16_t)get16(record + 18);
+    s->data.gyro_z = (int16_t)get16(record + 20);
+    return TELEM_OK;
+}
@@ -0,0 +1,36 @@
+#ifndef TELEMETRY_H__
+#define TELEMETRY_H__
+
+#include <stdint.h>
+#include "imu.h"
+
+// Every IMU sample over USB in binary, small enough to keep up with the sensor at 1kHz,
+// which the printf lines can't. No pico calls in here, so it builds on the computer too (see sim/).
+//
+// record, 24 bytes, little endian:
+//   uint32 seq       imu_sample_t seq, a gap means samples were lost
+//   uint32 t         us since boot when the sensor took it
+//   int16  x7        accel x y z, temp, gyro x y z, raw counts as in imu_data_t
+//   uint16 crc       CRC-16/CCITT-FALSE (binascii.crc_hqx(record, 0xFFFF)) of the 22 bytes before it
+// each record is COBS encoded, so it has no 0 bytes in it, and a 0 is sent after it. a reader
+// that starts in the middle of a record, or loses bytes, just waits for the next 0.
+// 26 bytes a sample on the wire.
+//
+// python/read_telemetry.py turns the stream into CSV on the computer.
+
+#define TELEM_RECORD_BYTES 24
+#define TELEM_FRAME_BYTES (TELEM_RECORD_BYTES + 2) // one COBS byte and the 0, for records under 254 bytes
+
+// what telem_decode() found
+#define TELEM_OK 0
+#define TELEM_BAD_COBS 1
+#define TELEM_BAD_LENGTH 2
+#define TELEM_BAD_CRC 3
+
+int cobs_encode(const uint8_t *in, int len, uint8_t *out);
+int cobs_decode(const uint8_t *in, int len, uint8_t *out);
+uint16_t telem_crc16(const uint8_t *p, int n);
+int telem_encode(const imu_sample_t *s, uint8_t *frame);
+int telem_decode(const uint8_t *frame, int len, imu_sample_t *s);
+
+#endif
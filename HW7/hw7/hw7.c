@@ -3,7 +3,14 @@
 #include "hardware/i2c.h"
 #include "hardware/adc.h"
 #include "ssd1306.h"
-#include "font.h"
+#include "text.h"
+
+// I2C defines
+#define I2C_PORT i2c0
+#define I2C_SDA 8
+#define I2C_SCL 9
+
+ssd1306_t display; // 128x32
 
 
 
@@ -43,53 +50,25 @@ uint8_t readReg(uint8_t address, uint8_t reg) {
     return value;
 }
 
-void drawLetterColumn(int x_offset, int y_offset, char c){
-    ssd1306_drawPixel(x_offset, y_offset+0, (c >> 0)%2);
-    ssd1306_drawPixel(x_offset, y_offset+1, (c >> 1)%2);
-    ssd1306_drawPixel(x_offset, y_offset+2, (c >> 2)%2);
-    ssd1306_drawPixel(x_offset, y_offset+3, (c >> 3)%2);
-    ssd1306_drawPixel(x_offset, y_offset+4, (c >> 4)%2);
-    ssd1306_drawPixel(x_offset, y_offset+5, (c >> 5)%2);
-    ssd1306_drawPixel(x_offset, y_offset+6, (c >> 6)%2);
-    ssd1306_drawPixel(x_offset, y_offset+7, (c >> 7)%2);
-       
-}
-
-void drawLetter(int x_offset, int y_offset, char c){
-    c = c-32;
-    // x_offset, y_offset represent the top left of the letter.
-    drawLetterColumn(x_offset+0, y_offset, ASCII[c][0]);
-    drawLetterColumn(x_offset+1, y_offset, ASCII[c][1]);
-    drawLetterColumn(x_offset+2, y_offset, ASCII[c][2]);
-    drawLetterColumn(x_offset+3, y_offset, ASCII[c][3]);
-    drawLetterColumn(x_offset+4, y_offset, ASCII[c][4]);
+// 1 to send the screen from a timer, the loop only draws and calls ssd1306_present()
+#define TIMER_REFRESH 0
+#define REFRESH_MS 20
 
-}
+struct repeating_timer timer;
 
+// frames that have gone out to the display, for the fps readout
+volatile uint32_t frames_sent = 0;
 
-// this function is dumb bc it assumes you start at 0 0 but I can easily fix later.
-void drawMessage(int x_offset, int y_offset, char* message){
-    // int x_offset = 0;
-    // int y_offset = 0;
-    for(int i = 0; i < 10; i++){
-        if(message[i] != 0){
-            drawLetter(x_offset+(5*i)%125, y_offset, message[i]);
-        }else{
-            break;
-        }
-        // if(i >= 24){
-        //     y_offset = 8;
-        // }
-    }
-    
+// called from the DMA interrupt when a frame is on its way to the display
+void frame_sent(void) {
+    frames_sent++;
 }
 
-struct repeating_timer timer;
-
 bool LED_on = true;
 bool callback(__unused struct repeating_timer *t){
-    // ssd1306_drawPixel(0, 0, LED_on);
-    ssd1306_update();
+    // ssd1306_drawPixel(&display, 0, 0, LED_on);
+    // only whole frames from ssd1306_present() get sent, this tick is skipped if the last one is still going
+    ssd1306_flush_async(&display, frame_sent);
     gpio_put(PICO_DEFAULT_LED_PIN, LED_on);
     LED_on = !LED_on;
     return true;
@@ -114,28 +93,35 @@ int main() {
     gpio_init(PICO_DEFAULT_LED_PIN);
     gpio_set_dir(PICO_DEFAULT_LED_PIN, GPIO_OUT);
     
-    ssd1306_setup();
+    ssd1306_setup(&display, I2C_PORT, SSD1306_ADDRESS, 128, 32);
 
     // 1Hz interrupt
     // add_repeating_timer_ms(500, callback, NULL, &timer);
+#if TIMER_REFRESH
+    add_repeating_timer_ms(REFRESH_MS, callback, NULL, &timer);
+#endif
 
 
-    char message[10]; 
-    sprintf(message, "abcdefghijklmnopqrstuvwxyz"); 
-    // drawMessage(message); // draw starting at x=20,y=10 
     float t = 0;
     float prev_t = 0;
+    uint32_t prev_frames = 0;
+    float fps = 0;
     while (true) {  
         t = to_us_since_boot(get_absolute_time());     
-        // 
-        sprintf(message, "fps: %.3f", 1000000.0/(t-prev_t)); 
-        drawMessage(0, 24, message);
-        sprintf(message, "V: %.3f", 3.3*adc_read()/4095); 
-        drawMessage(0, 0, message);
+        // frames the display got since the last one did, not how often this loop goes round
+        uint32_t frames = frames_sent;
+        if (frames != prev_frames) {
+            fps = (frames - prev_frames) * 1000000.0 / (t - prev_t);
+            prev_frames = frames;
+            prev_t = t;
+        }
+        drawPrintf(&display, 0, 24, "fps: %.3f", fps);
+        drawPrintf(&display, 0, 0, "V: %.3f", 3.3*adc_read()/4095);
         // printf("V: %.3f", 3.3*adc_read()/4095);
-        ssd1306_update(); 
-        
-        prev_t = t;  
-        
+#if TIMER_REFRESH
+        ssd1306_present(&display); // the timer sends it
+#else
+        ssd1306_update_async(&display, frame_sent); // sends in the background while the next frame is drawn, skipped if the last is still going
+#endif
     }
 }
\ No newline at end of file
@@ -0,0 +1,202 @@
+#include <stdlib.h>
+#include "draw.h"
+
+// set or clear the bits in mask of one buffer byte
+static inline void put(unsigned char *p, unsigned char mask, unsigned char color) {
+    if (color == 1) {
+        *p |= mask;
+    } else {
+        *p &= ~mask;
+    }
+}
+
+// one pixel, already known to be on the screen or checked here
+static inline void plot(ssd1306_t *d, int x, int y, unsigned char color) {
+    if ((unsigned)x < (unsigned)d->width && (unsigned)y < (unsigned)d->height) {
+        put(&d->buffer[1 + x + (y >> 3) * d->width], 1 << (y & 7), color);
+    }
+}
+
+// a row of pixels is the same bit in neighbouring bytes
+void ssd1306_hline(ssd1306_t *d, int x0, int x1, int y, unsigned char color) {
+    int x;
+    if (x0 > x1) {
+        x = x0;
+        x0 = x1;
+        x1 = x;
+    }
+    if (y < 0 || y >= d->height || x1 < 0 || x0 >= d->width) {
+        return;
+    }
+    if (x0 < 0) {
+        x0 = 0;
+    }
+    if (x1 >= d->width) {
+        x1 = d->width - 1;
+    }
+    unsigned char *p = &d->buffer[1 + (y >> 3) * d->width];
+    unsigned char mask = 1 << (y & 7);
+    for (x = x0; x <= x1; x++) {
+        put(&p[x], mask, color);
+    }
+}
+
+// the bits for rows y0 to y1 of page, y0 and y1 already on the screen
+static unsigned char page_mask(int page, int y0, int y1) {
+    unsigned char mask = 0xFF;
+    if (page == (y0 >> 3)) {
+        mask &= 0xFF << (y0 & 7);
+    }
+    if (page == (y1 >> 3)) {
+        mask &= 0xFF >> (7 - (y1 & 7));
+    }
+    return mask;
+}
+
+// clip y0-y1 to the screen, false if none of it is on it
+static bool clip_rows(ssd1306_t *d, int *y0, int *y1) {
+    int y;
+    if (*y0 > *y1) {
+        y = *y0;
+        *y0 = *y1;
+        *y1 = y;
+    }
+    if (*y1 < 0 || *y0 >= d->height) {
+        return false;
+    }
+    if (*y0 < 0) {
+        *y0 = 0;
+    }
+    if (*y1 >= d->height) {
+        *y1 = d->height - 1;
+    }
+    return true;
+}
+
+// a column is up to 8 pixels per byte, one masked write per page
+void ssd1306_vline(ssd1306_t *d, int x, int y0, int y1, unsigned char color) {
+    int page;
+    if (x < 0 || x >= d->width || !clip_rows(d, &y0, &y1)) {
+        return;
+    }
+    for (page = y0 >> 3; page <= (y1 >> 3); page++) {
+        put(&d->buffer[1 + x + page * d->width], page_mask(page, y0, y1), color);
+    }
+}
+
+// Bresenham, walking the buffer index and bit along with x and y so no pixel needs a multiply
+void ssd1306_line(ssd1306_t *d, int x0, int y0, int x1, int y1, unsigned char color) {
+    if (y0 == y1) {
+        ssd1306_hline(d, x0, x1, y0, color);
+        return;
+    }
+    if (x0 == x1) {
+        ssd1306_vline(d, x0, y0, y1, color);
+        return;
+    }
+    // both ends off the same side, nothing to draw
+    if ((x0 < 0 && x1 < 0) || (y0 < 0 && y1 < 0) || (x0 >= d->width && x1 >= d->width)
+        || (y0 >= d->height && y1 >= d->height)) {
+        return;
+    }
+    int dx = abs(x1 - x0);
+    int sx = x0 < x1 ? 1 : -1;
+    int dy = -abs(y1 - y0);
+    int sy = y0 < y1 ? 1 : -1;
+    int err = dx + dy;
+    int row = (y0 >> 3) * d->width; // start of y0's page, can be off the screen
+    unsigned int mask = 1 << (y0 & 7);
+    while (true) {
+        if ((unsigned)x0 < (unsigned)d->width && (unsigned)y0 < (unsigned)d->height) {
+            put(&d->buffer[1 + row + x0], mask, color);
+        }
+        if (x0 == x1 && y0 == y1) {
+            break;
+        }
+        int e2 = 2 * err;
+        if (e2 >= dy) {
+            err += dy;
+            x0 += sx;
+        }
+        if (e2 <= dx) {
+            err += dx;
+            y0 += sy;
+            if (sy > 0) {
+                mask <<= 1;
+                if (mask == 0x100) {
+                    mask = 1;
+                    row += d->width;
+                }
+            } else {
+                mask >>= 1;
+                if (mask == 0) {
+                    mask = 0x80;
+                    row -= d->width;
+                }
+            }
+        }
+    }
+}
+
+// outline of the w by h box with its top left at x, y
+void ssd1306_rect(ssd1306_t *d, int x, int y, int w, int h, unsigned char color) {
+    if (w <= 0 || h <= 0) {
+        return;
+    }
+    ssd1306_hline(d, x, x + w - 1, y, color);
+    ssd1306_hline(d, x, x + w - 1, y + h - 1, color);
+    ssd1306_vline(d, x, y, y + h - 1, color);
+    ssd1306_vline(d, x + w - 1, y, y + h - 1, color);
+}
+
+// solid w by h box, one mask per page used across every column
+void ssd1306_fill_rect(ssd1306_t *d, int x, int y, int w, int h, unsigned char color) {
+    int x0 = x;
+    int x1 = x + w - 1;
+    int y0 = y;
+    int y1 = y + h - 1;
+    int page, i;
+    if (w <= 0 || h <= 0 || x1 < 0 || x0 >= d->width || !clip_rows(d, &y0, &y1)) {
+        return;
+    }
+    if (x0 < 0) {
+        x0 = 0;
+    }
+    if (x1 >= d->width) {
+        x1 = d->width - 1;
+    }
+    for (page = y0 >> 3; page <= (y1 >> 3); page++) {
+        unsigned char mask = page_mask(page, y0, y1);
+        unsigned char *p = &d->buffer[1 + page * d->width];
+        for (i = x0; i <= x1; i++) {
+            put(&p[i], mask, color);
+        }
+    }
+}
+
+// midpoint circle of radius r around cx, cy, 8 points per step
+void ssd1306_circle(ssd1306_t *d, int cx, int cy, int r, unsigned char color) {
+    int x = r;
+    int y = 0;
+    int err = 1 - r;
+    if (r < 0) {
+        return;
+    }
+    while (x >= y) {
+        plot(d, cx + x, cy + y, color);
+        plot(d, cx - x, cy + y, color);
+        plot(d, cx + x, cy - y, color);
+        plot(d, cx - x, cy - y, color);
+        plot(d, cx + y, cy + x, color);
+        plot(d, cx - y, cy + x, color);
+        plot(d, cx + y, cy - x, color);
+        plot(d, cx - y, cy - x, color);
+        y++;
+        if (err < 0) {
+            err += 2 * y + 1;
+        } else {
+            x--;
+            err += 2 * (y - x) + 1;
+        }
+    }
+}
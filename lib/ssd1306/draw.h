@@ -0,0 +1,16 @@
+#ifndef DRAW_H__
+#define DRAW_H__
+
+#include "ssd1306.h"
+
+// lines and shapes straight into a display's buffer. color 1 sets pixels, 0 clears them.
+// end points are included, anything off the screen is clipped
+
+void ssd1306_hline(ssd1306_t *d, int x0, int x1, int y, unsigned char color);
+void ssd1306_vline(ssd1306_t *d, int x, int y0, int y1, unsigned char color);
+void ssd1306_line(ssd1306_t *d, int x0, int y0, int x1, int y1, unsigned char color);
+void ssd1306_rect(ssd1306_t *d, int x, int y, int w, int h, unsigned char color);
+void ssd1306_fill_rect(ssd1306_t *d, int x, int y, int w, int h, unsigned char color);
+void ssd1306_circle(ssd1306_t *d, int cx, int cy, int r, unsigned char color);
+
+#endif
@@ -1,9 +1,7 @@
 #ifndef FONT_H__
 #define FONT_H__
 
-// make these functions:
-// void drawChar(...);
-// void drawString(...);
+// used by text.c
 
 // lookup table for all of the ascii characters
 static const char ASCII[96][5] = {
@@ -0,0 +1,151 @@
+// Checks the DMA update in ssd1306.c on the computer, against the made up bus and panel in fake_pico.c.
+//
+//   async_check
+//
+// - ssd1306_setup() turns the panel on and clears it, with DMA set up the way the I2C needs
+// - ssd1306_update_async() returns before any pixel is on the bus, busy until the last word is sent
+// - done is called once, from the DMA interrupt, after the last word, and straight away when
+//   nothing changed
+// - a blocking command during an update waits for it instead of cutting in
+// - ssd1306_update() returns with the frame on the panel
+// - when the panel stops acking part way, what it shows isn't taken as sent, and the whole
+//   screen goes again once it answers, also when the abort is only seen at the next flush
+//
+// Prints what it checked and exits with 1 if anything was wrong.
+
+#include <stdio.h>
+#include <string.h>
+
+#include "ssd1306.h"
+#include "fake_pico.h"
+
+static int failed = 0;
+
+static void check(int ok, const char *what) {
+    printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+    if (!ok) {
+        failed = 1;
+    }
+}
+
+static ssd1306_t display;
+static fake_panel_t *panel;
+
+static int done_calls = 0;
+static int done_in_irq = 0;
+static long done_data_bytes = 0; // pixel bytes on the panel when done was called
+
+static void done(void) {
+    done_calls++;
+    done_in_irq = done_in_irq && fake_in_irq;
+    done_data_bytes = panel->data_bytes;
+}
+
+// the panel shows the buffer
+static int shows_buffer(void) {
+    int page;
+    for (page = 0; page < display.pages; page++) {
+        if (memcmp(fake_panel_page(panel, page), display.buffer + 1 + page * display.width, display.width)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void draw(int seed) {
+    int i;
+    ssd1306_clear(&display);
+    for (i = 0; i < 200; i++) {
+        ssd1306_drawPixel(&display, (i * 37 + seed * 11) % 128, (i * 13 + seed) % 32, 1);
+    }
+}
+
+static void checkSetup(void) {
+    panel = fake_panel_add(i2c0, SSD1306_ADDRESS);
+    memset(panel->ram, 0xA5, sizeof(panel->ram)); // whatever was left from before
+    bool ok = ssd1306_setup(&display, i2c0, SSD1306_ADDRESS, 128, 32);
+    check(ok && panel->on && panel->multiplex == 32 && panel->mode == 0 && shows_buffer()
+          && !ssd1306_busy(&display) && fake_errors == 0,
+          "ssd1306_setup() turns the panel on, 32 rows, cleared");
+}
+
+static void checkAsync(void) {
+    long before = panel->bytes;
+    int steps = 0;
+    done_calls = 0;
+    done_in_irq = 1;
+    draw(1);
+    ssd1306_update_async(&display, done);
+    check(panel->bytes == before && ssd1306_busy(&display) && done_calls == 0,
+          "ssd1306_update_async() returns before anything is sent, and is busy");
+
+    while (fake_dma_step(16)) {
+        steps++;
+        if (done_calls || !ssd1306_busy(&display)) {
+            break;
+        }
+    }
+    fake_dma_finish();
+    check(done_calls == 1 && done_in_irq && done_data_bytes == panel->data_bytes && !ssd1306_busy(&display),
+          "done is called once, from the interrupt, after the last byte, then not busy");
+    check(shows_buffer() && fake_errors == 0, "the panel shows the frame");
+    printf("     the frame was %d bytes, %.1f ms of I2C at 400kHz, sent over %d steps\n",
+           ssd1306_update_size(&display), ssd1306_update_size(&display) * 9 / 400.0, steps + 1);
+
+    // the same frame again
+    before = panel->bytes;
+    done_calls = 0;
+    ssd1306_update_async(&display, done);
+    check(done_calls == 1 && panel->bytes == before && !ssd1306_busy(&display) && ssd1306_update_size(&display) == 0,
+          "nothing changed: done straight away and nothing sent");
+
+    // a NULL done
+    draw(2);
+    ssd1306_update_async(&display, NULL);
+    fake_dma_finish();
+    check(shows_buffer() && fake_errors == 0, "done can be NULL");
+}
+
+static void checkBlocking(void) {
+    draw(3);
+    ssd1306_update_async(&display, NULL);
+    fake_dma_step(20);
+    long spins = fake_spins;
+    ssd1306_command(&display, SSD1306_SETCONTRAST);
+    ssd1306_command(&display, 0x8F);
+    check(fake_spins > spins && !ssd1306_busy(&display) && shows_buffer() && fake_errors == 0,
+          "a command during an update waits for it, no collision on the bus");
+
+    draw(4);
+    ssd1306_update(&display);
+    check(!ssd1306_busy(&display) && shows_buffer() && fake_errors == 0, "ssd1306_update() returns with the frame shown");
+}
+
+static void checkUnplugged(void) {
+    draw(5);
+    ssd1306_update_async(&display, NULL);
+    fake_dma_step(100);
+    panel->unplugged = true;
+    fake_dma_finish();
+    int kept = memcmp(display.shown, display.front, 128 * 4) != 0 && display.full && !ssd1306_busy(&display);
+    panel->unplugged = false;
+    ssd1306_update(&display);
+    check(kept && shows_buffer() && ssd1306_update_size(&display) == SSD1306_ADDR_CMDS + 1 + 128 * 4 && fake_errors == 0,
+          "a panel that stops acking gets the whole screen once it answers again");
+
+    // an abort that came after the interrupt, while the last bytes left the FIFO
+    draw(6);
+    ssd1306_update(&display);
+    i2c0->hw.raw_intr_stat |= I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS;
+    ssd1306_update(&display);
+    check(shows_buffer() && ssd1306_update_size(&display) == SSD1306_ADDR_CMDS + 1 + 128 * 4 && fake_errors == 0,
+          "an abort still latched at the next flush sends the whole screen");
+}
+
+int main() {
+    checkSetup();
+    checkAsync();
+    checkBlocking();
+    checkUnplugged();
+    return failed;
+}
@@ -0,0 +1,177 @@
+// Checks the dirty page and column tracking in ssd1306.c on the computer, counting the bytes
+// that reach the made up panel in fake_pico.c.
+//
+//   dirty_check
+//
+// - ssd1306_dirty_spans() finds the first and last changed column of every page, against a loop
+//   over the bytes, for random changes
+// - after every flush the panel shows the frame: no change is missed
+// - the bytes on the bus are what ssd1306_update_size() says, and what the changed windows cost,
+//   or a whole screen when that is cheaper
+// - the first update after setup sends everything
+// - the hw13 attitude lines moving and the hw7 fps digits changing are a few dozen bytes
+//
+// Prints what it checked and exits with 1 if anything was wrong.
+
+#include <stdio.h>
+#include <string.h>
+
+#include "ssd1306.h"
+#include "draw.h"
+#include "text.h"
+#include "fake_pico.h"
+
+static int failed = 0;
+
+static void check(int ok, const char *what) {
+    printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+    if (!ok) {
+        failed = 1;
+    }
+}
+
+static uint32_t noise = 1;
+
+static uint32_t random32(void) {
+    noise = noise * 1664525 + 1013904223;
+    return noise >> 8;
+}
+
+static ssd1306_t display;
+static fake_panel_t *panel;
+
+static int shows_buffer(void) {
+    int page;
+    for (page = 0; page < display.pages; page++) {
+        if (memcmp(fake_panel_page(panel, page), display.buffer + 1 + page * display.width, display.width)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// what a flush of now over shown should cost, worked out column by column
+static int expected_bytes(const unsigned char *now, const unsigned char *shown, int width, int pages, int spans[][2]) {
+    int page, x;
+    int words = 0;
+    for (page = 0; page < pages; page++) {
+        spans[page][0] = -1;
+        spans[page][1] = -1;
+        for (x = 0; x < width; x++) {
+            if (now[x + page * width] != shown[x + page * width]) {
+                if (spans[page][0] < 0) {
+                    spans[page][0] = x;
+                }
+                spans[page][1] = x;
+            }
+        }
+        if (spans[page][0] >= 0) {
+            words += SSD1306_ADDR_CMDS + 1 + spans[page][1] - spans[page][0] + 1;
+        }
+    }
+    return words;
+}
+
+// a flush of the buffer, the bytes it put on the bus
+static long flush(void) {
+    long before = panel->bytes;
+    ssd1306_update(&display);
+    return panel->bytes - before;
+}
+
+static void checkSpans(void) {
+    static unsigned char now[SSD1306_MAX_WIDTH * SSD1306_MAX_PAGES], shown[SSD1306_MAX_WIDTH * SSD1306_MAX_PAGES];
+    int spans[SSD1306_MAX_PAGES][2], want[SSD1306_MAX_PAGES][2];
+    int r, i;
+    int ok = 1;
+    for (r = 0; r < 5000; r++) {
+        int width = 1 + random32() % 128;
+        int pages = 1 + random32() % 8;
+        int changes = random32() % 12;
+        for (i = 0; i < width * pages; i++) {
+            shown[i] = now[i] = random32();
+        }
+        for (i = 0; i < changes; i++) {
+            now[random32() % (width * pages)] ^= 1 << (random32() % 8);
+        }
+        int words = ssd1306_dirty_spans(now, shown, width, pages, spans);
+        ok = ok && words == expected_bytes(now, shown, width, pages, want) && !memcmp(spans, want, pages * sizeof(spans[0]));
+    }
+    check(ok, "ssd1306_dirty_spans() finds the changed columns of each page");
+}
+
+static void checkFlushes(void) {
+    int spans[SSD1306_MAX_PAGES][2];
+    int r, i;
+    int shown = 1, counted = 1, cheapest = 1;
+    int whole = SSD1306_ADDR_CMDS + 1 + 128 * 4;
+
+    panel = fake_panel_add(i2c0, SSD1306_ADDRESS);
+    ssd1306_setup(&display, i2c0, SSD1306_ADDRESS, 128, 32);
+    check(ssd1306_update_size(&display) == whole && panel->data_bytes == 128 * 4, "setup sends the whole screen");
+
+    for (r = 0; r < 2000; r++) {
+        // a few pixels, a run along a page, or most of the screen
+        int changes = (r % 10 == 9) ? 600 : random32() % 20;
+        for (i = 0; i < changes; i++) {
+            ssd1306_drawPixel(&display, random32() % 128, random32() % 32, random32() & 1);
+        }
+        if (r % 7 == 3) {
+            ssd1306_hline(&display, random32() % 128, random32() % 128, random32() % 32, random32() & 1);
+        }
+        int want = expected_bytes(display.buffer + 1, display.shown, 128, 4, spans);
+        if (want >= whole) {
+            want = whole;
+        }
+        long bytes = flush();
+        shown = shown && shows_buffer();
+        counted = counted && bytes == ssd1306_update_size(&display);
+        cheapest = cheapest && bytes == want;
+    }
+    check(shown && fake_errors == 0, "after every flush the panel shows the frame");
+    check(counted, "the bytes on the bus are ssd1306_update_size()");
+    check(cheapest, "only the changed windows are sent, or the whole screen when that is cheaper");
+}
+
+// the screens the homeworks draw, one frame after another
+static void checkTypical(void) {
+    int i;
+    long most = 0, total = 0;
+    // the first frame of each changes whatever was on the screen before, so it is left out
+    // hw13: a line down and a line across from the middle, moving a little each frame
+    for (i = 0; i < 100; i++) {
+        ssd1306_clear(&display);
+        ssd1306_vline(&display, 64, 16, 16 + (i * 7) % 16, 1);
+        ssd1306_hline(&display, 64, 64 + (i * 5) % 60 - 30, 16, 1);
+        long bytes = flush();
+        if (i > 0) {
+            most = bytes > most ? bytes : most;
+            total += bytes;
+        }
+    }
+    printf("     hw13 attitude lines: %ld bytes a frame on average, %ld at most\n", total / 99, most);
+    int lines = most < 100;
+
+    // hw7: the voltage and the fps, the digits change every frame
+    most = 0;
+    total = 0;
+    for (i = 0; i < 100; i++) {
+        ssd1306_clear(&display);
+        drawPrintf(&display, 0, 0, "V: %.3f", 1.6 + (i % 3) * 0.001);
+        drawPrintf(&display, 0, 24, "fps: %.3f", 70 + i * 0.137);
+        long bytes = flush();
+        if (i > 0) {
+            most = bytes > most ? bytes : most;
+            total += bytes;
+        }
+    }
+    printf("     hw7 fps screen: %ld bytes a frame on average, %ld at most\n", total / 99, most);
+    check(lines && most < 100 && fake_errors == 0, "the hw13 and hw7 screens are a few dozen bytes a frame, not 520");
+}
+
+int main() {
+    checkSpans();
+    checkFlushes();
+    checkTypical();
+    return failed;
+}
@@ -0,0 +1,401 @@
+// The pico SDK calls the display library makes, for the computer. See fake_pico.h.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fake_pico.h"
+#include "hardware/irq.h"
+#include "pico/sync.h"
+#include "pico/stdlib.h"
+
+#define FAKE_PANELS 8
+#define FAKE_CHANNELS 12
+#define FAKE_SPIN_LIMIT 1000000 // spins with nothing running, the wait would never end on the pico
+
+i2c_inst_t i2c0_inst = {.hw.status = I2C_IC_STATUS_TFE_BITS, .index = 0};
+i2c_inst_t i2c1_inst = {.hw.status = I2C_IC_STATUS_TFE_BITS, .index = 1};
+
+int fake_errors = 0;
+long fake_spins = 0;
+bool fake_in_irq = false;
+long fake_bus_bytes[2];
+
+typedef struct fake_channel {
+    bool claimed;
+    bool irq1_enabled;
+    bool irq1_status;
+    const uint16_t *src;
+    unsigned int left;
+    i2c_inst_t *i2c;
+} fake_channel_t;
+
+// one bus, between a start and a stop
+typedef struct fake_bus {
+    bool open;
+    bool control; // the next byte is the control byte
+    uint8_t mode; // the control byte, 0x00 commands or 0x40 data
+    fake_panel_t *panel;
+} fake_bus_t;
+
+static fake_panel_t panels[FAKE_PANELS];
+static int panel_count = 0;
+static fake_channel_t channels[FAKE_CHANNELS];
+static fake_bus_t buses[2];
+static irq_handler_t dma_irq1_handler = NULL;
+static bool dma_irq1_enabled = false;
+static long idle_spins = 0;
+
+static void fake_error(const char *what) {
+    if (fake_errors < 10) {
+        printf("     fake pico: %s\n", what);
+    }
+    fake_errors++;
+}
+
+fake_panel_t *fake_panel_add(i2c_inst_t *i2c, uint8_t address) {
+    fake_panel_t *p = &panels[panel_count++];
+    memset(p, 0, sizeof(*p));
+    p->i2c = i2c;
+    p->address = address;
+    p->multiplex = 64;
+    p->mode = 2; // page addressing after reset
+    p->page1 = FAKE_PANEL_PAGES - 1;
+    p->col1 = FAKE_PANEL_WIDTH - 1;
+    return p;
+}
+
+const uint8_t *fake_panel_page(fake_panel_t *p, int page) {
+    return p->ram[page];
+}
+
+// arguments after each command byte, for the commands the library sends
+static int command_args(uint8_t c) {
+    switch (c) {
+    case 0x21: // COLUMNADDR
+    case 0x22: // PAGEADDR
+        return 2;
+    case 0x20: // MEMORYMODE
+    case 0x81: // SETCONTRAST
+    case 0x8D: // CHARGEPUMP
+    case 0xA8: // SETMULTIPLEX
+    case 0xD3: // SETDISPLAYOFFSET
+    case 0xD5: // SETDISPLAYCLOCKDIV
+    case 0xD9: // SETPRECHARGE
+    case 0xDA: // SETCOMPINS
+    case 0xDB: // SETVCOMDETECT
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+static void panel_command(fake_panel_t *p, uint8_t b) {
+    if (p->args_left == 0) {
+        p->cmd = b;
+        p->args_left = command_args(b);
+        if (b == 0xAE || b == 0xAF) {
+            p->on = b == 0xAF;
+        }
+        return;
+    }
+    p->args[command_args(p->cmd) - p->args_left] = b;
+    p->args_left--;
+    if (p->args_left) {
+        return;
+    }
+    if (p->cmd == 0x20) {
+        p->mode = p->args[0] & 3;
+    } else if (p->cmd == 0xA8) {
+        p->multiplex = (p->args[0] & 0x3F) + 1;
+    } else if (p->cmd == 0x21) {
+        p->col0 = p->args[0] & 0x7F;
+        p->col1 = p->args[1] & 0x7F;
+        p->col = p->col0;
+    } else if (p->cmd == 0x22) {
+        p->page0 = p->args[0] & 7;
+        p->page1 = p->args[1] & 7;
+        p->page = p->page0;
+    }
+}
+
+// a pixel byte goes at the pointer, which moves along the window's columns then down its pages
+static void panel_data(fake_panel_t *p, uint8_t b) {
+    if (p->mode != 0) {
+        fake_error("pixel data before horizontal addressing was set");
+        return;
+    }
+    p->ram[p->page][p->col] = b;
+    p->data_bytes++;
+    if (p->col != p->col1) {
+        p->col = (p->col + 1) % FAKE_PANEL_WIDTH;
+        return;
+    }
+    p->col = p->col0;
+    p->page = (p->page == p->page1) ? p->page0 : (p->page + 1) % FAKE_PANEL_PAGES;
+}
+
+// one byte on the bus, with a start before it if the last one had a stop
+static void bus_byte(i2c_inst_t *i2c, uint8_t b, bool stop) {
+    fake_bus_t *bus = &buses[i2c->index];
+    int i;
+    if (i2c->hw.raw_intr_stat & I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS) {
+        return; // the TX FIFO is flushed until the abort is cleared
+    }
+    if (!bus->open) {
+        bus->open = true;
+        bus->control = true;
+        bus->panel = NULL;
+        for (i = 0; i < panel_count; i++) {
+            if (panels[i].i2c == i2c && panels[i].address == (i2c->hw.tar & 0x7F)) {
+                bus->panel = &panels[i];
+                panels[i].transactions++;
+            }
+        }
+        if (!bus->panel) {
+            fake_error("nothing at that address");
+        }
+    }
+    if (bus->panel && bus->panel->unplugged) {
+        i2c->hw.raw_intr_stat |= I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS;
+        bus->open = false;
+        return;
+    }
+    fake_bus_bytes[i2c->index]++;
+    if (bus->panel) {
+        bus->panel->bytes++;
+        if (bus->control) {
+            bus->control = false;
+            bus->mode = b;
+            if (b != 0x00 && b != 0x40) {
+                fake_error("a control byte that is not 0x00 or 0x40");
+            }
+        } else if (bus->mode == 0x40) {
+            panel_data(bus->panel, b);
+        } else {
+            panel_command(bus->panel, b);
+        }
+    }
+    if (stop) {
+        bus->open = false;
+    }
+}
+
+static fake_channel_t *bus_channel(i2c_inst_t *i2c) {
+    int i;
+    for (i = 0; i < FAKE_CHANNELS; i++) {
+        if (channels[i].left && channels[i].i2c == i2c) {
+            return &channels[i];
+        }
+    }
+    return NULL;
+}
+
+static void update_status(i2c_inst_t *i2c) {
+    i2c->hw.status = bus_channel(i2c) ? I2C_IC_STATUS_ACTIVITY_BITS : I2C_IC_STATUS_TFE_BITS;
+}
+
+// move up to words words on each running channel, then run the interrupt for the ones that finished.
+// returns how many channels are still running
+int fake_dma_step(int words) {
+    int i, n;
+    bool finished = false;
+    for (i = 0; i < FAKE_CHANNELS; i++) {
+        fake_channel_t *ch = &channels[i];
+        if (!ch->left) {
+            continue;
+        }
+        i2c_hw_t *hw = &ch->i2c->hw;
+        for (n = 0; n < words && ch->left; n++) {
+            if (!hw->enable || !(hw->dma_cr & I2C_IC_DMA_CR_TDMAE_BITS)) {
+                fake_error("DMA into an I2C that is disabled or has TX DMA off");
+            }
+            hw->data_cmd = *ch->src++;
+            ch->left--;
+            bus_byte(ch->i2c, hw->data_cmd & 0xFF, hw->data_cmd & I2C_IC_DATA_CMD_STOP_BITS);
+        }
+        if (!ch->left) {
+            if (buses[ch->i2c->index].open) {
+                fake_error("a transfer ended without a stop");
+            }
+            update_status(ch->i2c);
+            if (ch->irq1_enabled) {
+                ch->irq1_status = true;
+                finished = true;
+            }
+        }
+    }
+    if (finished && dma_irq1_handler && dma_irq1_enabled) {
+        fake_in_irq = true;
+        dma_irq1_handler();
+        fake_in_irq = false;
+        for (i = 0; i < FAKE_CHANNELS; i++) {
+            if (channels[i].irq1_status) {
+                fake_error("the interrupt was left set, the handler would run forever");
+                channels[i].irq1_status = false;
+            }
+        }
+    }
+    return fake_dma_running();
+}
+
+void fake_dma_finish(void) {
+    while (fake_dma_step(64)) {
+    }
+}
+
+int fake_dma_running(void) {
+    int i;
+    int running = 0;
+    for (i = 0; i < FAKE_CHANNELS; i++) {
+        running += channels[i].left > 0;
+    }
+    return running;
+}
+
+i2c_hw_t *i2c_get_hw(i2c_inst_t *i2c) {
+    return &i2c->hw;
+}
+
+unsigned int i2c_get_dreq(i2c_inst_t *i2c, bool is_tx) {
+    return 32 + 2 * i2c->index + !is_tx; // DREQ_I2C0_TX is 32
+}
+
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop) {
+    size_t i;
+    if (bus_channel(i2c) || buses[i2c->index].open) {
+        fake_error("a blocking write while DMA is still sending on the bus");
+    }
+    if (i2c->hw.dma_cr) {
+        fake_error("a blocking write with TX DMA still on");
+    }
+    i2c->hw.tar = addr;
+    for (i = 0; i < len; i++) {
+        bus_byte(i2c, src[i], !nostop && i == len - 1);
+    }
+    if (i2c->hw.raw_intr_stat & I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS) {
+        i2c->hw.raw_intr_stat &= ~I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS; // the SDK clears it
+        return PICO_ERROR_GENERIC;
+    }
+    return (int)len;
+}
+
+int dma_claim_unused_channel(bool required) {
+    int i;
+    for (i = 0; i < FAKE_CHANNELS; i++) {
+        if (!channels[i].claimed) {
+            channels[i].claimed = true;
+            return i;
+        }
+    }
+    if (required) {
+        fake_error("out of DMA channels");
+    }
+    return -1;
+}
+
+void dma_channel_set_irq1_enabled(unsigned int channel, bool enabled) {
+    channels[channel].irq1_enabled = enabled;
+}
+
+bool dma_channel_get_irq1_status(unsigned int channel) {
+    return channels[channel].irq1_status;
+}
+
+void dma_channel_acknowledge_irq1(unsigned int channel) {
+    channels[channel].irq1_status = false;
+}
+
+dma_channel_config dma_channel_get_default_config(unsigned int channel) {
+    dma_channel_config c = {DMA_SIZE_32, true, false, 0x3F};
+    (void)channel;
+    return c;
+}
+
+void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size size) {
+    c->size = size;
+}
+
+void channel_config_set_read_increment(dma_channel_config *c, bool incr) {
+    c->read_increment = incr;
+}
+
+void channel_config_set_write_increment(dma_channel_config *c, bool incr) {
+    c->write_increment = incr;
+}
+
+void channel_config_set_dreq(dma_channel_config *c, unsigned int dreq) {
+    c->dreq = dreq;
+}
+
+// only what the library does is modelled: 16 bit words from memory into an I2C's data_cmd
+void dma_channel_configure(unsigned int channel, const dma_channel_config *config, volatile void *write_addr,
+                           const volatile void *read_addr, unsigned int transfer_count, bool trigger) {
+    fake_channel_t *ch = &channels[channel];
+    i2c_inst_t *i2c = NULL;
+    if (write_addr == &i2c0_inst.hw.data_cmd) {
+        i2c = i2c0;
+    } else if (write_addr == &i2c1_inst.hw.data_cmd) {
+        i2c = i2c1;
+    }
+    if (!ch->claimed || ch->left) {
+        fake_error("a DMA channel that is not claimed or still running");
+    }
+    if (!i2c || config->size != DMA_SIZE_16 || !config->read_increment || config->write_increment
+        || config->dreq != i2c_get_dreq(i2c, true)) {
+        fake_error("DMA not set up as 16 bit words into an I2C TX FIFO");
+        return;
+    }
+    if (bus_channel(i2c)) {
+        fake_error("two DMA channels sending on one bus");
+    }
+    i2c->hw.raw_intr_stat &= ~I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS; // see fake_pico.h
+    ch->i2c = i2c;
+    ch->src = (const uint16_t *)read_addr;
+    ch->left = trigger ? transfer_count : 0;
+    update_status(i2c);
+}
+
+void irq_add_shared_handler(unsigned int num, irq_handler_t handler, uint8_t order_priority) {
+    (void)order_priority;
+    if (num != DMA_IRQ_1 || dma_irq1_handler) {
+        fake_error("only one DMA_IRQ_1 handler is modelled");
+    }
+    dma_irq1_handler = handler;
+}
+
+void irq_set_enabled(unsigned int num, bool enabled) {
+    if (num == DMA_IRQ_1) {
+        dma_irq1_enabled = enabled;
+    }
+}
+
+void critical_section_init(critical_section_t *crit_sec) {
+    crit_sec->held = false;
+}
+
+void critical_section_enter_blocking(critical_section_t *crit_sec) {
+    if (crit_sec->held) {
+        fake_error("a critical section entered while it was held");
+    }
+    crit_sec->held = true;
+}
+
+void critical_section_exit(critical_section_t *crit_sec) {
+    crit_sec->held = false;
+}
+
+void sleep_ms(uint32_t ms) {
+    (void)ms;
+}
+
+// a busy wait, the hardware carries on meanwhile
+void tight_loop_contents(void) {
+    fake_spins++;
+    if (fake_dma_step(1)) {
+        idle_spins = 0;
+    } else if (++idle_spins > FAKE_SPIN_LIMIT) {
+        printf("FAIL waiting with nothing being sent, this would never return on the pico\n");
+        exit(1);
+    }
+}
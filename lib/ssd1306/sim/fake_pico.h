@@ -0,0 +1,48 @@
+#ifndef FAKE_PICO_H__
+#define FAKE_PICO_H__
+
+// the made up hardware behind the pico headers in include/, for checking the display library
+// on the computer: two I2C buses with SSD1306 panels on them, and DMA channels that move a
+// word at a time when told to, running the DMA_IRQ_1 handler when they finish.
+// there is no I2C FIFO, a word the DMA moves is on the bus straight away.
+// a panel that is unplugged doesn't ack, which latches TX_ABRT and the I2C drops every word
+// after that. reading clr_tx_abrt can't be seen here, so the latch is cleared when the next
+// transfer is set up, as the library does just before
+
+#include "hardware/i2c.h"
+#include "hardware/dma.h"
+
+#define FAKE_PANEL_PAGES 8
+#define FAKE_PANEL_WIDTH 128
+
+// what an SSD1306 on the bus has been sent, in horizontal addressing mode
+typedef struct fake_panel {
+    i2c_inst_t *i2c;
+    uint8_t address;
+    uint8_t ram[FAKE_PANEL_PAGES][FAKE_PANEL_WIDTH]; // ram[page][column], the top row in bit 0
+    bool unplugged; // doesn't ack
+    bool on; // DISPLAYON
+    int multiplex; // SETMULTIPLEX + 1, the rows in use
+    int mode; // MEMORYMODE, only 0 (horizontal) is modelled
+    int page0, page1, col0, col1; // the window from PAGEADDR and COLUMNADDR
+    int page, col; // where the next data byte goes
+    uint8_t cmd; // a command waiting for arguments
+    int args_left;
+    uint8_t args[2];
+    long bytes; // every byte after the address, control bytes included
+    long data_bytes; // pixel bytes
+    long transactions;
+} fake_panel_t;
+
+fake_panel_t *fake_panel_add(i2c_inst_t *i2c, uint8_t address);
+int fake_dma_step(int words);
+void fake_dma_finish(void);
+int fake_dma_running(void);
+const uint8_t *fake_panel_page(fake_panel_t *p, int page);
+
+extern int fake_errors; // things the hardware would not have done as the library meant
+extern long fake_spins; // tight_loop_contents() calls, each moves every running channel on a word
+extern bool fake_in_irq; // the DMA_IRQ_1 handler is running
+extern long fake_bus_bytes[2]; // bytes on each bus, address bytes not counted
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef HARDWARE_I2C_H
+#define HARDWARE_I2C_H
+
+// the part of the pico SDK's hardware/i2c.h the display library uses, for the computer.
+// the registers are plain memory, fake_pico.c acts on them
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define I2C_IC_DATA_CMD_STOP_BITS 0x00000200
+#define I2C_IC_DMA_CR_TDMAE_BITS 0x00000002
+#define I2C_IC_STATUS_TFE_BITS 0x00000004
+#define I2C_IC_STATUS_ACTIVITY_BITS 0x00000001
+#define I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS 0x00000040
+#define PICO_ERROR_GENERIC -1
+
+typedef struct {
+    volatile uint32_t enable;
+    volatile uint32_t tar;
+    volatile uint32_t status;
+    volatile uint32_t raw_intr_stat;
+    volatile uint32_t clr_tx_abrt;
+    volatile uint32_t dma_cr;
+    volatile uint32_t data_cmd;
+} i2c_hw_t;
+
+typedef struct i2c_inst {
+    i2c_hw_t hw;
+    int index;
+} i2c_inst_t;
+
+extern i2c_inst_t i2c0_inst;
+extern i2c_inst_t i2c1_inst;
+#define i2c0 (&i2c0_inst)
+#define i2c1 (&i2c1_inst)
+
+i2c_hw_t *i2c_get_hw(i2c_inst_t *i2c);
+unsigned int i2c_get_dreq(i2c_inst_t *i2c, bool is_tx);
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop);
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef HARDWARE_IRQ_H
+#define HARDWARE_IRQ_H
+
+// the part of the pico SDK's hardware/irq.h the display library uses, for the computer
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define DMA_IRQ_1 12
+#define PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY 0x80
+
+typedef void (*irq_handler_t)(void);
+
+void irq_add_shared_handler(unsigned int num, irq_handler_t handler, uint8_t order_priority);
+void irq_set_enabled(unsigned int num, bool enabled);
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef PICO_STDLIB_H
+#define PICO_STDLIB_H
+
+// the part of the pico SDK's pico/stdlib.h the display library uses, for the computer
+
+#include <stdint.h>
+#include <stdbool.h>
+
+void sleep_ms(uint32_t ms);
+void tight_loop_contents(void);
+
+#endif
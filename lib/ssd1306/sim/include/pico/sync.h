@@ -0,0 +1,17 @@
+#ifndef PICO_SYNC_H
+#define PICO_SYNC_H
+
+// critical sections for the computer. nothing runs at the same time here, so they only
+// count, fake_pico.c flags one entered twice, which would hang the pico
+
+#include <stdbool.h>
+
+typedef struct {
+    bool held;
+} critical_section_t;
+
+void critical_section_init(critical_section_t *crit_sec);
+void critical_section_enter_blocking(critical_section_t *crit_sec);
+void critical_section_exit(critical_section_t *crit_sec);
+
+#endif
@@ -0,0 +1,256 @@
+// Checks the shared display library on the computer: several displays, the busy rules and the
+// shapes in draw.c, against the made up buses and panels in fake_pico.c.
+//
+//   lib_check
+//
+// - ssd1306_setup() takes the sizes in ssd1306.h and no others, up to SSD1306_MAX_DEVICES displays,
+//   each with its own DMA channel, and 128x64 panels get 64 rows
+// - two displays on one bus take turns, a display on the other bus sends at the same time
+// - ssd1306_flush_async() on a busy bus returns false straight away, without waiting, and the
+//   transfer going on is left alone
+// - what the driver thinks the display shows only changes once the DMA has sent it
+// - a flush can be started from the done callback, in the interrupt
+// - the lines and shapes in draw.c set the same pixels as ssd1306_drawPixel() loops, clipped
+//
+// Prints what it checked and exits with 1 if anything was wrong.
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "ssd1306.h"
+#include "draw.h"
+#include "fake_pico.h"
+
+static int failed = 0;
+
+static void check(int ok, const char *what) {
+    printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+    if (!ok) {
+        failed = 1;
+    }
+}
+
+static uint32_t noise = 1;
+
+static uint32_t random32(void) {
+    noise = noise * 1664525 + 1013904223;
+    return noise >> 8;
+}
+
+static ssd1306_t a, b, c, d, e;
+static fake_panel_t *panel_a, *panel_b, *panel_c, *panel_d;
+
+static int shows(fake_panel_t *p, ssd1306_t *s, const unsigned char *frame) {
+    int page;
+    for (page = 0; page < s->pages; page++) {
+        if (memcmp(fake_panel_page(p, page), frame + page * s->width, s->width)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void scribble(ssd1306_t *s) {
+    int i;
+    for (i = 1; i <= s->width * s->pages; i++) {
+        s->buffer[i] = random32();
+    }
+}
+
+static int done_calls = 0;
+
+static void done(void) {
+    done_calls++;
+}
+
+// from the interrupt, start b as soon as a is done
+static void chain(void) {
+    done_calls++;
+    if (!ssd1306_flush_async(&b, done)) {
+        done_calls = -100;
+    }
+}
+
+static void checkSetup(void) {
+    static const int sizes[][2] = {{0, 32}, {129, 32}, {128, 0}, {128, 7}, {128, 12}, {128, 72}};
+    int i;
+    int ok = 1;
+    panel_a = fake_panel_add(i2c0, 0x3C);
+    panel_b = fake_panel_add(i2c0, 0x3D);
+    panel_c = fake_panel_add(i2c1, 0x3C);
+    panel_d = fake_panel_add(i2c1, 0x3D);
+    fake_panel_add(i2c1, 0x3E);
+    for (i = 0; i < 6; i++) {
+        ok = ok && !ssd1306_setup(&a, i2c0, 0x3C, sizes[i][0], sizes[i][1]);
+    }
+    check(ok && panel_a->bytes == 0, "ssd1306_setup() turns down sizes it can't drive and sends nothing");
+
+    ok = ssd1306_setup(&a, i2c0, 0x3C, 128, 32) && ssd1306_setup(&b, i2c0, 0x3D, 128, 64)
+         && ssd1306_setup(&c, i2c1, 0x3C, 64, 48) && ssd1306_setup(&d, i2c1, 0x3D, 128, 64);
+    ok = ok && !ssd1306_setup(&e, i2c1, 0x3E, 128, 32);
+    // a display already set up can be set up again without taking another place
+    ok = ok && ssd1306_setup(&a, i2c0, 0x3C, 128, 32);
+    check(ok, "four displays, a fifth is turned down, setting one up again is fine");
+    check(a.dma != b.dma && a.dma != c.dma && a.dma != d.dma && b.dma != c.dma && b.dma != d.dma && c.dma != d.dma,
+          "each display has its own DMA channel");
+    check(panel_a->multiplex == 32 && panel_b->multiplex == 64 && panel_c->multiplex == 48
+          && ssd1306_update_size(&b) == SSD1306_ADDR_CMDS + 1 + 128 * 8 && fake_errors == 0,
+          "each panel gets its own rows, a whole 128x64 screen is 1032 bytes");
+}
+
+static void checkBuses(void) {
+    scribble(&a);
+    scribble(&b);
+    scribble(&c);
+    ssd1306_update_async(&a, NULL);
+    long spins = fake_spins;
+    bool b_started = ssd1306_update_async(&b, done);
+    bool c_started = ssd1306_update_async(&c, NULL);
+    check(!b_started && fake_spins == spins && ssd1306_busy(&b) && fake_dma_running() == 2,
+          "a display on a busy bus doesn't start or wait, one on the other bus starts");
+    check(memcmp(b.shown, b.front, 128 * 8) && memcmp(a.shown, a.front, 128 * 4) && done_calls == 0,
+          "shown is left alone while the transfer is going");
+    fake_dma_finish();
+    check(shows(panel_a, &a, a.front) && shows(panel_c, &c, c.front) && !memcmp(a.shown, a.front, 128 * 4)
+          && !memcmp(c.shown, c.front, 64 * 6) && done_calls == 0 && c_started,
+          "once sent, the panels show the frames and shown has them");
+
+    // the frame b presented goes with its next flush
+    check(ssd1306_flush_async(&b, done) && !ssd1306_flush_async(&a, NULL), "b's presented frame goes next, a waits");
+    fake_dma_finish();
+    check(shows(panel_b, &b, b.front) && done_calls == 1 && !memcmp(b.shown, b.front, 128 * 8) && fake_errors == 0,
+          "b's frame is on its panel");
+
+    // a busy flush leaves the transfer going alone
+    static unsigned char first[128 * 4];
+    scribble(&a);
+    ssd1306_update_async(&a, NULL);
+    memcpy(first, a.front, sizeof(first));
+    fake_dma_step(30);
+    scribble(&a);
+    spins = fake_spins;
+    done_calls = 0;
+    bool started = ssd1306_update_async(&a, done);
+    fake_dma_finish();
+    check(!started && done_calls == 0 && fake_spins == spins && shows(panel_a, &a, first),
+          "ssd1306_flush_async() on a busy bus returns false at once and the transfer carries on");
+    ssd1306_update(&a);
+    check(shows(panel_a, &a, a.front) && fake_errors == 0, "ssd1306_update() then sends the newer frame");
+
+    // a flush from the done callback, in the interrupt
+    scribble(&a);
+    scribble(&b);
+    done_calls = 0;
+    ssd1306_present(&b);
+    ssd1306_update_async(&a, chain);
+    fake_dma_finish();
+    check(done_calls == 2 && shows(panel_a, &a, a.front) && shows(panel_b, &b, b.front) && fake_errors == 0,
+          "a flush started from the done callback goes straight after");
+}
+
+// the shapes against ssd1306_drawPixel() loops on a copy
+static ssd1306_t ref;
+
+static void plot(int x, int y, unsigned char color) {
+    ssd1306_drawPixel(&ref, x, y, color);
+}
+
+static void line_ref(int x0, int y0, int x1, int y1, unsigned char color) {
+    int dx = abs(x1 - x0), sx = x0 < x1 ? 1 : -1;
+    int dy = -abs(y1 - y0), sy = y0 < y1 ? 1 : -1;
+    int err = dx + dy;
+    while (true) {
+        plot(x0, y0, color);
+        if (x0 == x1 && y0 == y1) {
+            break;
+        }
+        int e2 = 2 * err;
+        if (e2 >= dy) {
+            err += dy;
+            x0 += sx;
+        }
+        if (e2 <= dx) {
+            err += dx;
+            y0 += sy;
+        }
+    }
+}
+
+static void circle_ref(int cx, int cy, int r, unsigned char color) {
+    int x, y;
+    // every pixel within half a pixel of the circle, checked the other way round below
+    for (y = -r; y <= r; y++) {
+        for (x = -r; x <= r; x++) {
+            int dd = x * x + y * y;
+            if ((r == 0 || dd > (r - 1) * (r - 1)) && dd < (r + 1) * (r + 1)) {
+                plot(cx + x, cy + y, color);
+            }
+        }
+    }
+}
+
+static void checkShapes(void) {
+    int r, x, y;
+    int lines = 1, boxes = 1, circles = 1;
+    ref = d;
+    for (r = 0; r < 20000; r++) {
+        int x0 = (int)(random32() % 200) - 36, y0 = (int)(random32() % 100) - 18;
+        int x1 = (int)(random32() % 200) - 36, y1 = (int)(random32() % 100) - 18;
+        int w = (int)(random32() % 140) - 4, h = (int)(random32() % 80) - 4;
+        unsigned char color = random32() & 1;
+        if (r % 50 == 0) {
+            x1 = x0; // straight up and down, or across
+        }
+        if (r % 50 == 1) {
+            y1 = y0;
+        }
+        scribble(&d);
+        memcpy(ref.buffer, d.buffer, sizeof(d.buffer));
+        ssd1306_line(&d, x0, y0, x1, y1, color);
+        line_ref(x0, y0, x1, y1, color);
+        lines = lines && !memcmp(ref.buffer, d.buffer, sizeof(d.buffer));
+
+        ssd1306_fill_rect(&d, x0, y0, w, h, color);
+        ssd1306_rect(&d, x1, y1, w, h, !color);
+        for (y = y0; y < y0 + h; y++) {
+            for (x = x0; x < x0 + w; x++) {
+                plot(x, y, color);
+            }
+        }
+        for (y = y1; y < y1 + h; y++) {
+            for (x = x1; x < x1 + w; x++) {
+                if (x == x1 || x == x1 + w - 1 || y == y1 || y == y1 + h - 1) {
+                    plot(x, y, !color);
+                }
+            }
+        }
+        boxes = boxes && !memcmp(ref.buffer, d.buffer, sizeof(d.buffer));
+
+        // a midpoint circle is on the ring within a pixel, and the same both sides of its middle
+        ssd1306_clear(&d);
+        ssd1306_clear(&ref);
+        int radius = random32() % 40;
+        ssd1306_circle(&d, 64, 32, radius, 1);
+        circle_ref(64, 32, radius, 1);
+        for (y = 0; y < 64; y++) {
+            for (x = 0; x < 128; x++) {
+                int on = (d.buffer[1 + x + (y / 8) * 128] >> (y & 7)) & 1;
+                int near = (ref.buffer[1 + x + (y / 8) * 128] >> (y & 7)) & 1;
+                int mirror = (d.buffer[1 + (128 - x) % 128 + (y / 8) * 128] >> (y & 7)) & 1;
+                circles = circles && (!on || near) && (x == 0 || on == mirror);
+            }
+        }
+        circles = circles && ((d.buffer[1 + 64 + radius + 4 * 128] >> 0) & 1);
+    }
+    check(lines, "ssd1306_line() sets the pixels Bresenham with ssd1306_drawPixel() does, clipped");
+    check(boxes, "ssd1306_rect() and ssd1306_fill_rect() are the pixel loops, clipped");
+    check(circles, "ssd1306_circle() stays on the ring and is symmetric");
+}
+
+int main() {
+    checkSetup();
+    checkBuses();
+    checkShapes();
+    return failed;
+}
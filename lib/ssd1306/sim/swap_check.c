@@ -0,0 +1,149 @@
+// Checks the back and front buffers in ssd1306.c on the computer, with a renderer, a refresh
+// timer and the DMA taking turns at random against the made up bus and panel in fake_pico.c.
+//
+//   swap_check
+//
+// The renderer draws each frame a piece at a time, so the back buffer is half one frame and half
+// the next most of the time. The timer sends the front buffer whenever the bus is free, like the
+// hw7 timer callback, and the DMA moves a few words at a time in between.
+//
+// - ssd1306_present() copies the whole frame and leaves the back buffer as it was
+// - every finished transfer leaves the panel showing the whole frame that was presented when it
+//   started, never part of one frame and part of another or a half drawn one
+// - once drawing stops the panel ends up on the last frame presented
+// - the front buffer lock is never taken twice
+//
+// Prints what it checked and exits with 1 if anything was wrong.
+
+#include <stdio.h>
+#include <string.h>
+
+#include "ssd1306.h"
+#include "fake_pico.h"
+
+static int failed = 0;
+
+static void check(int ok, const char *what) {
+    printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+    if (!ok) {
+        failed = 1;
+    }
+}
+
+static uint32_t noise = 1;
+
+static uint32_t random32(void) {
+    noise = noise * 1664525 + 1013904223;
+    return noise >> 8;
+}
+
+#define PIECES 8 // the renderer draws a frame in this many goes
+
+static ssd1306_t display;
+static fake_panel_t *panel;
+
+// byte i of frame k: a band of pixels that moves along, and the frame number on one page
+static unsigned char frame_byte(int k, int i) {
+    int x = i % 128;
+    int page = i / 128;
+    if (page == k % 4 && x < 8) {
+        return k >> x;
+    }
+    return ((x + 128 - k % 128) % 128 < 10) ? 0x5A : 0;
+}
+
+static int panel_shows(int k) {
+    int i;
+    for (i = 0; i < 128 * 4; i++) {
+        if (fake_panel_page(panel, i / 128)[i % 128] != frame_byte(k, i)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int presented = 0; // the frame in the front buffer
+static int sending = -1; // the frame the transfer going now started with
+static int sent = 0; // transfers finished
+static int torn = 0;
+
+// the DMA interrupt: the transfer is done, the panel has to show a whole frame
+static void done(void) {
+    if (sending >= 0 && !panel_shows(sending)) {
+        torn++;
+    }
+    sent++;
+    sending = -1;
+}
+
+// the refresh timer, skips the tick if the last frame is still going
+static void timer_tick(void) {
+    if (!ssd1306_busy(&display)) {
+        sending = presented;
+        ssd1306_flush_async(&display, done);
+    }
+}
+
+static void checkPresent(void) {
+    static unsigned char before[sizeof(display.buffer)];
+    int i;
+    for (i = 0; i < 128 * 4; i++) {
+        display.buffer[1 + i] = random32();
+    }
+    memcpy(before, display.buffer, sizeof(before));
+    ssd1306_present(&display);
+    check(!memcmp(display.front, display.buffer + 1, 128 * 4) && !memcmp(before, display.buffer, sizeof(before)),
+          "ssd1306_present() copies the frame and leaves the back buffer as it was");
+}
+
+static void checkRace(void) {
+    int k = 1;
+    int piece = 0;
+    int events;
+    int i;
+    // frame 0 to start from
+    for (i = 0; i < 128 * 4; i++) {
+        display.buffer[1 + i] = frame_byte(0, i);
+    }
+    ssd1306_present(&display);
+    for (events = 0; events < 200000; events++) {
+        switch (random32() % 4) {
+        case 0:
+        case 1:
+            // draw the next piece of frame k into the back buffer
+            for (i = piece * 128 * 4 / PIECES; i < (piece + 1) * 128 * 4 / PIECES; i++) {
+                display.buffer[1 + i] = frame_byte(k, i);
+            }
+            if (++piece == PIECES) {
+                ssd1306_present(&display);
+                presented = k;
+                k++;
+                piece = 0;
+            }
+            break;
+        case 2:
+            timer_tick();
+            break;
+        default:
+            fake_dma_step(1 + random32() % 40);
+            break;
+        }
+    }
+    printf("     %d frames presented, %d transfers, %d torn\n", k - 1, sent, torn);
+    check(torn == 0 && sent > 100, "every transfer leaves the panel on one whole presented frame");
+
+    // drawing stops, the timer carries on
+    fake_dma_finish();
+    timer_tick();
+    fake_dma_finish();
+    check(panel_shows(presented), "the panel ends up on the last frame presented");
+    check(fake_errors == 0, "the front buffer lock is never taken twice, the bus is never shared");
+}
+
+int main() {
+    panel = fake_panel_add(i2c0, SSD1306_ADDRESS);
+    ssd1306_setup(&display, i2c0, SSD1306_ADDRESS, 128, 32);
+    checkPresent();
+    checkRace();
+    return failed;
+}
@@ -0,0 +1,192 @@
+// Compares the font column blit in text.c with the per pixel drawLetter() it replaced in hw7.c and
+// hw13.c, for the pixels and the time, on the computer.
+//
+//   text_bench
+//
+// The per pixel version is the old drawLetterColumn(): eight ssd1306_drawPixel() calls a column,
+// setting and clearing, so the whole 5x8 cell is drawn.
+//
+// - drawChar() sets the same pixels as the per pixel version for every character at every x and y
+//   around and off the edges, on 128x32 and 128x64, and touches nothing outside the cell
+// - drawString() wraps at \n and the right edge back to the starting x, stops below the screen,
+//   and returns the x after the last character
+// - drawPrintf() is snprintf() then drawString(), cut at a screen of text
+// - the time for a screen of text both ways, on page rows and between them
+//
+// Prints what it checked and exits with 1 if anything was wrong.
+// The times are from the computer, only the ratio says anything about the pico.
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "ssd1306.h"
+#include "text.h"
+#include "font.h"
+#include "fake_pico.h"
+
+static int failed = 0;
+
+static void check(int ok, const char *what) {
+    printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+    if (!ok) {
+        failed = 1;
+    }
+}
+
+static uint32_t noise = 1;
+
+static uint32_t random32(void) {
+    noise = noise * 1664525 + 1013904223;
+    return noise >> 8;
+}
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static ssd1306_t display;
+static ssd1306_t reference;
+
+// the old way, a pixel at a time
+static void drawLetterColumn(ssd1306_t *d, int x, int y, char c) {
+    int i;
+    for (i = 0; i < 8; i++) {
+        ssd1306_drawPixel(d, x, y + i, (c >> i) & 1);
+    }
+}
+
+static void drawLetter(ssd1306_t *d, int x, int y, char c) {
+    unsigned char u = c;
+    int i;
+    if (u < 32 || u > 127) {
+        u = '?';
+    }
+    for (i = 0; i < 5; i++) {
+        drawLetterColumn(d, x + i, y, ASCII[u - 32][i]);
+    }
+}
+
+// the string rules in text.h, a character at a time with the old drawLetter()
+static int drawStringSlow(ssd1306_t *d, int x, int y, const char *s) {
+    int cx = x;
+    for (; *s && y < d->height; s++) {
+        if (*s == '\n') {
+            cx = x;
+            y += 8;
+            continue;
+        }
+        if (cx + 5 > d->width) {
+            cx = x;
+            y += 8;
+            if (y >= d->height) {
+                break;
+            }
+        }
+        drawLetter(d, cx, y, *s);
+        cx += 5;
+    }
+    return cx;
+}
+
+static void scribble(void) {
+    int i;
+    for (i = 1; i <= display.width * display.pages; i++) {
+        display.buffer[i] = reference.buffer[i] = random32();
+    }
+}
+
+static int same(void) {
+    return !memcmp(display.buffer, reference.buffer, 1 + display.width * display.pages);
+}
+
+static void checkChars(int height) {
+    int x, y, c;
+    int ok = 1;
+    ssd1306_setup(&display, i2c0, SSD1306_ADDRESS, 128, height);
+    ssd1306_setup(&reference, i2c1, SSD1306_ADDRESS, 128, height);
+    for (c = 0; c < 256; c++) {
+        for (y = -9; y <= height + 1; y++) {
+            for (x = -6; x <= 129; x += (x > 2 && x < 120) ? 13 : 1) {
+                scribble();
+                drawChar(&display, x, y, (char)c);
+                drawLetter(&reference, x, y, (char)c);
+                ok = ok && same();
+            }
+        }
+    }
+    check(ok, height == 32 ? "128x32: drawChar() is the old drawLetter() at every x, y and character"
+                           : "128x64: drawChar() is the old drawLetter() at every x, y and character");
+}
+
+static void checkStrings(void) {
+    static const char *strings[] = {
+        "", "a", "fps: 71.234", "two\nlines", "\n\nstarts low", "a long line that runs off the right edge and wraps round",
+        "V: 1.602\nfps: 70.137\nyaw 12 pitch -3 roll 4\nfour\nfive\nsix\nseven\neight\nnine is off the bottom",
+    };
+    static const int starts[][2] = {{0, 0}, {0, 24}, {3, 5}, {-2, -3}, {100, 0}, {126, 60}, {0, 70}};
+    int i, j;
+    int ok = 1;
+    for (i = 0; i < 7; i++) {
+        for (j = 0; j < 7; j++) {
+            scribble();
+            int a = drawString(&display, starts[j][0], starts[j][1], strings[i]);
+            int b = drawStringSlow(&reference, starts[j][0], starts[j][1], strings[i]);
+            ok = ok && a == b && same();
+        }
+    }
+    check(ok, "drawString() wraps and clips like the old path and returns the same x");
+
+    // a screen and a half of text, cut where the buffer ends
+    char want[SSD1306_MAX_PAGES * SSD1306_MAX_WIDTH / TEXT_WIDTH + 1];
+    char longer[400];
+    for (i = 0; i < 399; i++) {
+        longer[i] = 'A' + i % 26;
+    }
+    longer[399] = 0;
+    memcpy(want, longer, sizeof(want) - 1);
+    want[sizeof(want) - 1] = 0;
+    scribble();
+    int a = drawPrintf(&display, 0, 0, "%s", longer);
+    int b = drawStringSlow(&reference, 0, 0, want);
+    ok = a == b && same();
+    scribble();
+    a = drawPrintf(&display, 7, 9, "fps: %.3f %d%%", 71.25, 42);
+    b = drawStringSlow(&reference, 7, 9, "fps: 71.250 42%");
+    check(ok && a == b && same(), "drawPrintf() formats, then draws like drawString(), cut at a screen");
+}
+
+// a 128x64 screen of text, 8 lines of 25
+static void timeText(int y0) {
+    static const char line[] = "fps: 71.234 V: 1.602 abc";
+    int frames = 2000;
+    int i, row;
+    double start = now_us();
+    for (i = 0; i < frames; i++) {
+        for (row = 0; row < 8; row++) {
+            drawStringSlow(&reference, 0, y0 + row * 8, line);
+        }
+    }
+    double slow_us = (now_us() - start) / frames;
+    start = now_us();
+    for (i = 0; i < frames; i++) {
+        for (row = 0; row < 8; row++) {
+            drawString(&display, 0, y0 + row * 8, line);
+        }
+    }
+    double fast_us = (now_us() - start) / frames;
+    printf("     a screen of text at y %d: per pixel %.2f us, font columns %.2f us, %.0fx\n", y0, slow_us, fast_us, slow_us / fast_us);
+}
+
+int main() {
+    fake_panel_add(i2c0, SSD1306_ADDRESS);
+    fake_panel_add(i2c1, SSD1306_ADDRESS);
+    checkChars(32);
+    checkChars(64);
+    checkStrings();
+    timeText(0);
+    timeText(3);
+    return failed;
+}
@@ -0,0 +1,319 @@
+// based on adafruit and sparkfun libraries
+
+#include <string.h> // for memset
+#include "ssd1306.h"
+#include "hardware/i2c.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "pico/stdlib.h"
+
+// every display that has been set up, for the DMA interrupt and for sharing a bus
+static ssd1306_t *ssd1306_devices[SSD1306_MAX_DEVICES];
+static int ssd1306_count = 0;
+
+// the last word of d's update is in the I2C FIFO, so the display is getting what was queued.
+// each window in tx is the address words ssd1306_queue() starts it with, then its pixels
+static void ssd1306_sent(ssd1306_t *d) {
+    int i = 0;
+    // the panel didn't ack (unplugged, wrong address), the bytes after that never got there
+    // and the rest of the FIFO was thrown away. send everything once it answers again
+    if (i2c_get_hw(d->i2c)->raw_intr_stat & I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS) {
+        d->full = true;
+        return;
+    }
+    while (i < d->tx_len) {
+        int page0 = d->tx[i + 2];
+        int page1 = d->tx[i + 3];
+        int col0 = d->tx[i + 5];
+        int col1 = d->tx[i + 6] & 0xFF;
+        int page, x;
+        i = i + SSD1306_ADDR_CMDS + 1;
+        for (page = page0; page <= page1; page++) {
+            for (x = col0; x <= col1; x++) {
+                d->shown[x + page * d->width] = d->tx[i++] & 0xFF;
+            }
+        }
+    }
+    d->full = false;
+}
+
+// the last word of some display's update is in its I2C FIFO
+static void ssd1306_dma_handler() {
+    int i;
+    for (i = 0; i < ssd1306_count; i++) {
+        ssd1306_t *d = ssd1306_devices[i];
+        if (!dma_channel_get_irq1_status(d->dma)) {
+            continue;
+        }
+        dma_channel_acknowledge_irq1(d->dma);
+        ssd1306_sent(d);
+        d->sending = false;
+        if (d->done) {
+            d->done();
+        }
+    }
+}
+
+// set up the display at address on i2c, which has to be initialised already.
+// width is up to 128 and height a multiple of 8 up to 64, 128x32 and 128x64 are the usual panels.
+// each display gets its own DMA channel, several can share one bus or be on different ones.
+// returns false if the size is wrong or there are already SSD1306_MAX_DEVICES
+bool ssd1306_setup(ssd1306_t *d, i2c_inst_t *i2c, uint8_t address, int width, int height) {
+    int i;
+    if (width < 1 || width > SSD1306_MAX_WIDTH || height < 8 || height > SSD1306_MAX_PAGES * 8 || height % 8) {
+        return false;
+    }
+    for (i = 0; i < ssd1306_count && ssd1306_devices[i] != d; i++) {
+    }
+    if (i == ssd1306_count) {
+        if (ssd1306_count == SSD1306_MAX_DEVICES) {
+            return false;
+        }
+        // DMA channel for the async update, the interrupt is shared in case anything else uses DMA_IRQ_1
+        d->dma = dma_claim_unused_channel(true);
+        d->sending = false;
+        d->i2c = NULL;
+        critical_section_init(&d->lock);
+        dma_channel_set_irq1_enabled(d->dma, true);
+        if (ssd1306_count == 0) {
+            irq_add_shared_handler(DMA_IRQ_1, ssd1306_dma_handler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+            irq_set_enabled(DMA_IRQ_1, true);
+        }
+        ssd1306_devices[ssd1306_count++] = d;
+    }
+    ssd1306_wait(d);
+
+    d->i2c = i2c;
+    d->address = address;
+    d->width = width;
+    d->height = height;
+    d->pages = height / 8;
+    d->tx_len = 0;
+    d->full = true;
+    d->done = NULL;
+    // first byte in buffer is a command
+    d->buffer[0] = 0x40;
+    // give a little delay for the ssd1306 to power up
+    sleep_ms(20);
+
+    ssd1306_command(d, SSD1306_DISPLAYOFF);
+    ssd1306_command(d, SSD1306_SETDISPLAYCLOCKDIV);
+    ssd1306_command(d, 0x80);
+    ssd1306_command(d, SSD1306_SETMULTIPLEX);
+    ssd1306_command(d, height - 1);
+    ssd1306_command(d, SSD1306_SETDISPLAYOFFSET);
+    ssd1306_command(d, 0x0);
+    ssd1306_command(d, SSD1306_SETSTARTLINE);
+    ssd1306_command(d, SSD1306_CHARGEPUMP);
+    ssd1306_command(d, 0x14);
+    ssd1306_command(d, SSD1306_MEMORYMODE);
+    ssd1306_command(d, 0x00);
+    ssd1306_command(d, SSD1306_SEGREMAP | 0x1);
+    ssd1306_command(d, SSD1306_COMSCANDEC);
+    ssd1306_command(d, SSD1306_SETCOMPINS);
+    ssd1306_command(d, height > 32 ? 0x12 : 0x02); // 64 row panels use alternate COM pins
+    ssd1306_command(d, SSD1306_SETCONTRAST);
+    ssd1306_command(d, 0x8F);
+    ssd1306_command(d, SSD1306_SETPRECHARGE);
+    ssd1306_command(d, 0xF1);
+    ssd1306_command(d, SSD1306_SETVCOMDETECT);
+    ssd1306_command(d, 0x40);
+    ssd1306_command(d, SSD1306_DISPLAYON);
+    ssd1306_clear(d);
+    ssd1306_update(d);
+    return true;
+}
+
+// send a command instruction (not pixel data)
+void ssd1306_command(ssd1306_t *d, unsigned char c) {
+    uint8_t buf[2];
+    buf[0] = 0x00; // bit 7 is 0 for Co bit (data bytes only), bit 6 is 0 for DC (data is a command))
+    buf[1] = c;
+    ssd1306_wait(d); // the bus may still be busy with an async update
+    i2c_write_blocking(d->i2c, d->address, buf, 2, false);
+}
+
+// find the columns that changed on each page between now and shown (width*pages bytes each, no 0x40).
+// spans[page] gets the first and last changed column, or -1 -1 if the page is the same.
+// returns the I2C bytes it would take to send those windows
+int ssd1306_dirty_spans(const unsigned char *now, const unsigned char *shown, int width, int pages, int spans[][2]) {
+    int page;
+    int words = 0;
+    for (page = 0; page < pages; page++) {
+        const unsigned char *a = now + page * width;
+        const unsigned char *b = shown + page * width;
+        int lo = 0;
+        int hi = width - 1;
+        while (lo < width && a[lo] == b[lo]) {
+            lo++;
+        }
+        if (lo == width) {
+            spans[page][0] = -1;
+            spans[page][1] = -1;
+            continue;
+        }
+        while (a[hi] == b[hi]) {
+            hi--;
+        }
+        spans[page][0] = lo;
+        spans[page][1] = hi;
+        words = words + SSD1306_ADDR_CMDS + 1 + (hi - lo + 1);
+    }
+    return words;
+}
+
+// add a window of pages page0-page1 and columns col0-col1 to the async transfer.
+// one transaction for the address, one for the pixels. shown is only updated once the DMA
+// has sent them, see ssd1306_sent()
+static void ssd1306_queue(ssd1306_t *d, int page0, int page1, int col0, int col1) {
+    uint16_t *tx = d->tx + d->tx_len;
+    int n = 0;
+    int page, x;
+    tx[n++] = 0x00;
+    tx[n++] = SSD1306_PAGEADDR;
+    tx[n++] = page0;
+    tx[n++] = page1;
+    tx[n++] = SSD1306_COLUMNADDR;
+    tx[n++] = col0;
+    tx[n++] = col1 | I2C_IC_DATA_CMD_STOP_BITS;
+    tx[n++] = 0x40; // pixel data follows
+    for (page = page0; page <= page1; page++) {
+        for (x = col0; x <= col1; x++) {
+            tx[n++] = d->front[x + page * d->width];
+        }
+    }
+    tx[n-1] |= I2C_IC_DATA_CMD_STOP_BITS;
+    d->tx_len = d->tx_len + n;
+}
+
+// bytes sent by the last update, 520 for the whole of a 128x32 screen
+int ssd1306_update_size(ssd1306_t *d) {
+    return d->tx_len;
+}
+
+// present the frame and send it, returns when it is all sent
+void ssd1306_update(ssd1306_t *d) {
+    ssd1306_present(d);
+    while (!ssd1306_flush_async(d, NULL)) {
+        ssd1306_wait(d); // something else is being sent, this frame goes after it
+    }
+    ssd1306_wait(d);
+}
+
+// hand the frame drawn in the buffer over to be sent. the back buffer keeps its
+// contents, so drawing can carry on from where it was while this frame goes out
+void ssd1306_present(ssd1306_t *d) {
+    critical_section_enter_blocking(&d->lock);
+    memcpy(d->front, d->buffer + 1, d->width * d->pages);
+    critical_section_exit(&d->lock);
+}
+
+// present the frame and start sending it, see ssd1306_flush_async(). if the bus is busy this
+// returns false and the frame goes with the next flush
+bool ssd1306_update_async(ssd1306_t *d, void (*done)(void)) {
+    ssd1306_present(d);
+    return ssd1306_flush_async(d, done);
+}
+
+// start sending the pixels of the front buffer that changed since the last flush and return straight away.
+// only the changed columns of each changed page are sent, a whole 128x32 screen is about 13ms of I2C at 400kHz.
+// done is called from the DMA interrupt once the last byte is handed to the I2C
+// hardware, or straight away if nothing changed, it can be NULL. if an update is still going on this bus
+// this returns false without waiting and done is not called, so it is safe from a timer interrupt.
+// anything else on the same I2C bus has to call ssd1306_wait() before using it
+bool ssd1306_flush_async(ssd1306_t *d, void (*done)(void)) {
+    // hold the front buffer still while the changed bytes are copied out, about 50us at most for 128x32.
+    // the busy check is in here too, so the main loop and an interrupt can't both start a transfer
+    critical_section_enter_blocking(&d->lock);
+    if (ssd1306_busy(d)) {
+        critical_section_exit(&d->lock);
+        return false;
+    }
+    // an abort still latched from the last transfer, it may have come after ssd1306_sent() as the
+    // FIFO emptied. the I2C drops everything until it is cleared, like in OV7670_write_table()
+    i2c_hw_t *hw = i2c_get_hw(d->i2c);
+    if (hw->raw_intr_stat & I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS) {
+        hw->clr_tx_abrt; // reading clears the abort and releases the TX FIFO
+        d->full = true;
+    }
+    int spans[SSD1306_MAX_PAGES][2];
+    int words = ssd1306_dirty_spans(d->front, d->shown, d->width, d->pages, spans);
+    int page;
+    d->tx_len = 0;
+    if (d->full || words >= SSD1306_ADDR_CMDS + 1 + d->width * d->pages) {
+        // a whole screen is cheaper in one window
+        ssd1306_queue(d, 0, d->pages - 1, 0, d->width - 1);
+    } else {
+        for (page = 0; page < d->pages; page++) {
+            if (spans[page][0] >= 0) {
+                ssd1306_queue(d, page, page, spans[page][0], spans[page][1]);
+            }
+        }
+    }
+    d->sending = d->tx_len > 0;
+    critical_section_exit(&d->lock);
+    if (d->tx_len == 0) {
+        // nothing changed
+        if (done) {
+            done();
+        }
+        return true;
+    }
+
+    hw->enable = 0;
+    hw->tar = d->address;
+    hw->enable = 1;
+    hw->dma_cr = I2C_IC_DMA_CR_TDMAE_BITS;
+
+    d->done = done;
+    dma_channel_config c = dma_channel_get_default_config(d->dma);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_16);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, i2c_get_dreq(d->i2c, true));
+    dma_channel_configure(d->dma, &c, &hw->data_cmd, d->tx, d->tx_len, true);
+    return true;
+}
+
+// true while an async update is still being sent on this display's bus, by this display or another one
+// on the same bus, including the bytes left in the I2C FIFO
+bool ssd1306_busy(ssd1306_t *d) {
+    int i;
+    for (i = 0; i < ssd1306_count; i++) {
+        if (ssd1306_devices[i]->i2c == d->i2c && ssd1306_devices[i]->sending) {
+            return true;
+        }
+    }
+    i2c_hw_t *hw = i2c_get_hw(d->i2c);
+    return !(hw->status & I2C_IC_STATUS_TFE_BITS) || (hw->status & I2C_IC_STATUS_ACTIVITY_BITS);
+}
+
+// wait for async updates on the bus to finish, then it is free for blocking I2C calls
+void ssd1306_wait(ssd1306_t *d) {
+    if (!d->i2c) {
+        return; // not set up yet
+    }
+    while (ssd1306_busy(d)) {
+        tight_loop_contents();
+    }
+    i2c_get_hw(d->i2c)->dma_cr = 0;
+}
+
+// set a pixel value. Call update() to push to the display)
+void ssd1306_drawPixel(ssd1306_t *d, int x, int y, unsigned char color) {
+    if ((x < 0) || (x >= d->width) || (y < 0) || (y >= d->height)) {
+        return;
+    }
+
+    if (color == 1) {
+        d->buffer[1 + x + (y / 8)*d->width] |= (1 << (y & 7));
+    } else {
+        d->buffer[1 + x + (y / 8)*d->width] &= ~(1 << (y & 7));
+    }
+}
+
+// zero every pixel value
+void ssd1306_clear(ssd1306_t *d) {
+    memset(d->buffer + 1, 0, d->width * d->pages); // make every bit a 0, memset in string.h
+    d->buffer[0] = 0x40; // first byte is part of command
+}
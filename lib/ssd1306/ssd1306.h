@@ -0,0 +1,83 @@
+#ifndef SSD1306_H__
+#define SSD1306_H__
+
+// Based on the adafruit and sparkfun libraries
+#define SSD1306_MEMORYMODE          0x20
+#define SSD1306_COLUMNADDR          0x21
+#define SSD1306_PAGEADDR            0x22
+#define SSD1306_SETCONTRAST         0x81
+#define SSD1306_CHARGEPUMP          0x8D
+#define SSD1306_SEGREMAP            0xA0
+#define SSD1306_DISPLAYALLON_RESUME 0xA4
+#define SSD1306_NORMALDISPLAY       0xA6
+#define SSD1306_INVERTDISPLAY       0xA7
+#define SSD1306_SETMULTIPLEX        0xA8
+#define SSD1306_DISPLAYOFF          0xAE
+#define SSD1306_DISPLAYON           0xAF
+#define SSD1306_COMSCANDEC          0xC8
+#define SSD1306_SETDISPLAYOFFSET    0xD3
+#define SSD1306_SETDISPLAYCLOCKDIV  0xD5
+#define SSD1306_SETPRECHARGE        0xD9
+#define SSD1306_SETCOMPINS          0xDA
+#define SSD1306_SETVCOMDETECT       0xDB
+#define SSD1306_SETSTARTLINE        0x40
+#define SSD1306_DEACTIVATE_SCROLL   0x2E ///< Stop scroll
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "hardware/i2c.h"
+#include "pico/sync.h"
+
+#define SSD1306_ADDRESS 0x3C // 7bit i2c address, 0x3D if the address pad is bridged
+#define SSD1306_MAX_WIDTH 128
+#define SSD1306_MAX_PAGES 8 // 64 rows, 8 per page
+#define SSD1306_MAX_DEVICES 4 // displays that can be set up at once
+#define SSD1306_ADDR_CMDS 7 // control byte + 6 address commands, one transaction
+
+// One display. Fill it in with ssd1306_setup(), after that only buffer is for drawing into,
+// the rest belongs to the driver.
+typedef struct ssd1306 {
+    i2c_inst_t *i2c;
+    uint8_t address;
+    int width; // up to 128
+    int height; // 32 or 64, any multiple of 8 up to 64
+    int pages; // height / 8
+
+    // the back buffer, drawn into. the first byte is the data control byte (0x40),
+    // byte 1 + x + page*width has rows page*8 to page*8+7, the top one in bit 0
+    unsigned char buffer[1 + SSD1306_MAX_WIDTH * SSD1306_MAX_PAGES];
+
+    // the front buffer, the last frame handed over with ssd1306_present(). only this is ever sent,
+    // so a flush can't catch a frame half drawn
+    unsigned char front[SSD1306_MAX_WIDTH * SSD1306_MAX_PAGES];
+    critical_section_t lock; // guards front, present and flush can be on different cores or in interrupts
+
+    // what the display is showing, only the bytes that differ from it are sent.
+    // updated from the DMA interrupt once a transfer is sent
+    unsigned char shown[SSD1306_MAX_WIDTH * SSD1306_MAX_PAGES];
+    bool full; // the display contents are unknown, send everything
+
+    // async update: the address commands and the pixels as I2C data_cmd words, fed to the TX FIFO by DMA
+    uint16_t tx[SSD1306_MAX_PAGES * (SSD1306_ADDR_CMDS + 1 + SSD1306_MAX_WIDTH)]; // worst case, every page its own window
+    int tx_len;
+    int dma;
+    volatile bool sending;
+    void (*done)(void);
+} ssd1306_t;
+
+bool ssd1306_setup(ssd1306_t *d, i2c_inst_t *i2c, uint8_t address, int width, int height);
+void ssd1306_update(ssd1306_t *d);
+bool ssd1306_update_async(ssd1306_t *d, void (*done)(void));
+void ssd1306_present(ssd1306_t *d);
+bool ssd1306_flush_async(ssd1306_t *d, void (*done)(void));
+bool ssd1306_busy(ssd1306_t *d);
+void ssd1306_wait(ssd1306_t *d);
+int ssd1306_update_size(ssd1306_t *d);
+int ssd1306_dirty_spans(const unsigned char *now, const unsigned char *shown, int width, int pages, int spans[][2]);
+void ssd1306_clear(ssd1306_t *d);
+void ssd1306_drawPixel(ssd1306_t *d, int x, int y, unsigned char color);
+
+/// this should be private
+void ssd1306_command(ssd1306_t *d, unsigned char c);
+
+#endif
@@ -0,0 +1,66 @@
+#include <stdio.h>
+#include <stdarg.h>
+#include "text.h"
+#include "ssd1306.h"
+#include "font.h"
+
+// draw one character with its top left at x, y. the background of the 5x8 cell is cleared.
+// each font column is one byte with the top pixel in bit 0, the same as a display page byte,
+// so it goes in with a shift and a mask instead of 8 drawPixel() calls
+void drawChar(ssd1306_t *d, int x, int y, char c) {
+    if ((unsigned char)c < 32 || (unsigned char)c > 127) { // char is unsigned on the pico, signed on a PC
+        c = '?';
+    }
+    const char *glyph = ASCII[c - 32];
+    // y can be negative, so round the page down
+    int page = (y >= 0) ? y / 8 : (y - 7) / 8;
+    int shift = y - page * 8;
+    int col;
+    for (col = 0; col < TEXT_WIDTH; col++) {
+        int px = x + col;
+        if (px < 0 || px >= d->width) {
+            continue;
+        }
+        unsigned int bits = (unsigned char)glyph[col] << shift; // spans this page and the next
+        unsigned int mask = 0xFF << shift;
+        if (page >= 0 && page < d->pages) {
+            unsigned char *p = &d->buffer[1 + px + page * d->width];
+            *p = (*p & ~mask) | (bits & mask);
+        }
+        if (shift && page + 1 >= 0 && page + 1 < d->pages) {
+            unsigned char *p = &d->buffer[1 + px + (page + 1) * d->width];
+            *p = (*p & ~(mask >> 8)) | (bits >> 8);
+        }
+    }
+}
+
+// draw a string starting at x, y. \n and running off the right edge both go to the
+// next line at the same starting x. stops once the lines are off the bottom of the screen.
+// returns the x just after the last character
+int drawString(ssd1306_t *d, int x, int y, const char *s) {
+    int cx = x;
+    while (*s && y < d->height) {
+        if (*s == '\n' || cx + TEXT_WIDTH > d->width) {
+            cx = x;
+            y = y + TEXT_HEIGHT;
+            if (*s == '\n') {
+                s++;
+            }
+            continue;
+        }
+        drawChar(d, cx, y, *s);
+        cx = cx + TEXT_WIDTH;
+        s++;
+    }
+    return cx;
+}
+
+// printf to the screen, at most one 128x64 screen of text (8 lines of 25)
+int drawPrintf(ssd1306_t *d, int x, int y, const char *fmt, ...) {
+    char buf[SSD1306_MAX_PAGES * SSD1306_MAX_WIDTH / TEXT_WIDTH + 1];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+    return drawString(d, x, y, buf);
+}
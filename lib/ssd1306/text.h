@@ -0,0 +1,17 @@
+#ifndef TEXT_H__
+#define TEXT_H__
+
+// 5x8 text straight into a display's buffer, a whole font column at a time.
+// characters are 5 pixels wide with no gap, like the font in font.h.
+// anything off the screen is clipped, x and y can be negative
+
+#include "ssd1306.h"
+
+#define TEXT_WIDTH 5
+#define TEXT_HEIGHT 8
+
+void drawChar(ssd1306_t *d, int x, int y, char c);
+int drawString(ssd1306_t *d, int x, int y, const char *s);
+int drawPrintf(ssd1306_t *d, int x, int y, const char *fmt, ...);
+
+#endif